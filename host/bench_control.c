@@ -0,0 +1,104 @@
+/*
+Micro-benchmark of one full control step (heater_step) on the workstation.
+The HAL only counts calls, so the numbers are the cost of the control logic itself.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "heater_logic.h"
+
+#define ITERATIONS (2000000)
+
+static uint32_t applied;
+static uint32_t saved;
+static uint32_t timers;
+static volatile uint32_t sink;
+
+static void bench_apply(void *ctx, const heater_outputs_t *out)
+{
+    applied++;
+    sink += out->duty[HEATER_CH_NUM - 1];
+}
+
+static void bench_save(void *ctx, const heater_state_t *state)
+{
+    saved++;
+}
+
+static void bench_timer(void *ctx, heater_timer_t timer, uint32_t seconds)
+{
+    timers++;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double bench(const char *name, heater_t *heater, const control_event_t *events, int count)
+{
+    double start = now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        heater_step(heater, &events[i % count]);
+    }
+    double ns = (now_ns() - start) / ITERATIONS;
+    printf("%-28s %8.1f ns/step\n", name, ns);
+    return ns;
+}
+
+int main(void)
+{
+    static const heater_hal_t hal = {
+        .apply = bench_apply,
+        .save = bench_save,
+        .timer = bench_timer
+    };
+    heater_state_t restored = {
+        .on_off_b_state = 1,
+        .on_off_b_long = 3
+    };
+    heater_t heater;
+    heater_init(&heater, &restored, &hal);
+
+    // sensor sweep across the auto mode table and the humidity limit
+    control_event_t sensor[64];
+    for (int i = 0; i < 64; i++) {
+        sensor[i].type = CONTROL_EVT_SENSOR;
+        sensor[i].sensor.temperature = 200 + i * 2;
+        sensor[i].sensor.humidity = 850 + (i % 16) * 5;
+    }
+
+    // press/release pairs on every zone pad and the mode pad
+    uint32_t pads[HEATER_ZONE_NUM + 1];
+    int n_pads = 0;
+    for (int z = 0; z < HEATER_ZONE_NUM; z++) {
+        if (heater_zones[z].pad != HEATER_PAD_NONE) {
+            pads[n_pads++] = heater_zones[z].pad;
+        }
+    }
+    pads[n_pads++] = HEATER_PAD_MODE;
+    control_event_t buttons[2 * (HEATER_ZONE_NUM + 1)];
+    for (int i = 0; i < n_pads; i++) {
+        buttons[2 * i].type = CONTROL_EVT_BUTTON;
+        buttons[2 * i].button.pad = pads[i];
+        buttons[2 * i].button.gesture = BUTTON_PRESS;
+        buttons[2 * i + 1] = buttons[2 * i];
+        buttons[2 * i + 1].button.gesture = BUTTON_RELEASE;
+    }
+
+    control_event_t tick = { .type = CONTROL_EVT_TICK };
+
+    printf("heater_step, %d iterations per case\n", ITERATIONS);
+    heater.state.mode_b_state = MODE_AUTO;
+    bench("tick, auto mode", &heater, &tick, 1);
+    bench("sensor sample, auto mode", &heater, sensor, 64);
+    heater.state.mode_b_state = MODE_DEWPOINT;
+    bench("sensor sample, dewpoint mode", &heater, sensor, 64);
+    heater.state.mode_b_state = MODE_MANUAL;
+    bench("button press/release", &heater, buttons, 2 * n_pads);
+
+    printf("outputs applied %u, states saved %u, timers started or cancelled %u\n", applied, saved, timers);
+    return 0;
+}
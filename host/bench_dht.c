@@ -0,0 +1,128 @@
+/*
+Micro-benchmark of the DHT22 pulse decoder (dht_decode) on the workstation.
+Decodes synthetic pulse trains with sensor jitter, plus corrupted variants (dropped pulses, stretched bits, flipped bits),
+and reports the cost per train and how each kind of train was classified.
+Every clean train must decode to its values, every corrupted one must be rejected: exits non-zero otherwise, run by ctest.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "dht_decode.h"
+
+#define ITERATIONS  (200000)
+#define TRAIN_MAX   (DHT_PULSES_MIN + 4)
+
+typedef struct {
+    dht_pulse_t pulses[TRAIN_MAX];
+    size_t count;
+} train_t;
+
+static volatile int32_t sink;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint16_t jitter(uint16_t us, int spread)
+{
+    return (uint16_t)(us + rand() % (2 * spread + 1) - spread);
+}
+
+static void train_build(train_t *t, int16_t humidity, int16_t temperature)   // host release, response, 40 bits, end low, as RMT captures it
+{
+    uint16_t temp_raw = temperature < 0 ? (uint16_t)(0x8000 | -temperature) : (uint16_t)temperature;
+    uint8_t data[5] = { humidity >> 8, humidity & 0xFF, temp_raw >> 8, temp_raw & 0xFF, 0 };
+    data[4] = data[0] + data[1] + data[2] + data[3];
+
+    t->count = 0;
+    t->pulses[t->count++] = (dht_pulse_t){ 1, jitter(30, 10) };
+    t->pulses[t->count++] = (dht_pulse_t){ 0, jitter(80, 5) };
+    t->pulses[t->count++] = (dht_pulse_t){ 1, jitter(80, 5) };
+    for (int bit = 0; bit < 40; bit++) {
+        int one = (data[bit / 8] >> (7 - bit % 8)) & 1;
+        t->pulses[t->count++] = (dht_pulse_t){ 0, jitter(50, 5) };
+        t->pulses[t->count++] = (dht_pulse_t){ 1, one ? jitter(70, 5) : jitter(27, 3) };
+    }
+    t->pulses[t->count++] = (dht_pulse_t){ 0, jitter(50, 5) };
+}
+
+static int failures;
+
+static void classify(const char *name, train_t *trains, int n, int16_t (*expect)[2], dht_decode_result_t want)   // n trains must all decode to want
+{
+    static const char *names[] = { "ok", "timeout", "checksum", "framing" };
+    int results[4] = {0};
+    int wrong = 0;
+
+    double start = now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        int16_t h, t;
+        train_t *tr = &trains[i % n];
+        dht_decode_result_t r = dht_decode(tr->pulses, tr->count, &h, &t);
+        if (i < n) {
+            results[r]++;
+            wrong += r == DHT_DECODE_OK && expect != NULL && (h != expect[i][0] || t != expect[i][1]);
+        }
+        sink += r;
+    }
+    double ns = (now_ns() - start) / ITERATIONS;
+
+    printf("%-16s %7.1f ns/train ", name, ns);
+    for (int r = 0; r < 4; r++) {
+        printf(" %s %d", names[r], results[r]);
+    }
+    printf(", wrong values %d\n", wrong);
+    if (results[want] != n || wrong) {
+        printf("FAIL: %s trains must all be %s\n", name, names[want]);
+        failures++;
+    }
+}
+
+int main(void)
+{
+    enum { N = 256 };
+    static train_t trains[N];
+    static int16_t expect[N][2];
+
+    srand(1);
+    for (int i = 0; i < N; i++) {
+        expect[i][0] = (int16_t)(rand() % 1001);            // 0-100.0 %
+        expect[i][1] = (int16_t)(rand() % 1201 - 400);      // -40.0-80.0 C
+        train_build(&trains[i], expect[i][0], expect[i][1]);
+    }
+    classify("clean", trains, N, expect, DHT_DECODE_OK);
+
+    for (int i = 0; i < N; i++) {               // capture cut short
+        train_build(&trains[i], expect[i][0], expect[i][1]);
+        trains[i].count = 3 + rand() % (trains[i].count - 3);
+    }
+    classify("truncated", trains, N, NULL, DHT_DECODE_TIMEOUT);
+
+    for (int i = 0; i < N; i++) {               // all 40 bits, but the capture stops before the end low: bit 40 is not known
+        train_build(&trains[i], expect[i][0], expect[i][1]);
+        trains[i].count--;
+    }
+    classify("no end low", trains, N, NULL, DHT_DECODE_TIMEOUT);
+
+    for (int i = 0; i < N; i++) {               // one bit flipped by noise shorter than the input filter
+        train_build(&trains[i], expect[i][0], expect[i][1]);
+        int p = 4 + 2 * (rand() % 40);
+        trains[i].pulses[p].us = trains[i].pulses[p].us > 48 ? 27 : 70;
+    }
+    classify("bit flip", trains, N, NULL, DHT_DECODE_CHECKSUM);
+
+    for (int i = 0; i < N; i++) {               // one bit low stretched out of the protocol timing
+        train_build(&trains[i], expect[i][0], expect[i][1]);
+        trains[i].pulses[3 + 2 * (rand() % 40)].us = 150;
+    }
+    classify("stretched", trains, N, NULL, DHT_DECODE_FRAMING);
+
+    for (int i = 0; i < N; i++) {               // no sensor, only the host release
+        trains[i].count = 1;
+    }
+    classify("no response", trains, N, NULL, DHT_DECODE_TIMEOUT);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,157 @@
+/*
+Framebuffer renderer cost per display update (oled_fb).
+-Drives the two labels of the screen with a sensor trace: random walk temperature and humidity, one update every 2 s,
+ laid out like display.c. The fonts are synthetic with the glyph sizes of Montserrat 48 and 14, the real tables are
+ generated from the LVGL sources in the firmware build.
+-Reports render time per update, changed and flushed bytes, and the I2C time of the flush at 400 kHz (9 clocks a byte,
+ plus the 14 address, command and control bytes of each page window).
+-For comparison, the bytes an LVGL SSD1306 flush of the same labels sends: the invalidated label area, rounded to pages.
+ That part is an estimate, LVGL itself is not built on the host.
+
+Usage: bench_oled [updates, default 100000]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "oled_fb.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define I2C_HZ              (400000)
+#define PAGE_OVERHEAD       (14)        // address, 6 command pairs, data control byte
+#define GLYPHS              (0x7f - 0x20)
+
+/**********************
+ *  TYPES
+ **********************/
+typedef struct {
+    int x, y, w, h;
+    const oled_font_t *font;
+    oled_align_t align;
+    char text[24];
+    int text_w;                 // width of the text shown, for the LVGL estimate
+} label_t;
+
+/**********************
+ *  VARIABLES
+ **********************/
+static uint8_t bitmap_48[GLYPHS * 32 * 5], bitmap_14[GLYPHS * 12 * 2];
+static oled_glyph_t glyphs_48[GLYPHS], glyphs_14[GLYPHS];
+static const oled_font_t font_48 = { bitmap_48, glyphs_48, 0x20, GLYPHS, 49, NULL };
+static const oled_font_t font_14 = { bitmap_14, glyphs_14, 0x20, GLYPHS, 16, NULL };
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void make_font(uint8_t *bitmap, oled_glyph_t *glyphs, int w, int h, int y)    // random glyph bits, cap height boxes
+{
+    int bytes = (h + 7) / 8;
+    int offset = 0;
+
+    for (int i = 0; i < GLYPHS; i++) {
+        int gw = i == 0 ? 0 : w - rand() % (w / 3);
+        glyphs[i] = (oled_glyph_t){ offset, gw + 2, gw, h, 1, y };
+        for (int b = 0; b < gw * bytes; b++) {
+            bitmap[offset++] = (uint8_t)rand();
+        }
+    }
+}
+
+static int label_set(oled_fb_t *fb, label_t *l, const char *text)    // changed bytes, 0 when the text is shown already
+{
+    if (strcmp(l->text, text) == 0) {
+        return 0;
+    }
+    snprintf(l->text, sizeof(l->text), "%s", text);
+    l->text_w = oled_fb_text_width(l->font, text);
+    return oled_fb_text(fb, l->x, l->y, l->w, l->h, l->font, l->align, l->text);
+}
+
+static int lvgl_bytes(const label_t *l, int old_w)      // old and new label area, full pages
+{
+    int w = old_w > l->text_w ? old_w : l->text_w;
+    int rows = l->font->line_h < OLED_HEIGHT - l->y ? l->font->line_h : OLED_HEIGHT - l->y;
+    return w * ((rows + 7) / 8);
+}
+
+int main(int argc, char **argv)
+{
+    int n = argc > 1 ? atoi(argv[1]) : 100000;
+    static oled_fb_t fb;
+    label_t temp = { 0, 0, OLED_WIDTH, 48, &font_48, OLED_ALIGN_CENTER, "", 0 };
+    label_t humidity = { 28, 48, OLED_WIDTH - 28, 16, &font_14, OLED_ALIGN_LEFT, "", 0 };
+    int temperature = 200, hum = 500;
+    long updates = 0, changed = 0, sent = 0, windows = 0, lvgl = 0;
+    int sent_max = 0;
+    double render_ns = 0, render_max = 0;
+    char text[24];
+
+    if (n <= 0) {
+        fprintf(stderr, "usage: bench_oled [updates]\n");
+        return 1;
+    }
+    srand(1);
+    make_font(bitmap_48, glyphs_48, 32, 35, 9);
+    make_font(bitmap_14, glyphs_14, 12, 10, 3);
+    oled_fb_init(&fb);
+    for (int p = 0; p < OLED_PAGES; p++) {
+        int x0, x1;
+        oled_fb_take_dirty(&fb, p, &x0, &x1);   // the blank screen is sent at start up
+    }
+
+    for (int i = 0; i < n; i++) {
+        temperature += rand() % 5 - 2;          // 0.1 C per 2 s steps
+        hum += rand() % 9 - 4;
+        temperature = temperature < -400 ? -400 : temperature > 800 ? 800 : temperature;
+        hum = hum < 0 ? 0 : hum > 1000 ? 1000 : hum;
+        int old_temp_w = temp.text_w, old_hum_w = humidity.text_w;
+
+        double t0 = now_ns();
+        snprintf(text, sizeof(text), "%dC", temperature / 10);
+        int temp_c = label_set(&fb, &temp, text);
+        snprintf(text, sizeof(text), "Humidity  %d%%.", hum / 10);
+        int hum_c = label_set(&fb, &humidity, text);
+        int c = temp_c + hum_c;
+        int bytes = 0, x0, x1;
+        for (int p = 0; p < OLED_PAGES; p++) {
+            if (oled_fb_take_dirty(&fb, p, &x0, &x1)) {
+                bytes += x1 - x0 + 1;
+                windows++;
+            }
+        }
+        double dt = now_ns() - t0;
+        if (c == 0 && bytes == 0) {
+            continue;           // text unchanged, no redraw on either path
+        }
+        render_ns += dt;
+        render_max = dt > render_max ? dt : render_max;
+        updates++;
+        changed += c;
+        sent += bytes;
+        sent_max = bytes > sent_max ? bytes : sent_max;
+        lvgl += (temp_c ? lvgl_bytes(&temp, old_temp_w) : 0) + (hum_c ? lvgl_bytes(&humidity, old_hum_w) : 0);
+    }
+
+    if (updates == 0) {
+        printf("no display changes\n");
+        return 0;
+    }
+    double bus_ms = (double)(sent + windows * PAGE_OVERHEAD) * 9 / I2C_HZ * 1000 / updates;
+    printf("updates with a change %ld of %d\n", updates, n);
+    printf("render   %.2f us mean, %.2f us max (host)\n", render_ns / updates / 1000, render_max / 1000);
+    printf("bytes    %.1f changed, %.1f flushed mean, %d max, %.2f page windows\n",
+           (double)changed / updates, (double)sent / updates, sent_max, (double)windows / updates);
+    printf("i2c      %.2f ms per update at %d kHz\n", bus_ms, I2C_HZ / 1000);
+    printf("lvgl     %.1f bytes per update estimated, %.1fx the framebuffer flush\n",
+           (double)lvgl / updates, (double)lvgl / sent);
+    return 0;
+}
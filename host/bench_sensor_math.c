@@ -0,0 +1,73 @@
+/*
+Accuracy and speed of the fixed-point dew point (sensor_dewpoint) against the Magnus formula in double precision.
+Sweeps the DHT22 range, -40 to 80 C and 0.1 to 100 % humidity in 0.1 steps.
+The workstation has an FPU, so on the ESP32-S2 the float reference is considerably slower than shown here.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include "sensor_math.h"
+
+#define T_MIN   (-400)
+#define T_MAX   (800)
+#define RH_MIN  (1)
+#define RH_MAX  (1000)
+
+static volatile double sink_f;
+static volatile int32_t sink_i;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double dewpoint_ref(double t, double rh)
+{
+    double gamma = log(rh / 100.0) + 17.62 * t / (243.12 + t);
+    return 243.12 * gamma / (17.62 - gamma);
+}
+
+int main(void)
+{
+    double max_err = 0, sum_err = 0;
+    int max_t = 0, max_rh = 0;
+    long n = 0;
+
+    for (int t = T_MIN; t <= T_MAX; t++) {
+        for (int rh = RH_MIN; rh <= RH_MAX; rh++) {
+            double err = fabs(sensor_dewpoint(t, rh) / 10.0 - dewpoint_ref(t / 10.0, rh / 10.0));
+            sum_err += err;
+            n++;
+            if (err > max_err) {
+                max_err = err;
+                max_t = t;
+                max_rh = rh;
+            }
+        }
+    }
+    printf("%ld points, mean error %.4f C, max error %.4f C at %.1f C %.1f %%\n",
+           n, sum_err / n, max_err, max_t / 10.0, max_rh / 10.0);
+    printf("(0.05 C of the max error is the rounding to 0.1 C)\n");
+
+    double start = now_ns();
+    for (int t = T_MIN; t <= T_MAX; t++) {
+        for (int rh = RH_MIN; rh <= RH_MAX; rh++) {
+            sink_i += sensor_dewpoint(t, rh);
+        }
+    }
+    double fixed_ns = (now_ns() - start) / n;
+
+    start = now_ns();
+    for (int t = T_MIN; t <= T_MAX; t++) {
+        for (int rh = RH_MIN; rh <= RH_MAX; rh++) {
+            sink_f += dewpoint_ref(t / 10.0, rh / 10.0);
+        }
+    }
+    double float_ns = (now_ns() - start) / n;
+
+    printf("%-16s %8.1f ns/call\n", "fixed point", fixed_ns);
+    printf("%-16s %8.1f ns/call\n", "double reference", float_ns);
+    return 0;
+}
@@ -0,0 +1,153 @@
+/*
+Round trip check and throughput of the telemetry page codec (telemetry_codec).
+-Encodes a synthetic trace of 1 minute samples: random walk temperature and humidity, a few rides a day with level changes,
+ and reboots. Every page is decoded again and compared sample by sample, any difference or a missed corruption fails the run.
+-Reports bytes per sample, how long the 0xF0000 byte partition lasts, and encode/decode speed.
+
+Usage: bench_telemetry [days, default 28]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "telemetry_codec.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define PARTITION_SIZE      (0xF0000)
+#define MINUTES_PER_DAY     (24 * 60)
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int clamp(int v, int lo, int hi)
+{
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+static void make_trace(telemetry_sample_t *trace, int n)
+{
+    int temperature = 80, humidity = 700;
+    uint32_t minute = 0;
+
+    srand(1);
+    for (int i = 0; i < n; i++) {
+        telemetry_sample_t *s = &trace[i];
+        int minute_of_day = i % MINUTES_PER_DAY;
+        bool riding = (minute_of_day >= 420 && minute_of_day < 480) || (minute_of_day >= 1020 && minute_of_day < 1110);
+
+        memset(s, 0, sizeof(*s));
+        minute += (rand() % 500 == 0) ? 1 + rand() % 600 : 1;     // now and then a power cut with a gap
+        s->minute = minute;
+        s->boot = i > 0 && trace[i - 1].minute + 1 != minute;
+        temperature = clamp(temperature + rand() % 5 - 2, -400, 800);
+        humidity = clamp(humidity + rand() % 9 - 4, 0, 1000);
+        s->temperature = temperature;
+        s->humidity = humidity;
+        s->on = riding;
+        s->mode = riding ? (uint8_t)(i / MINUTES_PER_DAY % 3) : 0;
+        for (int z = 0; z < TELEMETRY_ZONES; z++) {
+            s->pl[z] = riding ? (uint8_t)((minute_of_day / 15 + z) % 6) : 0;
+        }
+    }
+}
+
+static bool same(const telemetry_sample_t *a, const telemetry_sample_t *b)
+{
+    return a->minute == b->minute && a->boot == b->boot && a->temperature == b->temperature && a->humidity == b->humidity &&
+           a->on == b->on && a->mode == b->mode && memcmp(a->pl, b->pl, sizeof(a->pl)) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    int days = argc > 1 ? atoi(argv[1]) : 28;
+    int n = days * MINUTES_PER_DAY;
+    int max_pages = n / 2 + 1;
+    telemetry_sample_t *trace = malloc(n * sizeof(*trace));
+    uint8_t *flash = malloc((size_t)max_pages * TELEMETRY_PAGE_SIZE);
+    telemetry_sample_t decoded[TELEMETRY_PAGE_SAMPLES];
+    telemetry_page_t page;
+    int pages = 0;
+
+    if (days <= 0 || trace == NULL || flash == NULL) {
+        fprintf(stderr, "usage: %s [days]\n", argv[0]);
+        return 1;
+    }
+    make_trace(trace, n);
+
+    // encode
+    double start = now_ns();
+    telemetry_page_begin(&page, 0);
+    for (int i = 0; i < n; i++) {
+        if (!telemetry_page_add(&page, &trace[i])) {
+            telemetry_page_finish(&page);
+            memcpy(&flash[pages * TELEMETRY_PAGE_SIZE], page.buf, TELEMETRY_PAGE_SIZE);
+            telemetry_page_begin(&page, ++pages);
+            telemetry_page_add(&page, &trace[i]);
+        }
+    }
+    telemetry_page_finish(&page);
+    memcpy(&flash[pages * TELEMETRY_PAGE_SIZE], page.buf, TELEMETRY_PAGE_SIZE);
+    pages++;
+    double encode_ns = now_ns() - start;
+
+    // decode and compare
+    int k = 0;
+    start = now_ns();
+    for (int p = 0; p < pages; p++) {
+        uint32_t seq;
+        int count;
+        if (telemetry_page_decode(&flash[p * TELEMETRY_PAGE_SIZE], &seq, decoded, TELEMETRY_PAGE_SAMPLES, &count) != TELEMETRY_PAGE_OK ||
+            seq != (uint32_t)p) {
+            printf("FAIL: page %d does not decode\n", p);
+            return 1;
+        }
+        for (int i = 0; i < count; i++, k++) {
+            if (k >= n || !same(&decoded[i], &trace[k])) {
+                printf("FAIL: sample %d differs after the round trip\n", k);
+                return 1;
+            }
+        }
+    }
+    double decode_ns = now_ns() - start;
+    if (k != n) {
+        printf("FAIL: %d of %d samples decoded\n", k, n);
+        return 1;
+    }
+
+    // every single bit flip in a payload byte must be detected
+    uint8_t copy[TELEMETRY_PAGE_SIZE];
+    int missed = 0;
+    for (int byte = TELEMETRY_HEADER_SIZE; byte < TELEMETRY_PAGE_SIZE && flash[byte] != 0xFF; byte++) {
+        for (int bit = 0; bit < 8; bit++) {
+            uint32_t seq;
+            int count;
+            memcpy(copy, flash, sizeof(copy));
+            copy[byte] ^= 1 << bit;
+            missed += telemetry_page_decode(copy, &seq, decoded, TELEMETRY_PAGE_SAMPLES, &count) == TELEMETRY_PAGE_OK;
+        }
+    }
+    if (missed) {
+        printf("FAIL: %d bit flips not detected\n", missed);
+        return 1;
+    }
+
+    double bytes_per_sample = (double)pages * TELEMETRY_PAGE_SIZE / n;
+    printf("%d days, %d samples, %d pages, %.2f bytes/sample incl. headers and padding\n", days, n, pages, bytes_per_sample);
+    printf("0x%X byte partition holds %.0f days of 1 minute samples\n",
+           PARTITION_SIZE, PARTITION_SIZE / bytes_per_sample / MINUTES_PER_DAY);
+    printf("%-8s %8.1f ns/sample %8.1f MB/s\n", "encode", encode_ns / n, pages * TELEMETRY_PAGE_SIZE / encode_ns * 1e3);
+    printf("%-8s %8.1f ns/sample %8.1f MB/s\n", "decode", decode_ns / n, pages * TELEMETRY_PAGE_SIZE / decode_ns * 1e3);
+    printf("round trip and corruption checks passed\n");
+    free(trace);
+    free(flash);
+    return 0;
+}
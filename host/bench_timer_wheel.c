@@ -0,0 +1,224 @@
+/*
+Virtual clock check and cost of the timer wheel (timer_wheel).
+-Drives a few hundred timers through random starts, restarts and cancels, and advances the wheel in steps of one tick up to
+ several turns. A reference model checks every expiry: none early, none late, in expiry order, and none after a cancel.
+ Callbacks restart themselves and cancel other timers, as the firmware's windows do. Any difference fails the run.
+-Reports the cost of a start and a cancel with 10 to 10000 timers pending, and of advancing an idle wheel.
+
+Usage: bench_timer_wheel [virtual ticks, default 2000000]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "timer_wheel.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define CHECK_TIMERS        (300)
+#define DELAY_MAX           (5000)      // ticks, about 80 wheel turns
+#define COST_TIMERS_MAX     (10000)
+#define COST_ITERATIONS     (1000000)
+
+/**********************
+ *  TYPES
+ **********************/
+typedef struct {
+    tw_timer_t timer;
+    bool pending;               // reference model
+    uint32_t expiry;
+} check_timer_t;
+
+/**********************
+ *  VARIABLES
+ **********************/
+static tw_t wheel;
+static check_timer_t timers[CHECK_TIMERS];
+static uint32_t advance_from, advance_to;  // the advance running the callbacks
+static uint32_t last_fired;                // expiry of the previous callback in this advance
+static uint32_t rng = 2463534242u;
+static int errors;
+static uint32_t fired, restarted, cancelled_in_cb;
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static uint32_t rnd(uint32_t n)     // xorshift32, 0..n-1
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng % n;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void fail(const char *what, int i)
+{
+    if (errors++ < 10) {
+        printf("FAIL: timer %d %s, expiry %u, advance %u..%u\n", i, what, timers[i].expiry, advance_from, advance_to);
+    }
+}
+
+static void check_start(int i, uint32_t ticks)
+{
+    tw_add(&wheel, &timers[i].timer, ticks);
+    timers[i].pending = true;
+    timers[i].expiry = wheel.now + (ticks > 0 ? ticks : 1);
+}
+
+static void check_cancel(int i)
+{
+    tw_cancel(&wheel, &timers[i].timer);
+    timers[i].pending = false;
+}
+
+static void check_expired(void *ctx)
+{
+    check_timer_t *t = ctx;
+    int i = (int)(t - timers);
+
+    fired++;
+    if (!t->pending) {
+        fail("fired while not pending", i);
+    }
+    if ((int32_t)(t->expiry - advance_to) > 0) {
+        fail("fired early", i);
+    }
+    if ((int32_t)(t->expiry - advance_from) <= 0) {
+        fail("fired late", i);
+    }
+    if ((int32_t)(t->expiry - last_fired) < 0) {
+        fail("fired out of order", i);
+    }
+    last_fired = t->expiry;
+    t->pending = false;
+
+    switch (rnd(8)) {
+        case 0:                 // periodic window
+            check_start(i, 1 + rnd(DELAY_MAX));
+            restarted++;
+            break;
+        case 1: {               // ends another window, maybe one expiring in this same advance
+            int other = (int)rnd(CHECK_TIMERS);
+            if (timers[other].pending) {
+                cancelled_in_cb++;
+            }
+            check_cancel(other);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static int check(uint32_t ticks)
+{
+    uint32_t now = 0;
+
+    tw_init(&wheel, now);
+    for (int i = 0; i < CHECK_TIMERS; i++) {
+        tw_timer_init(&timers[i].timer, check_expired, &timers[i]);
+    }
+    while (now < ticks) {
+        for (int ops = rnd(4); ops > 0; ops--) {
+            int i = (int)rnd(CHECK_TIMERS);
+            if (rnd(4) == 0) {
+                check_cancel(i);
+            }
+            else {
+                check_start(i, rnd(8) == 0 ? rnd(TW_SLOTS) : rnd(DELAY_MAX));   // short ones too, and 0
+            }
+        }
+
+        uint32_t step = rnd(16) == 0 ? 1 + rnd(3 * TW_SLOTS) : 1;     // mostly one tick, sometimes several turns
+        advance_from = now;
+        advance_to = now + step;
+        last_fired = now;
+        tw_advance(&wheel, advance_to);
+        now = advance_to;
+
+        uint32_t pending = 0, next = 0;
+        bool any = false;
+        for (int i = 0; i < CHECK_TIMERS; i++) {
+            if (!timers[i].pending) {
+                continue;
+            }
+            pending++;
+            if ((int32_t)(timers[i].expiry - now) <= 0) {
+                fail("missed", i);
+                timers[i].pending = false;
+            }
+            else if (!any || timers[i].expiry - now < next) {
+                next = timers[i].expiry - now;
+                any = true;
+            }
+            if (tw_pending(&timers[i].timer) != timers[i].pending) {
+                fail("pending state differs", i);
+            }
+        }
+        uint32_t wheel_next;
+        if (wheel.stats.pending != pending || tw_next(&wheel, &wheel_next) != any || (any && wheel_next != next)) {
+            if (errors++ < 10) {
+                printf("FAIL: at %u the wheel has %u pending, next in %u, the model %u, next in %u\n",
+                       now, wheel.stats.pending, any ? wheel_next : 0, pending, next);
+            }
+        }
+    }
+    printf("virtual clock: %u ticks, %u starts, %u cancels, %u fired, %u restarted and %u cancelled from callbacks, "
+           "max %u pending\n", ticks, wheel.stats.added, wheel.stats.cancelled, fired, restarted, cancelled_in_cb,
+           wheel.stats.max_pending);
+    return errors;
+}
+
+static void nop(void *ctx)
+{
+}
+
+static void cost(void)
+{
+    static tw_timer_t background[COST_TIMERS_MAX];
+    tw_timer_t timer;
+
+    printf("%8s %16s %14s\n", "pending", "start+cancel ns", "idle tick ns");
+    for (int n = 10; n <= COST_TIMERS_MAX; n *= 10) {
+        tw_init(&wheel, 0);
+        for (int i = 0; i < n; i++) {       // spread over every slot, far beyond the measured ticks
+            tw_timer_init(&background[i], nop, NULL);
+            tw_add(&wheel, &background[i], 10 * COST_ITERATIONS + rnd(DELAY_MAX));
+        }
+        tw_timer_init(&timer, nop, NULL);
+
+        double start = now_ns();
+        for (int i = 0; i < COST_ITERATIONS; i++) {
+            tw_add(&wheel, &timer, 1 + (i & 1023));
+            tw_cancel(&wheel, &timer);
+        }
+        double add_ns = (now_ns() - start) / COST_ITERATIONS;
+
+        start = now_ns();
+        for (uint32_t t = 1; t <= COST_ITERATIONS; t++) {
+            tw_advance(&wheel, t);
+        }
+        double tick_ns = (now_ns() - start) / COST_ITERATIONS;
+        printf("%8d %16.1f %14.1f\n", n, add_ns, tick_ns);
+    }
+    printf("idle ticks visit one slot, timers of later turns in it are skipped: the tick cost grows with pending / %d\n", TW_SLOTS);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t ticks = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 2000000;
+
+    if (check(ticks) != 0) {
+        printf("FAIL: %d errors\n", errors);
+        return 1;
+    }
+    cost();
+    return 0;
+}
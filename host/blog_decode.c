@@ -0,0 +1,99 @@
+/*
+Decoder of the deferred binary log (main/blog.c, built with CONFIG_BLOG_BINARY).
+-Reads a console capture and turns every "#B <ms> <tag> <fmt> [args]" line back into the text ESP_LOGI would have printed.
+ Tag, format and %s arguments are addresses of string constants, they are read from the firmware ELF file.
+-Any other line is passed through unchanged, so a capture with regular ESP_LOGx output decodes as a whole.
+-The ELF must be the one running on the device, else the addresses point to the wrong strings.
+-The string lookup and the record formatting are in blog_format.c.
+
+Usage: blog_decode build/touch_element_waterproof.elf [capture.txt, default stdin]
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "blog_format.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define LINE_MAX_LEN        (1024)
+#define ARGS_MAX            (4)         // BLOG_ARGS_MAX
+
+/**********************
+ *  VARIABLES
+ **********************/
+static blog_elf_t elf;
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static int elf_load(const char *path)     // read the whole file, the strings point into it
+{
+    FILE *f = fopen(path, "rb");
+
+    if (f == NULL) {
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    size_t size = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *image = malloc(size);
+    if (image == NULL || fread(image, 1, size, f) != size) {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return blog_elf_parse(&elf, image, size);
+}
+
+static int decode_line(const char *line)     // 1 if it was a binary record
+{
+    uint32_t ms, tag, fmt, args[ARGS_MAX] = {0};
+    int n_args = 0, used;
+    char text[LINE_MAX_LEN];
+
+    if (strncmp(line, "#B ", 3) != 0 || sscanf(line + 3, "%x %x %x%n", &ms, &tag, &fmt, &used) != 3) {
+        return 0;
+    }
+    const char *p = line + 3 + used;
+    while (n_args < ARGS_MAX && sscanf(p, "%x%n", &args[n_args], &used) == 1) {
+        n_args++;
+        p += used;
+    }
+
+    const char *tag_s = blog_elf_string(&elf, tag), *fmt_s = blog_elf_string(&elf, fmt);
+    if (fmt_s == NULL) {
+        printf("I (%u) ?: <unknown format 0x%08x, wrong ELF?>\n", ms, fmt);
+        return 1;
+    }
+    blog_format(text, sizeof(text), &elf, fmt_s, args, n_args);
+    printf("I (%u) %s: %s\n", ms, tag_s ? tag_s : "?", text);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    char line[LINE_MAX_LEN];
+    FILE *in = stdin;
+    unsigned records = 0;
+
+    if (argc < 2 || elf_load(argv[1]) != 0) {
+        fprintf(stderr, "usage: %s <firmware.elf> [capture.txt]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 2 && (in = fopen(argv[2], "r")) == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), in)) {
+        if (decode_line(line)) {
+            records++;
+        }
+        else {
+            fputs(line, stdout);
+        }
+    }
+    fprintf(stderr, "%u binary records decoded\n", records);
+    return 0;
+}
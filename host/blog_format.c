@@ -0,0 +1,130 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdio.h>
+#include <string.h>
+#include "blog_format.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define SHT_NOBITS          (8)
+#define SHF_ALLOC           (0x2)
+
+/**********************
+ *  ELF
+ **********************/
+static uint32_t rd32(const blog_elf_t *elf, size_t off)
+{
+    if (off + 4 > elf->size) {
+        return 0;
+    }
+    const uint8_t *p = &elf->image[off];
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint16_t rd16(const blog_elf_t *elf, size_t off)
+{
+    if (off + 2 > elf->size) {
+        return 0;
+    }
+    const uint8_t *p = &elf->image[off];
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+int blog_elf_parse(blog_elf_t *elf, const uint8_t *image, size_t size)     // keep the loaded sections with file contents
+{
+    elf->image = image;
+    elf->size = size;
+    elf->n_sections = 0;
+    if (size < 52 || memcmp(image, "\x7f" "ELF", 4) != 0 || image[4] != 1 || image[5] != 1) {
+        return -1;      // not ELF32 little endian
+    }
+
+    uint32_t shoff = rd32(elf, 32);
+    uint16_t shentsize = rd16(elf, 46), shnum = rd16(elf, 48);
+    for (int i = 0; i < shnum && elf->n_sections < BLOG_SECTIONS_MAX; i++) {
+        size_t sh = shoff + (size_t)i * shentsize;
+        uint32_t type = rd32(elf, sh + 4), flags = rd32(elf, sh + 8);
+        if ((flags & SHF_ALLOC) && type != SHT_NOBITS && rd32(elf, sh + 20) > 0) {
+            elf->sections[elf->n_sections++] = (blog_section_t){ .addr = rd32(elf, sh + 12), .offset = rd32(elf, sh + 16), .size = rd32(elf, sh + 20) };
+        }
+    }
+    return 0;
+}
+
+const char *blog_elf_string(const blog_elf_t *elf, uint32_t addr)
+{
+    for (int i = 0; i < elf->n_sections; i++) {
+        const blog_section_t *s = &elf->sections[i];
+        if (addr >= s->addr && addr - s->addr < s->size && (size_t)s->offset + s->size <= elf->size) {
+            const char *p = (const char *)&elf->image[s->offset + (addr - s->addr)];
+            if (memchr(p, '\0', s->size - (addr - s->addr)) != NULL) {
+                return p;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**********************
+ *  FORMAT
+ **********************/
+void blog_format(char *out, size_t size, const blog_elf_t *elf, const char *fmt, const uint32_t *args, int n_args)   // one conversion at a time
+{
+    size_t len = 0;
+    int arg = 0;
+
+    while (*fmt && len + 1 < size) {
+        if (*fmt != '%') {
+            out[len++] = *fmt++;
+            continue;
+        }
+        if (fmt[1] == '%') {
+            out[len++] = '%';
+            fmt += 2;
+            continue;
+        }
+
+        char spec[32];
+        size_t n = 0;
+        spec[n++] = *fmt++;
+        while (*fmt && strchr("-+ #0123456789.", *fmt) && n < sizeof(spec) - 3) {
+            spec[n++] = *fmt++;
+        }
+        while (*fmt && strchr("hlzjt", *fmt)) {
+            fmt++;      // length modifiers: every argument is one 32 bit word
+        }
+        char conv = *fmt ? *fmt++ : 'd';
+        uint32_t v = arg < n_args ? args[arg] : 0;
+        arg++;
+
+        int w;
+        if (conv == 's') {
+            const char *str = blog_elf_string(elf, v);
+            spec[n++] = 's';
+            spec[n] = '\0';
+            w = snprintf(&out[len], size - len, spec, str ? str : "<?>");
+        }
+        else if (conv == 'd' || conv == 'i') {
+            spec[n++] = 'd';
+            spec[n] = '\0';
+            w = snprintf(&out[len], size - len, spec, (int32_t)v);
+        }
+        else if (strchr("uxXoc", conv)) {
+            spec[n++] = conv;
+            spec[n] = '\0';
+            w = snprintf(&out[len], size - len, spec, v);
+        }
+        else if (conv == 'p') {
+            w = snprintf(&out[len], size - len, "0x%08x", v);
+        }
+        else {
+            w = snprintf(&out[len], size - len, "<%%%c>", conv);
+        }
+        if (w > 0) {
+            len += (size_t)w < size - len ? (size_t)w : size - len - 1;
+        }
+    }
+    out[len] = '\0';
+}
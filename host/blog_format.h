@@ -0,0 +1,49 @@
+/*
+Host side of the deferred binary log (main/blog.c built with CONFIG_BLOG_BINARY):
+-Tag, format and %s arguments of a record are addresses of string constants, they are read from the loaded sections of the
+ firmware ELF file.
+-A record is formatted one printf conversion at a time, every argument is one 32 bit word as stored by BLOG().
+-Plain C on an ELF image in memory, used by blog_decode and tested by test_blog_format.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+#define BLOG_SECTIONS_MAX       (256)
+
+/**********************
+ *  TYPES
+ **********************/
+typedef struct {
+    uint32_t addr;
+    uint32_t size;
+    uint32_t offset;
+} blog_section_t;
+
+typedef struct {
+    const uint8_t *image;           // contents of the ELF file
+    size_t size;
+    blog_section_t sections[BLOG_SECTIONS_MAX];    // loaded sections with file contents
+    int n_sections;
+} blog_elf_t;
+
+/**
+ * Parse the section table of a 32 bit little endian ELF image. The image must stay valid while the strings are used.
+ * Returns 0, or -1 when the image is not ELF32 little endian.
+ */
+int blog_elf_parse(blog_elf_t *elf, const uint8_t *image, size_t size);
+
+/**
+ * String constant at a target address, NULL if the address is not in a loaded section or the string runs past its end.
+ */
+const char *blog_elf_string(const blog_elf_t *elf, uint32_t addr);
+
+/**
+ * Format a record like printf. Length modifiers are dropped, %s arguments are looked up with blog_elf_string(), "<?>" when
+ * not found. Unknown conversions print as "<%c>" and missing arguments as 0. The output is truncated to size - 1 characters.
+ */
+void blog_format(char *out, size_t size, const blog_elf_t *elf, const char *fmt, const uint32_t *args, int n_args);
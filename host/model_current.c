@@ -0,0 +1,184 @@
+/*
+Supply current model of the five heater Mosfets over one PWM period.
+-Duties come from heater_compute() in Manual mode, zone currents from the element power at 12 V (same zones as sim_heater).
+-Compares all heaters switching on at hpoint 0 against the offsets from pwm_phase_plan(), as the firmware applies them.
+-Reports peak and RMS supply current for one set of power levels, or the worst and mean over all 6^4 combinations.
+
+Usage: model_current [<backrest> <passenger> <driver> <grips>]   (power levels 0-5, no arguments sweeps all)
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "heater_logic.h"
+#include "pwm_phase.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define PERIOD              (1 << 13)   // 13 bit PWM, timer counts per period
+#define SUPPLY_V            (12.0)
+#define HEATER_FIRST        HEATER_MODE_NUM     // duty index of the first heater zone
+#define HEATER_NUM          HEATER_ZONE_NUM
+
+/**********************
+ *  LOAD MODEL
+ **********************/
+typedef struct {
+    const char *name;
+    double power_w;     // element power at 100% duty
+} model_zone_t;
+
+static const model_zone_t zones[HEATER_NUM] = {     // in zone table order
+    { "backrest",  40.0 },
+    { "passenger", 50.0 },
+    { "driver",    50.0 },
+    { "grips",     40.0 },
+    { "thumb",     10.0 },
+};
+
+typedef struct {
+    double peak;        // A
+    double rms;         // A
+    double mean;        // A, the same with and without staggering
+} model_current_t;
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static void model_duties(int back, int pass, int driver, int grips, uint32_t duty[HEATER_NUM])
+{
+    heater_state_t state;
+    heater_outputs_t out;
+
+    memset(&state, 0, sizeof(state));
+    state.on_off_b_state = 1;
+    state.mode_b_state = MODE_MANUAL;
+    state.level_b_state[0] = back;
+    state.level_b_state[1] = pass;
+    state.level_b_state[2] = driver;
+    state.level_b_state[3] = grips;
+    heater_compute(&state, &out);
+    memcpy(duty, &out.duty[HEATER_FIRST], HEATER_NUM * sizeof(uint32_t));
+}
+
+static model_current_t model_run(const uint32_t duty[HEATER_NUM], const uint32_t hpoint[HEATER_NUM])
+{
+    static double current[PERIOD];
+    model_current_t r = { 0 };
+    double sum_sq = 0;
+
+    memset(current, 0, sizeof(current));
+    for (int z = 0; z < HEATER_NUM; z++) {
+        double amps = zones[z].power_w / SUPPLY_V;
+        uint32_t end = hpoint[z] + duty[z];
+        for (uint32_t c = hpoint[z]; c < end && c < PERIOD; c++) {
+            current[c] += amps;
+        }
+    }
+    for (int c = 0; c < PERIOD; c++) {
+        if (current[c] > r.peak) {
+            r.peak = current[c];
+        }
+        r.mean += current[c];
+        sum_sq += current[c] * current[c];
+    }
+    r.mean /= PERIOD;
+    r.rms = sqrt(sum_sq / PERIOD);
+    return r;
+}
+
+static void model_compare(const uint32_t duty[HEATER_NUM], model_current_t *before, model_current_t *after)
+{
+    uint32_t hpoint[HEATER_NUM] = { 0 };
+
+    *before = model_run(duty, hpoint);
+    pwm_phase_plan(duty, hpoint, HEATER_NUM, PERIOD);
+    *after = model_run(duty, hpoint);
+}
+
+static int model_single(int back, int pass, int driver, int grips)
+{
+    uint32_t duty[HEATER_NUM];
+    uint32_t hpoint[HEATER_NUM];
+    model_current_t before, after;
+
+    model_duties(back, pass, driver, grips, duty);
+    pwm_phase_plan(duty, hpoint, HEATER_NUM, PERIOD);
+    model_compare(duty, &before, &after);
+
+    printf("%-10s %6s %6s %6s\n", "zone", "duty", "hpoint", "A");
+    for (int z = 0; z < HEATER_NUM; z++) {
+        printf("%-10s %6u %6u %6.2f\n", zones[z].name, (unsigned)duty[z], (unsigned)hpoint[z], zones[z].power_w / SUPPLY_V);
+    }
+    printf("\n%-12s %8s %8s %8s\n", "", "peak A", "RMS A", "mean A");
+    printf("%-12s %8.2f %8.2f %8.2f\n", "hpoint 0", before.peak, before.rms, before.mean);
+    printf("%-12s %8.2f %8.2f %8.2f\n", "staggered", after.peak, after.rms, after.mean);
+    return 0;
+}
+
+static int model_sweep(void)
+{
+    double worst_before = 0, worst_after = 0;
+    double sum_peak_before = 0, sum_peak_after = 0;
+    double sum_rms_before = 0, sum_rms_after = 0;
+    double best_cut = 0;
+    int best[4] = { 0 };
+    int n = 0;
+
+    for (int back = 0; back < HEATER_LEVEL_NUM; back++) {
+        for (int pass = 0; pass < HEATER_LEVEL_NUM; pass++) {
+            for (int driver = 0; driver < HEATER_LEVEL_NUM; driver++) {
+                for (int grips = 0; grips < HEATER_LEVEL_NUM; grips++) {
+                    uint32_t duty[HEATER_NUM];
+                    model_current_t before, after;
+
+                    model_duties(back, pass, driver, grips, duty);
+                    model_compare(duty, &before, &after);
+                    worst_before = fmax(worst_before, before.peak);
+                    worst_after = fmax(worst_after, after.peak);
+                    sum_peak_before += before.peak;
+                    sum_peak_after += after.peak;
+                    sum_rms_before += before.rms;
+                    sum_rms_after += after.rms;
+                    if (before.peak - after.peak > best_cut) {
+                        best_cut = before.peak - after.peak;
+                        best[0] = back;
+                        best[1] = pass;
+                        best[2] = driver;
+                        best[3] = grips;
+                    }
+                    n++;
+                }
+            }
+        }
+    }
+
+    printf("%d power level combinations\n", n);
+    printf("%-12s %10s %10s %10s\n", "", "worst peak", "mean peak", "mean RMS");
+    printf("%-12s %10.2f %10.2f %10.2f\n", "hpoint 0", worst_before, sum_peak_before / n, sum_rms_before / n);
+    printf("%-12s %10.2f %10.2f %10.2f\n", "staggered", worst_after, sum_peak_after / n, sum_rms_after / n);
+    printf("largest peak cut %.2f A at levels back %d pass %d driver %d grips %d\n",
+           best_cut, best[0], best[1], best[2], best[3]);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 5) {
+        int level[4];
+        for (int i = 0; i < 4; i++) {
+            level[i] = atoi(argv[i + 1]);
+            if (level[i] < 0 || level[i] >= HEATER_LEVEL_NUM) {
+                fprintf(stderr, "power levels are 0-%d\n", HEATER_LEVEL_NUM - 1);
+                return 1;
+            }
+        }
+        return model_single(level[0], level[1], level[2], level[3]);
+    }
+    if (argc != 1) {
+        fprintf(stderr, "usage: %s [<backrest> <passenger> <driver> <grips>]\n", argv[0]);
+        return 1;
+    }
+    return model_sweep();
+}
@@ -0,0 +1,284 @@
+/*
+Replay benchmark of the touch detection (touch_adapt) over recorded or synthetic touch traces.
+-Every trace runs through a set of detector settings: fixed sensitivities like the touch element library's 0.15, and the adaptive
+ baseline/noise tracker with different sensitivities, debounce and water rejection.
+-Reports per setting: touches detected, detection latency (mean and max, from the touch start to the press event),
+ false presses per hour (a press on a pad that was not touched) and samples rejected as water.
+-Synthetic scenarios (30 minutes at the 20 ms recorder rate, 6 pads, known touches):
+ dry: bare fingers, low noise. rain: bare fingers, drops and splashes over several pads, a water film raising the readings.
+ glove: gloved fingers with a third of the signal, low noise.
+-Recorded traces come from the console 'touch rec on' output: "#T t_ms,raw0..raw5,base0..base5[,truth]". truth is an optional
+ bit mask of the pads really touched, e.g. annotated by hand or from a test jig. Without it the trace counts as untouched,
+ use that for rain or vibration recordings: every press is then a false one.
+
+Usage: replay_touch [dry|rain|glove|all|<trace.txt>]
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "touch_adapt.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define TRACE_CH            (6)         // pads in the firmware, TOUCH_BUTTON_NUM
+#define TRACE_STEP_MS       (20)        // recorder and detector period, TOUCH_TUNE_PERIOD_MS
+#define TRACE_MINUTES       (30)        // synthetic scenario length
+#define TRACE_ROWS_MAX      (TRACE_MINUTES * 60 * 1000 / TRACE_STEP_MS + 1)
+
+/**********************
+ *  TYPES
+ **********************/
+typedef struct {
+    uint32_t t_ms;
+    uint32_t raw[TRACE_CH];
+    uint32_t truth;             // bit mask of the pads touched
+} trace_row_t;
+
+typedef struct {
+    trace_row_t *rows;
+    int count;
+    int touches;                // rising truth edges
+} trace_t;
+
+typedef struct {
+    const char *name;
+    double noise;               // noise sigma, share of the baseline
+    double drops_per_s;         // water drops per pad
+    double film;                // reading rise from a water film, share of the baseline
+    double amp_min, amp_max;    // touch signal, share of the baseline
+} scenario_t;
+
+typedef struct {
+    const char *name;
+    touch_adapt_config_t config;
+} setting_t;
+
+typedef struct {
+    int detected;
+    int false_presses;
+    uint64_t latency_sum;
+    uint32_t latency_max;
+    uint32_t water;
+} result_t;
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const scenario_t scenarios[] = {
+    { "dry",   0.002, 0.0,  0.00, 0.12, 0.30 },
+    { "rain",  0.004, 0.15, 0.03, 0.12, 0.30 },
+    { "glove", 0.002, 0.0,  0.00, 0.04, 0.09 },
+};
+#define SCENARIO_NUM ((int)(sizeof(scenarios) / sizeof(scenarios[0])))
+
+static const setting_t settings[] = {
+    // sens, noise factor, debounce, release %, baseline shift, water pads, wet sens, wet hold, long press, stuck
+    { "fixed 15%",            { 150, 0, 1, 60, 7, 0,   0,     0, 1000,     0 } },
+    { "fixed 5%",             {  50, 0, 1, 60, 7, 0,   0,     0, 1000,     0 } },
+    { "adaptive 3% (default)", TOUCH_ADAPT_DEFAULT_CONFIG() },
+    { "adaptive 5%",          {  50, 8, 2, 60, 7, 2, 120, 30000, 1000, 20000 } },
+    { "adaptive 8%",          {  80, 8, 2, 60, 7, 2, 120, 30000, 1000, 20000 } },
+    { "adaptive 3% deb 3",    {  30, 8, 3, 60, 7, 2, 120, 30000, 1000, 20000 } },
+    { "adaptive 3% wet 8%",   {  30, 8, 2, 60, 7, 2,  80, 30000, 1000, 20000 } },
+    { "adaptive 3% no water", {  30, 8, 2, 60, 7, 0,   0,     0, 1000, 20000 } },
+};
+#define SETTING_NUM ((int)(sizeof(settings) / sizeof(settings[0])))
+
+/**********************
+ *  TRACES
+ **********************/
+static double uniform(double lo, double hi)
+{
+    return lo + (hi - lo) * rand() / (double)RAND_MAX;
+}
+
+static double gauss(void)       // Box-Muller
+{
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u)) * cos(2 * M_PI * v);
+}
+
+static double ramp(double t, double start, double end, double edge)   // 0..1 with linear edges
+{
+    if (t < start || t >= end) {
+        return 0.0;
+    }
+    double r = fmin((t - start) / edge, (end - t) / edge);
+    return r < 1.0 ? r : 1.0;
+}
+
+static trace_t make_trace(const scenario_t *s)
+{
+    trace_t trace = { calloc(TRACE_ROWS_MAX, sizeof(trace_row_t)), 0, 0 };
+    double touch_start = 5.0, touch_end = 0.0, touch_amp = 0.0;
+    double drop_end[TRACE_CH] = {0}, drop_amp[TRACE_CH] = {0}, drop_len[TRACE_CH] = {0};
+    int touch_pad = 0;
+
+    srand(7);
+    for (int r = 0; r < TRACE_ROWS_MAX; r++) {
+        trace_row_t *row = &trace.rows[trace.count++];
+        double t = r * TRACE_STEP_MS / 1000.0;
+        row->t_ms = r * TRACE_STEP_MS;
+
+        if (t >= touch_start && touch_end < touch_start) {      // next touch
+            touch_pad = rand() % TRACE_CH;
+            touch_end = touch_start + (rand() % 5 == 0 ? uniform(1.2, 2.5) : uniform(0.15, 0.8));
+            touch_amp = uniform(s->amp_min, s->amp_max);
+            trace.touches++;
+        }
+        if (t >= touch_end && touch_end >= touch_start) {
+            touch_start = t + uniform(8.0, 20.0);
+        }
+        for (int ch = 0; ch < TRACE_CH; ch++) {
+            if (s->drops_per_s > 0 && t >= drop_end[ch] && uniform(0, 1) < s->drops_per_s * TRACE_STEP_MS / 1000.0) {
+                double amp = uniform(0.02, 0.10), len = uniform(0.06, 0.4);
+                int spread = rand() % 2 ? 1 + rand() % 3 : 0;         // a splash wets the neighbouring pads too
+                for (int k = 0; k <= spread; k++) {
+                    int c = (ch + k) % TRACE_CH;
+                    drop_end[c] = t + len;
+                    drop_len[c] = len;
+                    drop_amp[c] = amp * (k ? 0.8 : 1.0);
+                }
+            }
+        }
+        for (int ch = 0; ch < TRACE_CH; ch++) {
+            double base = (18000.0 + 1500.0 * ch) * (1.0 + 0.03 * sin(2 * M_PI * t / 1200.0));
+            double v = base * (1.0 + s->noise * gauss() + s->film * fmin(t / 300.0, 1.0));
+            if (ch == touch_pad) {
+                v += base * touch_amp * ramp(t, touch_start, touch_end, 0.04);
+            }
+            if (t < drop_end[ch]) {
+                v += base * drop_amp[ch] * (drop_end[ch] - t) / drop_len[ch];
+            }
+            row->raw[ch] = (uint32_t)v;
+        }
+        if (t >= touch_start && t < touch_end) {
+            row->truth = 1u << touch_pad;
+        }
+    }
+    return trace;
+}
+
+static int load_trace(const char *path, trace_t *trace)   // console capture of 'touch rec on', other lines are skipped
+{
+    FILE *f = fopen(path, "r");
+    char line[512];
+
+    if (f == NULL) {
+        return -1;
+    }
+    trace->rows = calloc(TRACE_ROWS_MAX, sizeof(trace_row_t));
+    trace->count = 0;
+    trace->touches = 0;
+    while (fgets(line, sizeof(line), f) && trace->count < TRACE_ROWS_MAX) {
+        const char *p = strncmp(line, "#T ", 3) == 0 ? line + 3 : line;
+        uint32_t v[2 * TRACE_CH + 2];
+        int n = 0, used;
+        while (n < 2 * TRACE_CH + 2 && sscanf(p, "%u%n", &v[n], &used) == 1) {
+            n++;
+            p += used;
+            if (*p == ',') {
+                p++;
+            }
+        }
+        if (n < 1 + 2 * TRACE_CH) {
+            continue;
+        }
+        trace_row_t *row = &trace->rows[trace->count++];
+        row->t_ms = v[0];
+        memcpy(row->raw, &v[1], sizeof(row->raw));      // the hardware benchmark columns are not used
+        row->truth = n > 1 + 2 * TRACE_CH ? v[1 + 2 * TRACE_CH] : 0;
+        if (trace->count > 1) {
+            trace->touches += __builtin_popcount(row->truth & ~trace->rows[trace->count - 2].truth);
+        }
+    }
+    fclose(f);
+    return trace->count > 0 ? 0 : -1;
+}
+
+/**********************
+ *  REPLAY
+ **********************/
+static result_t replay(const trace_t *trace, const touch_adapt_config_t *config)
+{
+    touch_adapt_t t;
+    touch_adapt_event_t events[TRACE_CH];
+    uint32_t start[TRACE_CH] = {0};
+    bool matched[TRACE_CH] = {0};
+    result_t res = {0};
+
+    touch_adapt_init(&t, config, TRACE_CH, trace->rows[0].raw);
+    for (int r = 0; r < trace->count; r++) {
+        const trace_row_t *row = &trace->rows[r];
+        uint32_t prev = r ? trace->rows[r - 1].truth : 0;
+        for (int ch = 0; ch < TRACE_CH; ch++) {
+            if ((row->truth & ~prev) & 1u << ch) {
+                start[ch] = row->t_ms;
+                matched[ch] = false;
+            }
+        }
+
+        touch_adapt_step(&t, row->raw, row->t_ms, events);
+        for (int ch = 0; ch < TRACE_CH; ch++) {
+            if (events[ch] != TOUCH_ADAPT_PRESS) {
+                continue;
+            }
+            if ((row->truth & 1u << ch) && !matched[ch]) {
+                uint32_t latency = row->t_ms - start[ch];
+                matched[ch] = true;
+                res.detected++;
+                res.latency_sum += latency;
+                if (latency > res.latency_max) {
+                    res.latency_max = latency;
+                }
+            }
+            else {
+                res.false_presses++;        // untouched pad, or a second press within one touch
+            }
+        }
+    }
+    res.water = t.water;
+    return res;
+}
+
+static void report(const char *name, const trace_t *trace)
+{
+    double hours = trace->rows[trace->count - 1].t_ms / 3600000.0;
+
+    printf("\n%s: %d touches in %.1f min\n", name, trace->touches, hours * 60);
+    printf("%-24s %9s %10s %10s %10s %8s\n", "setting", "detected", "latency ms", "max ms", "false/h", "water");
+    for (int i = 0; i < SETTING_NUM; i++) {
+        result_t res = replay(trace, &settings[i].config);
+        double pct = trace->touches ? 100.0 * res.detected / trace->touches : 0.0;
+        printf("%-24s %8.1f%% %10.0f %10u %10.1f %8u\n", settings[i].name, pct,
+               res.detected ? (double)res.latency_sum / res.detected : 0.0, res.latency_max,
+               hours > 0 ? res.false_presses / hours : 0.0, res.water);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *which = argc > 1 ? argv[1] : "all";
+    int runs = 0;
+
+    for (int i = 0; i < SCENARIO_NUM; i++) {
+        if (strcmp(which, "all") == 0 || strcmp(which, scenarios[i].name) == 0) {
+            trace_t trace = make_trace(&scenarios[i]);
+            report(scenarios[i].name, &trace);
+            free(trace.rows);
+            runs++;
+        }
+    }
+    if (runs == 0) {
+        trace_t trace;
+        if (load_trace(which, &trace) != 0) {
+            fprintf(stderr, "usage: %s [dry|rain|glove|all|<trace.txt>]\n", argv[0]);
+            return 1;
+        }
+        report(which, &trace);
+        free(trace.rows);
+    }
+    return 0;
+}
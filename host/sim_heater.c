@@ -0,0 +1,328 @@
+/*
+Virtual-time scenario simulator for the heater control logic.
+-Runs heater_logic against a simple thermal/humidity plant model on a virtual 1 s clock.
+-The boost, override and auto-off timers of the logic run on the firmware's timer wheel, one tick per virtual second.
+-Ambient temperature and humidity come from a built-in scenario or a replayed CSV trace (t_s,temp_c,rh_pct).
+-Reports energy used, time above the 90% humidity threshold, time with a boost window running and the number of output changes
+ per mode, next to an unheated reference run.
+
+Usage: sim_heater [ride|parking|<trace.csv>] [auto|manual|dewpoint|all] [manual level 0-5]
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "heater_logic.h"
+#include "timer_wheel.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define SIM_STEP_S          (1)         // virtual clock resolution
+#define SIM_SENSOR_S        (5)         // DHT22 sample period, as in the firmware
+#define SIM_TICK_S          (60)        // control tick period, as in the firmware
+#define SIM_RH_LIMIT        (90.0)      // humidity threshold of the control logic
+#define SIM_TRACE_MAX       (100000)    // trace points
+
+#define DUTY_MAX            (8191.0)    // 13 bit PWM
+
+/**********************
+ *  PLANT MODEL
+ **********************/
+typedef struct {
+    const char *name;
+    int channel;        // heater_outputs_t duty index driving the zone
+    double power_w;     // element power at 100% duty
+    double heat_cap;    // J/K, element and surface
+    double loss;        // W/K to ambient
+} sim_zone_t;
+
+static const sim_zone_t zones[] = {
+    { "thumb",     HEATER_MODE_NUM + 4, 10.0,  60.0, 0.8 },
+    { "grips",     HEATER_MODE_NUM + 3, 40.0, 250.0, 2.0 },
+    { "driver",    HEATER_MODE_NUM + 2, 50.0, 900.0, 2.5 },
+    { "passenger", HEATER_MODE_NUM + 1, 50.0, 900.0, 2.5 },
+    { "backrest",  HEATER_MODE_NUM + 0, 40.0, 700.0, 2.0 },
+};
+#define SIM_ZONE_NUM ((int)(sizeof(zones) / sizeof(zones[0])))
+
+typedef struct {
+    double t;           // s
+    double temp;        // C
+    double rh;          // %
+} sim_point_t;
+
+typedef struct {
+    sim_point_t *points;
+    int count;
+    double duration;    // s
+} sim_trace_t;
+
+typedef struct {
+    uint32_t duty[HEATER_CH_NUM];
+    uint32_t changes;           // channel duty changes handed to the outputs
+    uint32_t applies;           // HAL apply calls
+} sim_outputs_t;
+
+typedef struct sim_hal sim_hal_t;
+
+typedef struct {
+    sim_hal_t *hal;
+    heater_timer_t id;
+} sim_timer_ref_t;
+
+struct sim_hal {
+    sim_outputs_t outputs;
+    heater_t *heater;
+    tw_t wheel;                 // ticks are virtual seconds
+    tw_timer_t timer[HEATER_TIMER_NUM];
+    sim_timer_ref_t ref[HEATER_TIMER_NUM];
+};
+
+typedef struct {
+    double energy_wh;
+    double ambient_humid_s;     // ambient RH >= limit
+    double surface_humid_s;     // RH at the coldest heated surface >= limit, condensation risk
+    double boost_s;             // any zone in its boost window
+    uint32_t changes;
+    uint32_t steps;
+} sim_result_t;
+
+static double saturation_hpa(double temp)   // Magnus formula
+{
+    return 6.112 * exp(17.62 * temp / (243.12 + temp));
+}
+
+/**********************
+ *  HAL
+ **********************/
+static void sim_apply(void *ctx, const heater_outputs_t *out)
+{
+    sim_outputs_t *o = &((sim_hal_t *)ctx)->outputs;
+
+    for (int ch = 0; ch < HEATER_CH_NUM; ch++) {
+        if (o->duty[ch] != out->duty[ch]) {
+            o->changes++;
+            o->duty[ch] = out->duty[ch];
+        }
+    }
+    o->applies++;
+}
+
+static void sim_save(void *ctx, const heater_state_t *state)
+{
+}
+
+static void sim_expired(void *ctx)     // wheel callback: the expiry goes to the logic right away, the firmware posts it as an event
+{
+    sim_timer_ref_t *ref = ctx;
+    control_event_t event = { .type = CONTROL_EVT_TIMER, .timer = ref->id };
+
+    heater_step(ref->hal->heater, &event);
+}
+
+static void sim_timer(void *ctx, heater_timer_t timer, uint32_t seconds)
+{
+    sim_hal_t *h = ctx;
+
+    if (seconds == 0) {
+        tw_cancel(&h->wheel, &h->timer[timer]);
+    }
+    else {
+        tw_add(&h->wheel, &h->timer[timer], seconds);
+    }
+}
+
+/**********************
+ *  TRACES
+ **********************/
+static sim_trace_t scenario_ride(void)      // 24 h: diurnal temperature, humidity in anti-phase, a rain shower in the evening
+{
+    static sim_point_t points[24 * 60 + 1];
+    sim_trace_t trace = { points, 0, 24 * 3600.0 };
+
+    for (int m = 0; m <= 24 * 60; m++) {
+        double h = m / 60.0;
+        double day = sin((h - 9.0) / 24.0 * 2 * M_PI);
+        double rh = 75.0 - 18.0 * day;
+        if (h >= 18.0 && h < 20.5) {
+            rh = 97.0;
+        }
+        points[trace.count++] = (sim_point_t){ m * 60.0, 11.0 + 8.0 * day, rh > 99.0 ? 99.0 : rh };
+    }
+    return trace;
+}
+
+static sim_trace_t scenario_parking(void)   // 12 h overnight: cooling towards the dew point, humidity rising
+{
+    static sim_point_t points[12 * 60 + 1];
+    sim_trace_t trace = { points, 0, 12 * 3600.0 };
+
+    for (int m = 0; m <= 12 * 60; m++) {
+        double f = m / (12.0 * 60);
+        double rh = 80.0 + 20.0 * sqrt(f);
+        points[trace.count++] = (sim_point_t){ m * 60.0, 10.0 - 9.0 * f, rh > 99.0 ? 99.0 : rh };
+    }
+    return trace;
+}
+
+static int trace_load(const char *path, sim_trace_t *trace)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    trace->points = malloc(SIM_TRACE_MAX * sizeof(sim_point_t));
+    trace->count = 0;
+
+    char line[128];
+    while (fgets(line, sizeof(line), f) != NULL && trace->count < SIM_TRACE_MAX) {
+        sim_point_t p;
+        if (sscanf(line, "%lf,%lf,%lf", &p.t, &p.temp, &p.rh) == 3) {   // header and comment lines are skipped
+            trace->points[trace->count++] = p;
+        }
+    }
+    fclose(f);
+    if (trace->count < 2) {
+        return -1;
+    }
+    trace->duration = trace->points[trace->count - 1].t - trace->points[0].t;
+    return 0;
+}
+
+static sim_point_t trace_at(const sim_trace_t *trace, double t, int *cursor)   // linear interpolation, cursor only moves forward
+{
+    const sim_point_t *p = trace->points;
+    t += p[0].t;
+
+    while (*cursor < trace->count - 2 && p[*cursor + 1].t <= t) {
+        (*cursor)++;
+    }
+    const sim_point_t *a = &p[*cursor];
+    const sim_point_t *b = &p[*cursor + 1];
+    double f = (b->t > a->t) ? (t - a->t) / (b->t - a->t) : 0.0;
+    if (f > 1.0) {
+        f = 1.0;
+    }
+    return (sim_point_t){ t, a->temp + f * (b->temp - a->temp), a->rh + f * (b->rh - a->rh) };
+}
+
+/**********************
+ *  SIMULATION
+ **********************/
+static sim_result_t simulate(const sim_trace_t *trace, bool on, heater_mode_t mode, int manual_level)
+{
+    static sim_hal_t sim;
+    sim_result_t result = {0};
+    const heater_hal_t hal = {
+        .apply = sim_apply,
+        .save = sim_save,
+        .timer = sim_timer,
+        .ctx = &sim
+    };
+    heater_state_t restored = {
+        .on_off_b_state = on,
+        .on_off_b_long = 3,
+        .mode_b_state = mode
+    };
+    heater_t heater;
+    double surface[SIM_ZONE_NUM];
+    int cursor = 0;
+
+    for (int z = 0; z < HEATER_ZONE_NUM; z++) {
+        restored.level_b_state[z] = manual_level;
+    }
+    sim_point_t amb = trace_at(trace, 0, &cursor);
+    for (int z = 0; z < SIM_ZONE_NUM; z++) {
+        surface[z] = amb.temp;
+    }
+    memset(&sim.outputs, 0, sizeof(sim.outputs));
+    sim.heater = &heater;
+    tw_init(&sim.wheel, 0);
+    for (int i = 0; i < HEATER_TIMER_NUM; i++) {
+        sim.ref[i] = (sim_timer_ref_t){ &sim, (heater_timer_t)i };
+        tw_timer_init(&sim.timer[i], sim_expired, &sim.ref[i]);
+    }
+    heater_init(&heater, &restored, &hal);
+
+    for (int t = 0; t < (int)trace->duration; t += SIM_STEP_S) {
+        amb = trace_at(trace, t, &cursor);
+        tw_advance(&sim.wheel, (uint32_t)t);
+
+        if (t % SIM_SENSOR_S == 0) {
+            control_event_t event = {
+                .type = CONTROL_EVT_SENSOR,
+                .sensor.temperature = (int16_t)lround(amb.temp * 10),
+                .sensor.humidity = (int16_t)lround(amb.rh * 10)
+            };
+            heater_step(&heater, &event);
+        }
+        if (t % SIM_TICK_S == 0) {
+            control_event_t event = { .type = CONTROL_EVT_TICK };
+            heater_step(&heater, &event);
+        }
+
+        // plant: first order surface temperature per zone, local humidity from the ambient vapour pressure
+        double vapour = amb.rh / 100.0 * saturation_hpa(amb.temp);
+        double coldest = 1e9;
+        for (int z = 0; z < SIM_ZONE_NUM; z++) {
+            double p = zones[z].power_w * sim.outputs.duty[zones[z].channel] / DUTY_MAX;
+            surface[z] += (p - zones[z].loss * (surface[z] - amb.temp)) * SIM_STEP_S / zones[z].heat_cap;
+            result.energy_wh += p * SIM_STEP_S / 3600.0;
+            if (surface[z] < coldest) {
+                coldest = surface[z];
+            }
+        }
+        if (amb.rh >= SIM_RH_LIMIT) {
+            result.ambient_humid_s += SIM_STEP_S;
+        }
+        for (int z = 0; z < HEATER_ZONE_NUM; z++) {
+            if (heater.state.boost[z]) {
+                result.boost_s += SIM_STEP_S;
+                break;
+            }
+        }
+        if (100.0 * vapour / saturation_hpa(coldest) >= SIM_RH_LIMIT) {
+            result.surface_humid_s += SIM_STEP_S;
+        }
+        result.steps++;
+    }
+    result.changes = sim.outputs.changes;
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *mode_names[] = { "auto", "manual", "dewpoint" };
+    const char *scenario = argc > 1 ? argv[1] : "ride";
+    const char *mode_arg = argc > 2 ? argv[2] : "all";
+    int manual_level = argc > 3 ? atoi(argv[3]) : 3;
+    sim_trace_t trace;
+
+    if (strcmp(scenario, "ride") == 0) {
+        trace = scenario_ride();
+    }
+    else if (strcmp(scenario, "parking") == 0) {
+        trace = scenario_parking();
+    }
+    else if (trace_load(scenario, &trace) != 0) {
+        fprintf(stderr, "cannot read trace %s\n", scenario);
+        return 1;
+    }
+
+    printf("scenario %s: %.1f h virtual time\n", scenario, trace.duration / 3600.0);
+    printf("%-9s %10s %14s %14s %9s %9s %10s\n", "mode", "energy Wh", "ambient>=90%", "surface>=90%", "boost", "changes", "wall ms");
+    for (int m = -1; m <= MODE_DEWPOINT; m++) {     // -1: heater off, the unheated reference
+        const char *name = m < 0 ? "off" : mode_names[m];
+        if (m >= 0 && strcmp(mode_arg, "all") != 0 && strcmp(mode_arg, name) != 0) {
+            continue;
+        }
+        clock_t start = clock();
+        sim_result_t r = simulate(&trace, m >= 0, m < 0 ? MODE_AUTO : m, manual_level);
+        double wall_ms = 1000.0 * (clock() - start) / CLOCKS_PER_SEC;
+        printf("%-9s %10.1f %12.1f h %12.1f h %7.1f h %9u %10.1f\n", name, r.energy_wh,
+               r.ambient_humid_s / 3600.0, r.surface_humid_s / 3600.0, r.boost_s / 3600.0, r.changes, wall_ms);
+    }
+    return 0;
+}
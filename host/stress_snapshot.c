@@ -0,0 +1,191 @@
+/*
+Stress test of the control state snapshot (heater_snapshot).
+-One writer thread publishes generations as fast as it can, several reader threads read snapshots at the same time.
+-Every field of generation g is derived from g, so a snapshot that mixes two generations is detected field by field.
+ The generation reported by the reader must match the fields and never run backwards.
+-The same load is run against a plain struct copy without the seqlock for comparison, it shows the torn reads the seqlock prevents.
+-Fails if a single seqlock snapshot is torn or out of order.
+
+Usage: stress_snapshot [seconds per run, default 2] [readers, default 3]
+*/
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "heater_snapshot.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define READERS_MAX         (16)
+
+/**********************
+ *  TYPES
+ **********************/
+typedef struct {
+    uint64_t reads;
+    uint64_t busy;              // heater_snapshot_read() gave up, a publish was in progress on every attempt
+    uint64_t torn;              // fields from more than one generation
+    uint64_t backwards;         // generation older than the previous read
+} reader_stats_t;
+
+/**********************
+ *  VARIABLES
+ **********************/
+static heater_snapshot_t snap;
+static heater_state_t plain;                // unsynchronized copy, for comparison only
+static atomic_bool stop;
+static atomic_bool use_seqlock;
+static uint64_t published;
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static void fill(heater_state_t *s, uint32_t g)     // every field a function of the generation
+{
+    memset(s, 0, sizeof(*s));
+    s->mode_b_state = (int)g;
+    s->on_off_b_state = (int)(g + 1);
+    s->on_off_b_long = (int)(g + 2);
+    for (int z = 0; z < HEATER_ZONE_NUM; z++) {
+        s->level_b_state[z] = (int)(g + 3 + z);
+        s->level_b_long[z] = (int)(g + 11 + z);
+    }
+    s->press = g & 1;
+    s->long_press = !(g & 1);
+    s->temperature = (int16_t)g;
+    s->humidity = (int16_t)(g >> 3);
+    s->dewpoint = (int16_t)~g;
+    s->spread = (int16_t)(g * 3);
+    s->sensor_stale = (g >> 2) & 1;
+    for (int z = 0; z < HEATER_ZONE_NUM; z++) {
+        s->boost[z] = (g >> z) & 1;
+        s->override[z] = !((g >> z) & 1);
+        s->pl[z] = (int)(g * 7 + z);
+    }
+    s->boosted = (g >> 1) & 1;
+}
+
+static bool consistent(const heater_state_t *s)
+{
+    heater_state_t expected;
+
+    fill(&expected, (uint32_t)s->mode_b_state);
+    return s->on_off_b_state == expected.on_off_b_state && s->on_off_b_long == expected.on_off_b_long &&
+           memcmp(s->level_b_state, expected.level_b_state, sizeof(s->level_b_state)) == 0 &&
+           memcmp(s->level_b_long, expected.level_b_long, sizeof(s->level_b_long)) == 0 &&
+           s->press == expected.press && s->long_press == expected.long_press &&
+           s->temperature == expected.temperature && s->humidity == expected.humidity &&
+           s->dewpoint == expected.dewpoint && s->spread == expected.spread && s->sensor_stale == expected.sensor_stale &&
+           memcmp(s->boost, expected.boost, sizeof(s->boost)) == 0 && s->boosted == expected.boosted &&
+           memcmp(s->override, expected.override, sizeof(s->override)) == 0 &&
+           memcmp(s->pl, expected.pl, sizeof(s->pl)) == 0;
+}
+
+static void *writer(void *arg)
+{
+    heater_state_t s;
+    uint32_t g = 0;
+
+    while (!atomic_load(&stop)) {
+        fill(&s, ++g);
+        if (atomic_load_explicit(&use_seqlock, memory_order_relaxed)) {
+            heater_snapshot_publish(&snap, &s);
+        }
+        else {
+            memcpy((void *)&plain, &s, sizeof(s));
+        }
+    }
+    published = g;
+    return NULL;
+}
+
+static void *reader(void *arg)
+{
+    reader_stats_t *st = arg;
+    heater_state_t s;
+    uint32_t generation, last = 0;
+
+    while (!atomic_load(&stop)) {
+        if (atomic_load_explicit(&use_seqlock, memory_order_relaxed)) {
+            if (!heater_snapshot_read(&snap, &s, &generation)) {
+                st->busy++;
+                sched_yield();
+                continue;
+            }
+            if ((uint32_t)s.mode_b_state != generation) {
+                st->torn++;         // fields do not belong to the reported generation
+            }
+            if (generation < last) {
+                st->backwards++;
+            }
+            last = generation;
+        }
+        else {
+            memcpy(&s, (const void *)&plain, sizeof(s));
+        }
+        st->torn += !consistent(&s);
+        st->reads++;
+    }
+    return NULL;
+}
+
+static reader_stats_t run(bool seqlock, int seconds, int readers)
+{
+    pthread_t w, r[READERS_MAX];
+    reader_stats_t st[READERS_MAX], total = {0};
+    heater_state_t initial;
+
+    fill(&initial, 0);
+    heater_snapshot_init(&snap, &initial);
+    plain = initial;
+    memset(st, 0, sizeof(st));
+    atomic_store(&use_seqlock, seqlock);
+    atomic_store(&stop, false);
+
+    pthread_create(&w, NULL, writer, NULL);
+    for (int i = 0; i < readers; i++) {
+        pthread_create(&r[i], NULL, reader, &st[i]);
+    }
+    sleep(seconds);
+    atomic_store(&stop, true);
+    pthread_join(w, NULL);
+    for (int i = 0; i < readers; i++) {
+        pthread_join(r[i], NULL);
+        total.reads += st[i].reads;
+        total.busy += st[i].busy;
+        total.torn += st[i].torn;
+        total.backwards += st[i].backwards;
+    }
+    printf("%-14s %12llu %12llu %10llu %10llu %10llu\n", seqlock ? "seqlock" : "plain copy", (unsigned long long)published,
+           (unsigned long long)total.reads, (unsigned long long)total.busy, (unsigned long long)total.torn,
+           (unsigned long long)total.backwards);
+    return total;
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 2;
+    int readers = argc > 2 ? atoi(argv[2]) : 3;
+
+    if (seconds <= 0 || readers <= 0 || readers > READERS_MAX) {
+        fprintf(stderr, "usage: %s [seconds] [readers 1-%d]\n", argv[0], READERS_MAX);
+        return 1;
+    }
+    printf("%d readers, %d s per run, %zu byte state\n", readers, seconds, sizeof(heater_state_t));
+    printf("%-14s %12s %12s %10s %10s %10s\n", "", "published", "reads", "busy", "torn", "backwards");
+    reader_stats_t locked = run(true, seconds, readers);
+    run(false, seconds, readers);
+
+    if (locked.torn || locked.backwards || locked.reads == 0) {
+        printf("FAIL: %llu torn and %llu out of order seqlock snapshots\n",
+               (unsigned long long)locked.torn, (unsigned long long)locked.backwards);
+        return 1;
+    }
+    printf("no torn or out of order seqlock snapshots\n");
+    return 0;
+}
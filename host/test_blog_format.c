@@ -0,0 +1,192 @@
+/*
+Unit test of the deferred log decoder (blog_format) against a small ELF image built in memory.
+-Section table: only loaded sections with file contents are kept, strings are found by address and never read past a section.
+-Record formatting: integer and %s conversions, flags and widths, dropped length modifiers, unknown conversions, missing
+ arguments and truncation to the output size.
+Exits non-zero when a check fails, run by ctest.
+*/
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "blog_format.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+#define SHT_PROGBITS        (1)
+#define SHT_NOBITS          (8)
+#define SHF_ALLOC           (0x2)
+
+#define RODATA_ADDR         (0x3f000000)    // drom strings, as in the firmware
+#define DRAM_ADDR           (0x3ffc0000)
+#define BSS_ADDR            (0x3ffd0000)
+#define STRINGS_OFFSET      (0x40)
+#define SH_OFFSET           (0x100)
+#define SH_SIZE             (40)
+#define SH_NUM              (5)
+#define IMAGE_SIZE          (SH_OFFSET + SH_NUM * SH_SIZE)
+
+/**********************
+ *  VARIABLES
+ **********************/
+static int failures;
+static int checks;
+
+// string constants of the .rodata section, in this order
+static const char rodata[] = "DHT22: \0Humidity: %d%% Temp: %dC\0ok";
+#define STR_TAG             (RODATA_ADDR)
+#define STR_FMT             (RODATA_ADDR + 8)
+#define STR_OK              (RODATA_ADDR + 33)
+#define DRAM_OFFSET         (STRINGS_OFFSET + sizeof(rodata))
+
+static uint8_t image[IMAGE_SIZE];
+static blog_elf_t elf;
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static void check(bool ok, const char *what, int line)
+{
+    checks++;
+    if (!ok) {
+        failures++;
+        printf("FAIL line %d: %s\n", line, what);
+    }
+}
+
+static void wr32(size_t off, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        image[off + i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static void section(int index, uint32_t type, uint32_t flags, uint32_t addr, uint32_t offset, uint32_t size)
+{
+    size_t sh = SH_OFFSET + (size_t)index * SH_SIZE;
+
+    wr32(sh + 4, type);
+    wr32(sh + 8, flags);
+    wr32(sh + 12, addr);
+    wr32(sh + 16, offset);
+    wr32(sh + 20, size);
+}
+
+static void build_image(void)   // ELF32 little endian header and section table, strings in between
+{
+    memset(image, 0, sizeof(image));
+    memcpy(image, "\x7f" "ELF", 4);
+    image[4] = 1;                               // ELFCLASS32
+    image[5] = 1;                               // little endian
+    wr32(32, SH_OFFSET);                        // e_shoff
+    image[46] = SH_SIZE;                        // e_shentsize
+    image[48] = SH_NUM;                         // e_shnum
+
+    memcpy(&image[STRINGS_OFFSET], rodata, sizeof(rodata));
+    memcpy(&image[DRAM_OFFSET], "abcd\0", 5);   // the section ends before the terminator
+
+    section(0, 0, 0, 0, 0, 0);                                          // null section
+    section(1, SHT_PROGBITS, SHF_ALLOC, RODATA_ADDR, STRINGS_OFFSET, sizeof(rodata));
+    section(2, SHT_NOBITS, SHF_ALLOC, BSS_ADDR, STRINGS_OFFSET, 0x100); // no file contents
+    section(3, SHT_PROGBITS, 0, 0, STRINGS_OFFSET, sizeof(rodata));     // not loaded, like .comment
+    section(4, SHT_PROGBITS, SHF_ALLOC, DRAM_ADDR, DRAM_OFFSET, 4);
+}
+
+static bool formats(const char *fmt, const uint32_t *args, int n_args, const char *expect)
+{
+    char out[128];
+
+    blog_format(out, sizeof(out), &elf, fmt, args, n_args);
+    if (strcmp(out, expect) != 0) {
+        printf("format \"%s\": \"%s\", expected \"%s\"\n", fmt, out, expect);
+        return false;
+    }
+    return true;
+}
+
+/**********************
+ *  TESTS
+ **********************/
+static void test_parse(void)
+{
+    blog_elf_t bad;
+
+    build_image();
+    CHECK(blog_elf_parse(&elf, image, sizeof(image)) == 0);
+    CHECK(elf.n_sections == 2);                 // .rodata and the dram section
+
+    image[5] = 2;                               // big endian
+    CHECK(blog_elf_parse(&bad, image, sizeof(image)) == -1);
+    image[5] = 1;
+    CHECK(blog_elf_parse(&bad, image, 40) == -1);  // shorter than the header
+    CHECK(blog_elf_parse(&bad, (const uint8_t *)rodata, sizeof(rodata)) == -1);
+}
+
+static void test_string(void)
+{
+    const char *s;
+
+    s = blog_elf_string(&elf, STR_TAG);
+    CHECK(s != NULL && strcmp(s, "DHT22: ") == 0);
+    s = blog_elf_string(&elf, STR_OK);
+    CHECK(s != NULL && strcmp(s, "ok") == 0);
+    s = blog_elf_string(&elf, STR_TAG + 2);     // inside a string: its tail
+    CHECK(s != NULL && strcmp(s, "T22: ") == 0);
+
+    CHECK(blog_elf_string(&elf, RODATA_ADDR + sizeof(rodata)) == NULL);   // one past the section
+    CHECK(blog_elf_string(&elf, RODATA_ADDR - 1) == NULL);
+    CHECK(blog_elf_string(&elf, BSS_ADDR) == NULL);        // no file contents
+    CHECK(blog_elf_string(&elf, DRAM_ADDR) == NULL);       // no terminator inside the section
+    CHECK(blog_elf_string(&elf, 0) == NULL);
+}
+
+static void test_format(void)
+{
+    const char *fmt = blog_elf_string(&elf, STR_FMT);      // as decode_line() in blog_decode.c
+    CHECK(fmt != NULL && formats(fmt, (const uint32_t[]){ 55, (uint32_t)-3 }, 2, "Humidity: 55% Temp: -3C"));
+    CHECK(formats("%s=%u", (const uint32_t[]){ STR_OK, 4000000000u }, 2, "ok=4000000000"));
+    CHECK(formats("[%s]", (const uint32_t[]){ DRAM_ADDR }, 1, "[<?>]"));
+    CHECK(formats("[%6s|%-4s]", (const uint32_t[]){ STR_OK, STR_OK }, 2, "[    ok|ok  ]"));
+
+    // every argument is one 32 bit word, the length modifiers do not change the width
+    CHECK(formats("%ld %lu %hhx %zu %lld", (const uint32_t[]){ (uint32_t)-1, 7, 0x1ff, 9 }, 4, "-1 7 1ff 9 0"));
+    CHECK(formats("[%-4d|%04x|%X|%c|%o|%+i]", (const uint32_t[]){ 5, 0xab, 0xbeef, 'A', 8, 3 }, 6, "[5   |00ab|BEEF|A|10|+3]"));
+    CHECK(formats("%p", (const uint32_t[]){ 0x3f000010 }, 1, "0x3f000010"));
+    CHECK(formats("%f and %d", (const uint32_t[]){ 1, 2 }, 2, "<%f> and 2"));
+    CHECK(formats("%d %d", (const uint32_t[]){ 7 }, 1, "7 0"));
+    CHECK(formats("100%%", NULL, 0, "100%"));
+    CHECK(formats("end %", NULL, 0, "end 0"));
+}
+
+static void test_truncate(void)
+{
+    char out[16];
+
+    memset(out, 'x', sizeof(out));
+    blog_format(out, 8, &elf, "Humidity: %d", (const uint32_t[]){ 55 }, 1);     // cut in the text
+    CHECK(strcmp(out, "Humidit") == 0);
+    CHECK(out[8] == 'x');
+
+    memset(out, 'x', sizeof(out));
+    blog_format(out, 12, &elf, "Temp: %d C", (const uint32_t[]){ 123456789 }, 1);   // cut in a conversion
+    CHECK(strcmp(out, "Temp: 12345") == 0);
+    CHECK(out[12] == 'x');
+
+    memset(out, 'x', sizeof(out));
+    blog_format(out, 5, &elf, "%s%s", (const uint32_t[]){ STR_TAG, STR_OK }, 2);
+    CHECK(strcmp(out, "DHT2") == 0);
+    CHECK(out[5] == 'x');
+}
+
+int main(void)
+{
+    test_parse();
+    test_string();
+    test_format();
+    test_truncate();
+
+    printf("blog_format: %d checks, %d failed\n", checks, failures);
+    return failures ? 1 : 0;
+}
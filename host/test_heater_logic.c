@@ -0,0 +1,359 @@
+/*
+Unit test of the control logic (heater_logic) against a recording HAL.
+-Button transitions: on/off, mode cycling, manual levels, the grips long press override of the thumb.
+-Power levels of every mode, the boost windows in humid air and the expiry of boost and override timers.
+-No heat in auto and dewpoint mode before the first sensor sample and once the last one timed out.
+-The power level to duty cycle mapping of the heater outputs.
+Exits non-zero when a check fails, run by ctest.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "heater_logic.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+#define PAD_GRIPS               (11)
+#define ZONE_GRIPS              (3)
+#define ZONE_THUMB              (4)
+
+/**********************
+ *  VARIABLES
+ **********************/
+static int failures;
+static int checks;
+
+static uint32_t applied;
+static uint32_t saved;
+static int64_t timer_s[HEATER_TIMER_NUM];   // last start per timer, 0 = cancelled, -1 = never touched
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static void check(bool ok, const char *what, int line)
+{
+    checks++;
+    if (!ok) {
+        failures++;
+        printf("FAIL line %d: %s\n", line, what);
+    }
+}
+
+static void test_apply(void *ctx, const heater_outputs_t *out)
+{
+    applied++;
+}
+
+static void test_save(void *ctx, const heater_state_t *state)
+{
+    saved++;
+}
+
+static void test_timer(void *ctx, heater_timer_t timer, uint32_t seconds)
+{
+    timer_s[timer] = seconds;
+}
+
+static const heater_hal_t hal = {
+    .apply = test_apply,
+    .save = test_save,
+    .timer = test_timer
+};
+
+static void start(heater_t *heater, const heater_state_t *restored)
+{
+    applied = 0;
+    saved = 0;
+    for (int t = 0; t < HEATER_TIMER_NUM; t++) {
+        timer_s[t] = -1;
+    }
+    heater_init(heater, restored, &hal);
+}
+
+static void sensor(heater_t *heater, int16_t temperature, int16_t humidity)
+{
+    control_event_t event = { .type = CONTROL_EVT_SENSOR, .sensor = { temperature, humidity } };
+    heater_step(heater, &event);
+}
+
+static void gesture(heater_t *heater, uint32_t pad, button_gesture_t gesture)
+{
+    control_event_t event = { .type = CONTROL_EVT_BUTTON, .button = { pad, gesture } };
+    heater_step(heater, &event);
+}
+
+static void press(heater_t *heater, uint32_t pad)
+{
+    gesture(heater, pad, BUTTON_PRESS);
+    gesture(heater, pad, BUTTON_RELEASE);
+}
+
+static void long_press(heater_t *heater, uint32_t pad)
+{
+    gesture(heater, pad, BUTTON_PRESS);
+    gesture(heater, pad, BUTTON_LONGPRESS);
+    gesture(heater, pad, BUTTON_RELEASE);
+}
+
+static void expire(heater_t *heater, heater_timer_t timer)
+{
+    control_event_t event = { .type = CONTROL_EVT_TIMER, .timer = timer };
+    timer_s[timer] = 0;
+    heater_step(heater, &event);
+}
+
+static bool all_levels(const heater_t *heater, int level)
+{
+    for (int z = 0; z < HEATER_ZONE_NUM; z++) {
+        if (heater->state.pl[z] != level) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t zone_duty(const heater_t *heater, int zone)
+{
+    return heater->out.duty[HEATER_MODE_NUM + zone];
+}
+
+/**********************
+ *  TESTS
+ **********************/
+static void test_off(void)
+{
+    heater_t heater;
+    heater_state_t restored = { .mode_b_state = MODE_MANUAL, .level_b_state = { 5, 5, 5, 5, 5 }, .on_off_b_long = 3 };
+
+    start(&heater, &restored);
+    CHECK(applied == 1);
+    CHECK(all_levels(&heater, 0));
+    for (int ch = 0; ch < HEATER_CH_NUM; ch++) {
+        CHECK(heater.out.duty[ch] == 0);
+    }
+    sensor(&heater, 100, 950);                  // humid air does not boost while off
+    CHECK(all_levels(&heater, 0));
+    CHECK(timer_s[HEATER_TIMER_BOOST] == -1);
+
+    press(&heater, HEATER_PAD_ON_OFF);
+    CHECK(heater.state.on_off_b_state == 1);
+    CHECK(saved == 1);
+    CHECK(all_levels(&heater, 5));
+    press(&heater, HEATER_PAD_ON_OFF);
+    CHECK(heater.state.on_off_b_state == 0);
+    CHECK(all_levels(&heater, 0));
+}
+
+static void test_restore_clamped(void)
+{
+    heater_t heater;
+    heater_state_t restored = { .mode_b_state = 7, .on_off_b_state = 2, .on_off_b_long = -1, .level_b_state = { 9, -3, 2, 6, 1 } };
+
+    start(&heater, &restored);
+    CHECK(heater.state.mode_b_state == MODE_AUTO);
+    CHECK(heater.state.on_off_b_state == 0);
+    CHECK(heater.state.on_off_b_long == 0);
+    CHECK(heater.state.level_b_state[0] == 0);
+    CHECK(heater.state.level_b_state[1] == 0);
+    CHECK(heater.state.level_b_state[2] == 2);
+    CHECK(heater.state.level_b_state[3] == 0);
+}
+
+static void test_mode_cycle(void)
+{
+    heater_t heater;
+    heater_state_t restored = { .on_off_b_state = 1, .on_off_b_long = 3 };
+
+    start(&heater, &restored);
+    press(&heater, HEATER_PAD_MODE);
+    CHECK(heater.state.mode_b_state == MODE_MANUAL);
+    CHECK(heater.out.duty[MODE_AUTO] == 0 && heater.out.duty[MODE_MANUAL] > 0);
+    press(&heater, HEATER_PAD_MODE);
+    CHECK(heater.state.mode_b_state == MODE_DEWPOINT);
+    press(&heater, HEATER_PAD_MODE);
+    CHECK(heater.state.mode_b_state == MODE_AUTO);
+    CHECK(saved == 3);
+}
+
+static void test_auto(void)
+{
+    heater_t heater;
+    heater_state_t restored = { .mode_b_state = MODE_AUTO, .on_off_b_state = 1 };
+    static const struct {
+        int16_t temperature;
+        int level;
+    } table[] = {
+        { 300, 0 }, { 285, 0 }, { 275, 1 }, { 265, 2 }, { 255, 3 }, { 245, 4 }, { 100, 5 }, { -50, 5 }
+    };
+
+    start(&heater, &restored);
+    for (size_t i = 0; i < sizeof(table) / sizeof(table[0]); i++) {
+        sensor(&heater, table[i].temperature, 300);    // dry air, no boost
+        CHECK(all_levels(&heater, table[i].level));
+    }
+    CHECK(timer_s[HEATER_TIMER_BOOST] == -1);
+}
+
+static void test_manual_duty(void)
+{
+    static const uint32_t duty[HEATER_LEVEL_NUM] = { 0, 1638, 3276, 4914, 6552, 8191 };
+    heater_t heater;
+    heater_state_t restored = { .mode_b_state = MODE_MANUAL, .on_off_b_state = 1 };
+
+    start(&heater, &restored);
+    for (int level = 0; level < HEATER_LEVEL_NUM; level++) {
+        CHECK(heater.state.pl[0] == level);
+        CHECK(zone_duty(&heater, 0) == duty[level]);
+        CHECK(heater.out.symbols[heater_zones[0].led_row] == (uint8_t)(0xff00 >> level));
+        press(&heater, heater_zones[0].pad);
+    }
+    CHECK(heater.state.pl[0] == 0);             // wraps after the last level
+    CHECK(zone_duty(&heater, 1) == 0);          // the other zones did not move
+
+    sensor(&heater, 100, 950);                  // no boost in manual mode
+    CHECK(heater.state.pl[0] == 0);
+    CHECK(timer_s[HEATER_TIMER_BOOST] == -1);
+}
+
+static void test_override(void)
+{
+    heater_t heater;
+    heater_state_t restored = { .mode_b_state = MODE_MANUAL, .on_off_b_state = 1 };
+
+    start(&heater, &restored);
+    press(&heater, PAD_GRIPS);
+    press(&heater, PAD_GRIPS);
+    CHECK(heater.state.pl[ZONE_GRIPS] == 2);
+    CHECK(heater.state.pl[ZONE_THUMB] == 2);    // the thumb follows the grips
+
+    long_press(&heater, PAD_GRIPS);
+    CHECK(heater.state.level_b_long[ZONE_GRIPS] == 1);
+    CHECK(heater.state.override[ZONE_GRIPS]);
+    CHECK(timer_s[HEATER_TIMER_OVERRIDE + ZONE_GRIPS] == HEATER_OVERRIDE_S);
+    CHECK(heater.state.pl[ZONE_GRIPS] == 2);
+    CHECK(heater.state.pl[ZONE_THUMB] == 1);
+
+    expire(&heater, HEATER_TIMER_OVERRIDE + ZONE_GRIPS);
+    CHECK(!heater.state.override[ZONE_GRIPS]);
+    CHECK(heater.state.pl[ZONE_THUMB] == 2);    // follows again
+    CHECK(heater.state.level_b_long[ZONE_GRIPS] == 1);
+}
+
+static void test_dewpoint_boost(void)
+{
+    heater_t heater;
+    heater_state_t restored = { .mode_b_state = MODE_DEWPOINT, .on_off_b_state = 1 };
+
+    start(&heater, &restored);
+    sensor(&heater, 100, 500);
+    CHECK(all_levels(&heater, 0));              // dry air, no heat
+
+    sensor(&heater, 100, 950);                  // spread below 1.5 C: every zone boosts
+    CHECK(heater.state.boosted);
+    CHECK(all_levels(&heater, HEATER_LEVEL_NUM - 1));
+    CHECK(zone_duty(&heater, 0) == 8191);
+    for (int z = 0; z < HEATER_ZONE_NUM; z++) {
+        CHECK(timer_s[HEATER_TIMER_BOOST + z] == heater_zones[z].boost_s);
+    }
+
+    timer_s[HEATER_TIMER_BOOST] = -1;
+    sensor(&heater, 100, 960);                  // still humid: the running window is not restarted
+    CHECK(timer_s[HEATER_TIMER_BOOST] == -1);
+
+    for (int z = 0; z < HEATER_ZONE_NUM; z++) {
+        expire(&heater, HEATER_TIMER_BOOST + z);
+    }
+    CHECK(all_levels(&heater, 1));              // still humid: the hold level keeps the surfaces warm
+    CHECK(zone_duty(&heater, 0) == 1638);
+    sensor(&heater, 100, 960);
+    CHECK(all_levels(&heater, 1));
+    CHECK(timer_s[HEATER_TIMER_BOOST] == 0);    // no new window within the same humid spell
+
+    sensor(&heater, 100, 500);                  // the air dries: off, and the next humid spell boosts again
+    CHECK(all_levels(&heater, 0));
+    CHECK(!heater.state.boosted);
+    sensor(&heater, 100, 950);
+    CHECK(all_levels(&heater, HEATER_LEVEL_NUM - 1));
+
+    press(&heater, HEATER_PAD_ON_OFF);          // switching off ends the windows
+    CHECK(all_levels(&heater, 0));
+    for (int z = 0; z < HEATER_ZONE_NUM; z++) {
+        CHECK(!heater.state.boost[z]);
+        CHECK(timer_s[HEATER_TIMER_BOOST + z] == 0);
+    }
+}
+
+static void test_auto_boost(void)
+{
+    heater_t heater;
+    heater_state_t restored = { .mode_b_state = MODE_AUTO, .on_off_b_state = 1 };
+
+    start(&heater, &restored);
+    sensor(&heater, 265, 950);                  // warm humid air: full power in the window, the table level after it
+    CHECK(all_levels(&heater, HEATER_LEVEL_NUM - 1));
+    for (int z = 0; z < HEATER_ZONE_NUM; z++) {
+        expire(&heater, HEATER_TIMER_BOOST + z);
+    }
+    CHECK(!heater.state.boost[0]);
+    CHECK(all_levels(&heater, 2));
+}
+
+static void test_sensor_timeout(void)
+{
+    heater_t heater;
+    heater_state_t restored = { .mode_b_state = MODE_AUTO, .on_off_b_state = 1, .level_b_state = { 3, 3, 3, 3, 3 } };
+
+    start(&heater, &restored);
+    CHECK(heater.state.sensor_stale);
+    CHECK(all_levels(&heater, 0));              // no sample yet
+    sensor(&heater, 100, 300);
+    CHECK(!heater.state.sensor_stale);
+    CHECK(all_levels(&heater, 5));
+    CHECK(timer_s[HEATER_TIMER_SENSOR] == HEATER_SENSOR_TIMEOUT_S);
+
+    expire(&heater, HEATER_TIMER_SENSOR);       // the sensor stopped answering
+    CHECK(heater.state.sensor_stale);
+    CHECK(all_levels(&heater, 0));
+    for (int ch = HEATER_MODE_NUM; ch < HEATER_CH_NUM; ch++) {
+        CHECK(heater.out.duty[ch] == 0);
+    }
+    CHECK(heater.out.duty[MODE_AUTO] > 0);      // still on, the mode LED stays lit
+    sensor(&heater, 100, 300);                  // the next valid sample heats again
+    CHECK(all_levels(&heater, 5));
+
+    press(&heater, HEATER_PAD_MODE);            // dewpoint mode: no boost and no hold level on a stale sample
+    press(&heater, HEATER_PAD_MODE);
+    CHECK(heater.state.mode_b_state == MODE_DEWPOINT);
+    sensor(&heater, 100, 950);
+    CHECK(all_levels(&heater, HEATER_LEVEL_NUM - 1));
+    expire(&heater, HEATER_TIMER_SENSOR);
+    CHECK(all_levels(&heater, 0));
+    for (int z = 0; z < HEATER_ZONE_NUM; z++) {
+        expire(&heater, HEATER_TIMER_BOOST + z);
+    }
+    CHECK(all_levels(&heater, 0));
+
+    press(&heater, HEATER_PAD_MODE);            // manual levels do not depend on the sensor
+    CHECK(heater.state.mode_b_state == MODE_AUTO);
+    press(&heater, HEATER_PAD_MODE);
+    CHECK(heater.state.mode_b_state == MODE_MANUAL);
+    CHECK(all_levels(&heater, 3));
+}
+
+int main(void)
+{
+    test_off();
+    test_restore_clamped();
+    test_mode_cycle();
+    test_auto();
+    test_manual_duty();
+    test_override();
+    test_dewpoint_boost();
+    test_auto_boost();
+    test_sensor_timeout();
+
+    printf("heater_logic: %d checks, %d failed\n", checks, failures);
+    return failures ? 1 : 0;
+}
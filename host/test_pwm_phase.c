@@ -0,0 +1,103 @@
+/*
+Unit test of the PWM phase scheduler (pwm_phase_plan) over every combination of heater power levels.
+-Every on-time stays inside the period, channels that are off or fully on keep hpoint 0.
+-On-times that fit into one period together do not overlap at all.
+-Otherwise the on-times overlap less than when all channels switch on together at hpoint 0.
+Exits non-zero when a check fails, run by ctest.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "pwm_phase.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define PERIOD      (8192)      // 13 bit LEDC timer
+#define CHANNELS    (5)         // heater zones
+#define LEVELS      (6)
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const uint32_t level_duty[LEVELS] = { 0, 1638, 3276, 4914, 6552, 8191 };    // heater_logic.c duty_cycles
+static int failures;
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static void fail(const uint32_t *duty, const char *what)
+{
+    if (failures++ < 10) {
+        printf("FAIL %s, duties", what);
+        for (int ch = 0; ch < CHANNELS; ch++) {
+            printf(" %u", duty[ch]);
+        }
+        printf("\n");
+    }
+}
+
+static uint32_t overlap(uint32_t a_start, uint32_t a_len, uint32_t b_start, uint32_t b_len)
+{
+    uint32_t start = a_start > b_start ? a_start : b_start;
+    uint32_t end = a_start + a_len < b_start + b_len ? a_start + a_len : b_start + b_len;
+
+    return end > start ? end - start : 0;
+}
+
+static void check_plan(const uint32_t *duty)
+{
+    uint32_t hpoint[CHANNELS];
+    uint32_t sum = 0;
+    uint32_t staggered = 0;     // overlap of every pair of on-times
+    uint32_t together = 0;      // the same with every hpoint at 0
+    int on = 0;
+
+    memset(hpoint, 0xff, sizeof(hpoint));
+    pwm_phase_plan(duty, hpoint, CHANNELS, PERIOD);
+
+    for (int ch = 0; ch < CHANNELS; ch++) {
+        sum += duty[ch];
+        on += duty[ch] > 0;
+        if (hpoint[ch] + duty[ch] > PERIOD) {
+            fail(duty, "on-time past the period end");
+        }
+        if ((duty[ch] == 0 || duty[ch] >= PERIOD) && hpoint[ch] != 0) {
+            fail(duty, "off or full channel moved");
+        }
+        for (int other = ch + 1; other < CHANNELS; other++) {
+            staggered += overlap(hpoint[ch], duty[ch], hpoint[other], duty[other]);
+            together += duty[ch] < duty[other] ? duty[ch] : duty[other];
+        }
+    }
+    if (sum <= PERIOD && staggered > 0) {
+        fail(duty, "on-times overlap although they fit into one period");
+    }
+    if (on > 1 && staggered >= together) {
+        fail(duty, "no less overlap than all switching on together");
+    }
+}
+
+int main(void)
+{
+    uint32_t duty[CHANNELS];
+    int plans = 0;
+
+    for (int combo = 0; combo < LEVELS * LEVELS * LEVELS * LEVELS * LEVELS; combo++, plans++) {
+        for (int ch = 0, c = combo; ch < CHANNELS; ch++, c /= LEVELS) {
+            duty[ch] = level_duty[c % LEVELS];
+        }
+        check_plan(duty);
+    }
+
+    // two halves share the period: one starts where the other ends
+    uint32_t halves[2] = { PERIOD / 2, PERIOD / 2 };
+    uint32_t hpoint[2];
+    pwm_phase_plan(halves, hpoint, 2, PERIOD);
+    if (hpoint[0] != 0 || hpoint[1] != PERIOD / 2) {
+        printf("FAIL halves at %u and %u\n", hpoint[0], hpoint[1]);
+        failures++;
+    }
+
+    printf("pwm_phase: %d plans, %d failed\n", plans, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "executive.h"
+#include "blog.h"
+
+/**********************
+ *  TYPES
+ **********************/
+typedef struct {
+    uint32_t ms;                // esp_log_timestamp(), the ESP_LOGx time base
+    const char *tag;
+    const char *fmt;            // string constant in flash, its address is the format id in binary output
+    uint32_t n_args;
+    uint32_t args[BLOG_ARGS_MAX];
+} blog_record_t;
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const char *TAG = "Blog: ";
+
+static portMUX_TYPE blog_lock = portMUX_INITIALIZER_UNLOCKED;
+static blog_record_t ring[BLOG_RING_LEN];  // protected by blog_lock
+static uint32_t head;                       // next record to write, free running, protected by blog_lock
+static uint32_t tail;                       // next record to drain, free running, protected by blog_lock
+static bool pending;                        // drain scheduled, protected by blog_lock
+static uint32_t dropped_reported;           // owned by the drain job
+static blog_stats_t stats;                  // written and dropped protected by blog_lock, drained owned by the drain job
+static exec_job_t blog_job = -1;
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static bool blog_pop(blog_record_t *rec)
+{
+    bool ok = false;
+
+    portENTER_CRITICAL(&blog_lock);
+    if (tail != head) {
+        *rec = ring[tail % BLOG_RING_LEN];
+        tail++;
+        ok = true;
+    }
+    portEXIT_CRITICAL(&blog_lock);
+    return ok;
+}
+
+static void blog_print(const blog_record_t *rec)
+{
+#if CONFIG_BLOG_BINARY
+    printf("#B %x %x %x", rec->ms, (uint32_t)rec->tag, (uint32_t)rec->fmt);
+    for (int i = 0; i < rec->n_args; i++) {
+        printf(" %x", rec->args[i]);
+    }
+    printf("\n");
+#else
+    printf("I (%u) %s: ", rec->ms, rec->tag);
+    printf(rec->fmt, rec->args[0], rec->args[1], rec->args[2], rec->args[3]);     // every argument is one 32 bit word
+    printf("\n");
+#endif
+}
+
+static void blog_drain(void *ctx)     // executive job: print up to BLOG_DRAIN_MAX records, reschedule if more are left
+{
+    blog_record_t rec;
+    uint32_t dropped;
+    int n = 0;
+
+    portENTER_CRITICAL(&blog_lock);
+    pending = false;
+    dropped = stats.dropped - dropped_reported;
+    portEXIT_CRITICAL(&blog_lock);
+
+    if (dropped) {
+        dropped_reported += dropped;
+        printf("W (%u) %s: %u records dropped\n", esp_log_timestamp(), TAG, dropped);
+    }
+    while (n < BLOG_DRAIN_MAX && blog_pop(&rec)) {
+        blog_print(&rec);
+        n++;
+    }
+    stats.drained += n;
+
+    portENTER_CRITICAL(&blog_lock);
+    bool more = tail != head && !pending;
+    pending = pending || more;
+    portEXIT_CRITICAL(&blog_lock);
+    if (more) {
+        exec_trigger(blog_job, 0);
+    }
+}
+
+/**********************
+ *  API
+ **********************/
+esp_err_t blog_init(void)
+{
+    blog_job = exec_add("blog", blog_drain, NULL, 0, BLOG_DEADLINE_MS, false);
+    if (blog_job < 0) {
+        return ESP_ERR_NO_MEM;
+    }
+    exec_trigger(blog_job, 0);      // records written during boot
+    return ESP_OK;
+}
+
+void blog_write(const char *tag, const char *fmt, const uint32_t args[BLOG_ARGS_MAX], int n_args)
+{
+    uint32_t ms = esp_log_timestamp();
+    bool trigger = false;
+
+    portENTER_CRITICAL(&blog_lock);
+    if (head - tail < BLOG_RING_LEN) {
+        blog_record_t *rec = &ring[head % BLOG_RING_LEN];
+        rec->ms = ms;
+        rec->tag = tag;
+        rec->fmt = fmt;
+        rec->n_args = n_args;
+        for (int i = 0; i < BLOG_ARGS_MAX; i++) {
+            rec->args[i] = args[i];
+        }
+        head++;
+        stats.written++;
+        trigger = !pending;
+        pending = true;
+    }
+    else {
+        stats.dropped++;
+    }
+    portEXIT_CRITICAL(&blog_lock);
+
+    if (trigger) {
+        exec_trigger(blog_job, BLOG_FLUSH_MS);     // first record of a batch, later ones ride along
+    }
+}
+
+void blog_get_stats(blog_stats_t *out)
+{
+    portENTER_CRITICAL(&blog_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&blog_lock);
+}
@@ -0,0 +1,48 @@
+/*
+Deferred binary log:
+-BLOG() stores a fixed-size record in RAM: timestamp, tag and format string addresses and up to four 32 bit arguments.
+ No formatting and no console output happen in the caller, a record costs a short critical section and a 32 byte copy.
+-The "blog" executive job drains the ring a moment later: it formats the records like ESP_LOGI, or with
+ CONFIG_BLOG_BINARY prints them as "#B" hex lines that host/blog_decode.c turns back into text using the ELF file.
+-Records are dropped and counted when the ring is full, the drain reports the count.
+-Arguments are 32 bit words: integers, or for %s a pointer to a string constant in flash (the decoder reads it from the ELF).
+-The ESP32-S2 has one core, so there is a single ring.
+*/
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define BLOG_RING_LEN           (64)        // records, a power of 2
+#define BLOG_ARGS_MAX           (4)
+#define BLOG_FLUSH_MS           (100)       // delay from the first pending record to the drain, batches bursts
+#define BLOG_DRAIN_MAX          (16)        // records per drain run, the rest follows in the next run
+#define BLOG_DEADLINE_MS        (500)       // executive deadline of a drain run, console output may block
+
+/**
+ * Log a record with up to BLOG_ARGS_MAX integer or string constant arguments, never blocks.
+ */
+#define BLOG(tag, fmt, ...) \
+    blog_write((tag), (fmt), (const uint32_t[BLOG_ARGS_MAX]){ __VA_ARGS__ }, \
+               sizeof((const uint32_t[]){ 0, ##__VA_ARGS__ }) / sizeof(uint32_t) - 1)
+
+typedef struct {
+    uint32_t written;           // records stored
+    uint32_t dropped;           // records lost to a full ring
+    uint32_t drained;           // records printed
+} blog_stats_t;
+
+/**
+ * Add the drain job. Call after exec_init(), BLOG() before that only fills the ring.
+ */
+esp_err_t blog_init(void);
+
+/**
+ * Store one record, use BLOG(). Safe from any task, not from ISRs: the drain trigger takes the executive lock and notifies.
+ */
+void blog_write(const char *tag, const char *fmt, const uint32_t args[BLOG_ARGS_MAX], int n_args);
+
+/**
+ * Copy the counters.
+ */
+void blog_get_stats(blog_stats_t *stats);
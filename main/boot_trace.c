@@ -0,0 +1,60 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "boot_trace.h"
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const char *TAG = "Boot: ";
+
+static const char *phase_names[BOOT_PHASE_NUM] = {
+    [BOOT_APP_MAIN]  = "app_main",
+    [BOOT_RESTORED]  = "restored",
+    [BOOT_OUTPUTS]   = "outputs",
+    [BOOT_CONTROL]   = "control",
+    [BOOT_TOUCH]     = "touch",
+    [BOOT_CONSOLE]   = "console",
+    [BOOT_TELEMETRY] = "telemetry",
+    [BOOT_DISPLAY]   = "display",
+};
+
+static int64_t marks[BOOT_PHASE_NUM];      // us, 0 = not reached, written once per phase
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+void boot_mark(boot_phase_t phase)
+{
+    if (marks[phase] == 0) {
+        marks[phase] = esp_timer_get_time();
+    }
+}
+
+int64_t boot_time(boot_phase_t phase)
+{
+    return marks[phase];
+}
+
+const char *boot_phase_name(boot_phase_t phase)
+{
+    return phase_names[phase];
+}
+
+void boot_log(void)
+{
+    int64_t last = 0;
+
+    for (int i = 0; i < BOOT_PHASE_NUM; i++) {
+        if (marks[i] == 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "%-10s at %6lld us (+%lld us)", phase_names[i], marks[i], marks[i] - last);
+        last = marks[i];
+    }
+    if (marks[BOOT_OUTPUTS] > BOOT_OUTPUTS_TARGET_US) {
+        ESP_LOGW(TAG, "first correct output after %lld us, budget %d us", marks[BOOT_OUTPUTS], BOOT_OUTPUTS_TARGET_US);
+    }
+}
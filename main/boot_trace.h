@@ -0,0 +1,43 @@
+/*
+Boot phase timestamps:
+-app_main and the modules it starts mark the end of each boot phase on the esp_timer clock.
+-The key metric is BOOT_OUTPUTS: the LEDC runs with the restored state, the first correct PWM output after reset.
+-boot_log() prints the phases marked so far, the console 'boot' command shows all of them including the deferred display.
+*/
+#pragma once
+
+#include <stdint.h>
+
+#define BOOT_OUTPUTS_TARGET_US  (60000)     // budget from esp_timer start to the first correct PWM output
+
+typedef enum {
+    BOOT_APP_MAIN,          // app_main entered, startup code done
+    BOOT_RESTORED,          // persisted state loaded from NVS
+    BOOT_OUTPUTS,           // LEDC running with the restored state
+    BOOT_CONTROL,           // LED matrix set up, control task running
+    BOOT_TOUCH,             // touch buttons live
+    BOOT_CONSOLE,           // console REPL started
+    BOOT_TELEMETRY,         // telemetry log scanned
+    BOOT_DISPLAY,           // first OLED frame flushed, marked by the GUI task
+    BOOT_PHASE_NUM
+} boot_phase_t;
+
+/**
+ * Record the end of a phase, only the first mark of each phase counts.
+ */
+void boot_mark(boot_phase_t phase);
+
+/**
+ * Time of a phase in us on the esp_timer clock, 0 if not reached yet.
+ */
+int64_t boot_time(boot_phase_t phase);
+
+/**
+ * Name of a phase for reports.
+ */
+const char *boot_phase_name(boot_phase_t phase);
+
+/**
+ * Log the phases marked so far and warn if the first correct output missed its budget.
+ */
+void boot_log(void);
@@ -0,0 +1,541 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_console.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "latency_trace.h"
+#include "dht_rmt.h"
+#include "display.h"
+#include "power.h"
+#include "telemetry.h"
+#include "boot_trace.h"
+#include "executive.h"
+#include "blog.h"
+#include "touch_tune.h"
+#include "supervisor.h"
+#include "timer_service.h"
+#include "console.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define CONSOLE_PROMPT      "heater> "
+
+/**********************
+ *  TYPES
+ **********************/
+typedef struct {
+    TaskStatus_t status[CONSOLE_TASKS_MAX];
+    UBaseType_t count;
+    uint32_t total;             // run time counter, us with the esp_timer clock
+} task_snapshot_t;
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const char *TAG = "Console: ";
+static const char *mode_names[] = { "auto", "manual", "dewpoint" };
+static const char *lock_names[POWER_LOCK_NUM] = { "work", "outputs", "io" };
+static const char task_states[] = { 'X', 'R', 'B', 'S', 'D', '?' };  // eTaskState: running, ready, blocked, suspended, deleted
+
+static console_state_fn_t get_state;
+static TaskHandle_t xSample;
+static uint32_t sample_period_s;                // 0 = sampling off
+
+/**********************
+ *  REPORTS
+ **********************/
+static void task_snapshot(task_snapshot_t *snap)
+{
+    snap->count = uxTaskGetSystemState(snap->status, CONSOLE_TASKS_MAX, &snap->total);
+}
+
+static uint32_t task_cpu_permille(const task_snapshot_t *before, const task_snapshot_t *after, const TaskStatus_t *t)
+{
+    uint32_t window = after->total - before->total;
+    uint32_t start = 0;     // tasks created during the window count from zero
+
+    for (int i = 0; i < before->count; i++) {
+        if (before->status[i].xTaskNumber == t->xTaskNumber) {
+            start = before->status[i].ulRunTimeCounter;
+            break;
+        }
+    }
+    return window ? (uint32_t)((uint64_t)(t->ulRunTimeCounter - start) * 1000 / window) : 0;
+}
+
+static void report_tasks(const task_snapshot_t *before, const task_snapshot_t *after)   // CPU share over the window between the snapshots
+{
+    printf("%-16s %5s %4s %7s %12s\n", "task", "state", "prio", "cpu %", "stack free B");
+    for (int i = 0; i < after->count; i++) {
+        const TaskStatus_t *t = &after->status[i];
+        uint32_t cpu = task_cpu_permille(before, after, t);
+        printf("%-16s %5c %4u %5u.%u %12u\n", t->pcTaskName, task_states[t->eCurrentState < eInvalid ? t->eCurrentState : eInvalid],
+               (unsigned)t->uxCurrentPriority, cpu / 10, cpu % 10, (unsigned)t->usStackHighWaterMark);
+    }
+    if (after->count == CONSOLE_TASKS_MAX) {
+        printf("(task list truncated at %d)\n", CONSOLE_TASKS_MAX);
+    }
+}
+
+static void report_heap(void)
+{
+    printf("heap free %u B, min free %u B, largest block %u B\n",
+           esp_get_free_heap_size(), esp_get_minimum_free_heap_size(),
+           (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+}
+
+static void report_state(void)
+{
+    heater_state_t s;
+
+    get_state(&s);
+    printf("%s, mode %s, temp %d.%d C, humidity %d.%d %%, dew point %d.%d C, brightness %d\n",
+           s.on_off_b_state ? "on" : "off", mode_names[s.mode_b_state],
+           s.temperature / 10, abs(s.temperature % 10), s.humidity / 10, s.humidity % 10,
+           s.dewpoint / 10, abs(s.dewpoint % 10), s.on_off_b_long);
+    printf("power levels:");
+    for (int z = 0; z < HEATER_ZONE_NUM; z++) {
+        printf(" %s %d", heater_zones[z].name, s.pl[z]);
+    }
+    if (s.sensor_stale) {
+        printf(" (sensor stale, no auto or dewpoint heat)");
+    }
+    printf("\nboost:");
+    for (int z = 0; z < HEATER_ZONE_NUM; z++) {
+        if (s.boost[z]) {
+            printf(" %s", heater_zones[z].name);
+        }
+    }
+    printf(", long press override:");
+    for (int z = 0; z < HEATER_ZONE_NUM; z++) {
+        if (s.override[z]) {
+            printf(" %s level %d", heater_zones[z].name, s.level_b_long[z]);
+        }
+    }
+    printf("\n");
+}
+
+static void report_sensor(void)
+{
+    dht_rmt_stats_t dht;
+
+    dht_rmt_get_stats(&dht);
+    printf("DHT22 reads %u, ok %u, timeouts %u, checksum errors %u, framing errors %u\n",
+           dht.reads, dht.ok, dht.timeouts, dht.checksum, dht.framing);
+    if (dht.last_ok_us == 0) {
+        printf("no good reading yet, %u failed\n", dht.failed_run);
+    }
+    else {
+        printf("last good reading %lld s ago, %u failed since\n", (esp_timer_get_time() - dht.last_ok_us) / 1000000, dht.failed_run);
+    }
+}
+
+static void report_display(void)
+{
+    display_stats_t d;
+
+    display_get_stats(&d);
+    printf("display posted %u, dropped %u, wakeups %u, unchanged %u, renders %u, flushes %u\n",
+           d.posted, d.dropped, d.wakeups, d.unchanged, d.renders, d.flushes);
+    printf("display bytes %u, update last %u us, max %u us\n", d.bytes, d.update_us_last, d.update_us_max);
+}
+
+static void report_power(void)
+{
+    power_stats_t p;
+
+    power_get_stats(&p);
+    uint64_t total_us = p.on_us + p.off_us;
+    printf("system %s, on %llu s, off %llu s\n", p.active ? "on" : "off", p.on_us / 1000000, p.off_us / 1000000);
+    printf("%-8s %10s %10s %7s\n", "lock", "acquired", "held s", "held %");
+    for (int i = 0; i < POWER_LOCK_NUM; i++) {
+        uint32_t permille = total_us ? (uint32_t)(p.lock[i].held_us * 1000 / total_us) : 0;
+        printf("%-8s %10u %10llu %5u.%u\n", lock_names[i], p.lock[i].acquired, p.lock[i].held_us / 1000000,
+               permille / 10, permille % 10);
+    }
+#if CONFIG_PM_PROFILING
+    esp_pm_dump_locks(stdout);          // time per clock mode and in light sleep
+#endif
+}
+
+static void report_boot(void)
+{
+    int64_t last = 0;
+
+    printf("%-10s %10s %10s\n", "phase", "at us", "+us");
+    for (int i = 0; i < BOOT_PHASE_NUM; i++) {
+        int64_t t = boot_time(i);
+        if (t == 0) {
+            printf("%-10s %10s\n", boot_phase_name(i), "-");
+            continue;
+        }
+        printf("%-10s %10lld %10lld\n", boot_phase_name(i), t, t - last);
+        last = t;
+    }
+    printf("first correct output %lld us, budget %d us\n", boot_time(BOOT_OUTPUTS), BOOT_OUTPUTS_TARGET_US);
+}
+
+static void report_exec(void)
+{
+    exec_stats_t e;
+    exec_job_stats_t j;
+
+    exec_get_stats(&e);
+    printf("%-10s %8s %8s %8s %6s %7s %10s %10s\n", "job", "period", "deadline", "runs", "missed", "skipped", "max late", "max run");
+    for (exec_job_t i = 0; exec_get_job_stats(i, &j); i++) {
+        printf("%-10s %6u ms %6u ms %8u %6u %7u %7u us %7u us\n", j.name, j.period_ms, j.deadline_ms, j.runs, j.missed, j.skipped,
+               j.max_latency_us, j.max_run_us);
+    }
+    printf("%u jobs on one task, %u wakeups, stack %u B with %u B never used, about %d B of internal RAM saved\n",
+           e.jobs, e.wakeups, EXEC_STACK_SIZE, e.stack_free, EXEC_REPLACED_RAM - EXEC_STACK_SIZE);
+}
+
+static void report_health(void)
+{
+    static const char *const state_name[] = { "ok", "late", "stalled" };
+    sup_stats_t s;
+    sup_watch_stats_t w;
+
+    sup_get_stats(&s);
+    printf("%-10s %8s %8s %8s %6s %4s %10s %10s %7s\n", "watch", "period", "deadline", "beats", "missed", "late", "max jitter",
+           "wcet", "state");
+    for (sup_watch_t i = 0; sup_get_watch_stats(i, &w); i++) {
+        printf("%-10s %6u ms %6u ms %8u %6u %4u %7u us %7u us %7s%s\n", w.name, w.period_ms, w.deadline_ms, w.beats, w.missed,
+               w.late_checks, w.max_jitter_us, w.wcet_us, state_name[w.state], w.critical ? "" : ", not critical");
+    }
+    if (s.safe) {
+        sup_get_watch_stats(s.cause, &w);
+        printf("heaters forced off by %s until restart\n", w.name);
+    }
+    printf("%u watches, %u checks every %d ms while on and %d s while off, task watchdog %s, stack %u B free\n",
+           s.watches, s.checks, SUP_PERIOD_MS, SUP_PERIOD_OFF_MS / 1000, s.active ? "subscribed" : "off", s.stack_free);
+}
+
+static void report_timers(void)
+{
+    tmr_stats_t t;
+
+    tmr_get_stats(&t);
+    printf("timers pending %u, max %u, started %u, cancelled %u, fired %u; alarm wakeups %u, armed %u times, %d ms ticks\n",
+           t.wheel.pending, t.wheel.max_pending, t.wheel.added, t.wheel.cancelled, t.wheel.fired, t.wakeups, t.armed, TMR_TICK_MS);
+}
+
+static void report_blog(void)
+{
+    blog_stats_t b;
+
+    blog_get_stats(&b);
+    printf("deferred log records written %u, dropped %u, printed %u, ring %d records\n", b.written, b.dropped, b.drained, BLOG_RING_LEN);
+}
+
+static void report_touch(void)
+{
+    touch_tune_stats_t t;
+    touch_tune_channel_t c;
+
+    touch_tune_get_stats(&t);
+    printf("%-4s %8s %9s %8s %6s %9s %7s\n", "pad", "raw", "benchmark", "baseline", "noise", "threshold", "pressed");
+    for (int i = 0; touch_tune_get_channel(i, &c); i++) {
+        printf("%-4d %8u %9u %8u %6u %9u %7s\n", i, c.raw, c.benchmark, c.baseline, c.noise, c.threshold, c.pressed ? "yes" : "no");
+    }
+    printf("%s detection, recorder %s, %u samples, %u recorded, %u events, %u water, %u re-learned%s\n",
+           t.adaptive ? "adaptive" : "library", t.recording ? "on" : "off", t.samples, t.recorded, t.events, t.water, t.relearned,
+           t.wet ? ", wet" : "");
+}
+
+static void history_print(const telemetry_sample_t *s, void *ctx)     // one CSV line per stored sample
+{
+    uint32_t *lines = ctx;
+
+    printf("%u,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n", s->minute, s->boot, s->temperature, s->humidity, s->on, s->mode,
+           s->pl[0], s->pl[1], s->pl[2], s->pl[3], s->pl[4]);
+    (*lines)++;
+}
+
+static void report_history(uint32_t minutes)
+{
+    telemetry_stats_t t;
+    uint32_t lines = 0;
+
+    printf("minute,boot,temp_0.1C,rh_0.1pct,on,mode,pl0,pl1,pl2,pl3,pl4\n");
+    if (telemetry_read(minutes, history_print, &lines) != ESP_OK) {
+        printf("# no telemetry partition\n");
+        return;
+    }
+    telemetry_get_stats(&t);
+    printf("# %u samples; since boot: logged %u, dropped %u, pages %u, erases %u, skipped %u, errors %u\n",
+           lines, t.samples, t.dropped, t.pages, t.erases, t.skipped, t.errors);
+}
+
+/**********************
+ *  TASKS
+ **********************/
+static void sample_task(void *pvParameters)    // log tasks, heap and state every sample_period_s, sleeps while sampling is off
+{
+    static task_snapshot_t before, after;      // too large for the stack
+
+    while (1) {
+        if (sample_period_s == 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        task_snapshot(&before);
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sample_period_s * 1000)) != 0) {
+            continue;       // period changed, restart the window
+        }
+        task_snapshot(&after);
+        ESP_LOGI(TAG, "sample over %u s", sample_period_s);
+        report_tasks(&before, &after);
+        report_heap();
+        report_state();
+    }
+}
+
+/**********************
+ *  COMMANDS
+ **********************/
+static int cmd_latency(int argc, char **argv)   // latency [reset]
+{
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        latency_reset();
+        printf("latency traces cleared\n");
+        return 0;
+    }
+    if (argc > 1) {
+        printf("usage: latency [reset]\n");
+        return 1;
+    }
+    latency_report();
+    return 0;
+}
+
+static int cmd_tasks(int argc, char **argv)
+{
+    static task_snapshot_t before, after;
+
+    task_snapshot(&before);
+    vTaskDelay(pdMS_TO_TICKS(CONSOLE_CPU_WINDOW_MS));
+    task_snapshot(&after);
+    report_tasks(&before, &after);
+    return 0;
+}
+
+static int cmd_heap(int argc, char **argv)
+{
+    report_heap();
+    return 0;
+}
+
+static int cmd_state(int argc, char **argv)
+{
+    report_state();
+    return 0;
+}
+
+static int cmd_sensor(int argc, char **argv)
+{
+    report_sensor();
+    return 0;
+}
+
+static int cmd_display(int argc, char **argv)
+{
+    report_display();
+    return 0;
+}
+
+static int cmd_boot(int argc, char **argv)
+{
+    report_boot();
+    return 0;
+}
+
+static int cmd_exec(int argc, char **argv)
+{
+    report_exec();
+    return 0;
+}
+
+static int cmd_health(int argc, char **argv)
+{
+    report_health();
+    return 0;
+}
+
+static int cmd_timers(int argc, char **argv)
+{
+    report_timers();
+    return 0;
+}
+
+static int cmd_blog(int argc, char **argv)
+{
+    report_blog();
+    return 0;
+}
+
+static int cmd_touch(int argc, char **argv)    // touch [rec on|off]
+{
+    if (argc == 3 && strcmp(argv[1], "rec") == 0 && (strcmp(argv[2], "on") == 0 || strcmp(argv[2], "off") == 0)) {
+        touch_tune_record(strcmp(argv[2], "on") == 0);
+        return 0;
+    }
+    if (argc > 1) {
+        printf("usage: touch [rec on|off]\n");
+        return 1;
+    }
+    report_touch();
+    return 0;
+}
+
+static int cmd_history(int argc, char **argv)  // history [minutes]
+{
+    report_history(argc > 1 ? (uint32_t)atoi(argv[1]) : 0);
+    return 0;
+}
+
+static int cmd_pm(int argc, char **argv)
+{
+    report_power();
+    return 0;
+}
+
+static int cmd_sample(int argc, char **argv)   // sample <seconds>|off
+{
+    if (argc != 2) {
+        printf("usage: sample <seconds>|off\n");
+        return 1;
+    }
+    sample_period_s = strcmp(argv[1], "off") == 0 ? 0 : (uint32_t)atoi(argv[1]);
+    if (sample_period_s > 0 && xSample == NULL) {
+        xTaskCreate(sample_task, "sample", 3 * 1024, NULL, 1, &xSample);
+    }
+    else if (xSample != NULL) {
+        xTaskNotifyGive(xSample);
+    }
+    printf(sample_period_s ? "sampling every %u s\n" : "sampling off\n", sample_period_s);
+    return 0;
+}
+
+static const esp_console_cmd_t commands[] = {
+    {
+        .command = "latency",
+        .help = "Touch release to state, compute, PWM and LED matrix latency: min/p50/p99/max. 'latency reset' clears the traces",
+        .hint = "[reset]",
+        .func = cmd_latency
+    },
+    {
+        .command = "tasks",
+        .help = "Per task state, priority, CPU share over the next second and stack high-water mark",
+        .func = cmd_tasks
+    },
+    {
+        .command = "heap",
+        .help = "Free, minimum free and largest free heap block",
+        .func = cmd_heap
+    },
+    {
+        .command = "state",
+        .help = "Live control state: on/off, mode, sensor values, power level per zone",
+        .func = cmd_state
+    },
+    {
+        .command = "sensor",
+        .help = "DHT22 read and error counters",
+        .func = cmd_sensor
+    },
+    {
+        .command = "display",
+        .help = "Display update, wakeup, render and flush counters",
+        .func = cmd_display
+    },
+    {
+        .command = "boot",
+        .help = "Boot phase timestamps and the time to the first correct PWM output",
+        .func = cmd_boot
+    },
+    {
+        .command = "exec",
+        .help = "Executive jobs: period, deadline, runs, deadline misses, worst start latency and run time, task stack use",
+        .func = cmd_exec
+    },
+    {
+        .command = "health",
+        .help = "Supervisor watches: period, deadline, heartbeats, misses, late checks in a row, worst jitter and run time, "
+                "and whether the heaters were forced off",
+        .func = cmd_health
+    },
+    {
+        .command = "timers",
+        .help = "Timer service: pending timers, starts, cancels, expiries and alarm wakeups",
+        .func = cmd_timers
+    },
+    {
+        .command = "blog",
+        .help = "Deferred log counters: records written, dropped on a full ring and printed",
+        .func = cmd_blog
+    },
+    {
+        .command = "touch",
+        .help = "Touch pads: filtered reading, benchmark, adaptive baseline, noise and threshold. 'touch rec on' prints \"#T\" "
+                "lines for host/replay_touch",
+        .hint = "[rec on|off]",
+        .func = cmd_touch
+    },
+    {
+        .command = "history",
+        .help = "Stream the telemetry log as CSV, oldest first: all of it or the last <minutes>",
+        .hint = "[minutes]",
+        .func = cmd_history
+    },
+    {
+        .command = "pm",
+        .help = "Power locks held and time on/off, with PM profiling also the time per clock mode and in light sleep",
+        .func = cmd_pm
+    },
+    {
+        .command = "sample",
+        .help = "Log tasks, heap and state periodically",
+        .hint = "<seconds>|off",
+        .func = cmd_sample
+    },
+};
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+esp_err_t console_start(console_state_fn_t state_fn)
+{
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = CONSOLE_PROMPT;
+    get_state = state_fn;
+
+#if CONFIG_ESP_CONSOLE_USB_CDC
+    esp_console_dev_usb_cdc_config_t cdc_config = ESP_CONSOLE_DEV_CDC_CONFIG_DEFAULT();
+    esp_err_t err = esp_console_new_repl_usb_cdc(&cdc_config, &repl_config, &repl);
+#else
+    esp_console_dev_uart_config_t uart_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    esp_err_t err = esp_console_new_repl_uart(&uart_config, &repl_config, &repl);
+#endif
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%s) creating REPL", esp_err_to_name(err));
+        return err;
+    }
+
+    esp_console_register_help_command();
+    for (int i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        ESP_ERROR_CHECK(esp_console_cmd_register(&commands[i]));
+    }
+    return esp_console_start_repl(repl);
+}
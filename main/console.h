@@ -0,0 +1,20 @@
+/*
+Diagnostics console:
+-esp_console REPL on the configured console port: UART0 at 115200 baud by default, USB CDC when the console is routed there.
+-Runs in its own REPL task, commands only read the state of the other modules and never block them.
+*/
+#pragma once
+
+#include "esp_err.h"
+#include "heater_logic.h"
+
+#define CONSOLE_TASKS_MAX       (24)        // tasks reported by 'tasks' and 'sample'
+#define CONSOLE_CPU_WINDOW_MS   (1000)      // CPU share measurement window of 'tasks'
+
+typedef void (*console_state_fn_t)(heater_state_t *state);    // copy the live control state
+
+/**
+ * Register the diagnostics commands and start the REPL task.
+ * get_state is used by 'state' and 'sample' to read the control state without touching the control task.
+ */
+esp_err_t console_start(console_state_fn_t get_state);
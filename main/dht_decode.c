@@ -0,0 +1,65 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdbool.h>
+#include "dht_decode.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+// accepted pulse lengths in us, wide enough for sensor tolerance and the RMT input filter
+#define RESPONSE_MIN_US     (60)    // response low and high, nominal 80
+#define RESPONSE_MAX_US     (110)
+#define BIT_LOW_MIN_US      (30)    // bit start low, nominal 50
+#define BIT_LOW_MAX_US      (85)
+#define BIT_HIGH_MIN_US     (10)    // 0 bit high, nominal 26-28
+#define BIT_ONE_US          (48)    // high pulses from here on are a 1 bit, nominal 70
+#define BIT_HIGH_MAX_US     (100)
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static bool in_range(const dht_pulse_t *p, uint8_t level, uint16_t min, uint16_t max)
+{
+    return p->level == level && p->us >= min && p->us <= max;
+}
+
+dht_decode_result_t dht_decode(const dht_pulse_t *pulses, size_t count, int16_t *humidity, int16_t *temperature)
+{
+    uint8_t data[DHT_BITS / 8] = {0};
+    size_t i = 0;
+
+    // skip the host start and release until the sensor response low/high pair
+    while (i + 1 < count && !(in_range(&pulses[i], 0, RESPONSE_MIN_US, RESPONSE_MAX_US)
+                             && in_range(&pulses[i + 1], 1, RESPONSE_MIN_US, RESPONSE_MAX_US))) {
+        i++;
+    }
+    if (i + 1 >= count) {
+        return DHT_DECODE_TIMEOUT;
+    }
+    i += 2;
+
+    for (int bit = 0; bit < DHT_BITS; bit++, i += 2) {
+        if (i + 1 >= count) {
+            return DHT_DECODE_TIMEOUT;
+        }
+        if (!in_range(&pulses[i], 0, BIT_LOW_MIN_US, BIT_LOW_MAX_US)
+            || !in_range(&pulses[i + 1], 1, BIT_HIGH_MIN_US, BIT_HIGH_MAX_US)) {
+            return DHT_DECODE_FRAMING;
+        }
+        data[bit / 8] = (uint8_t)(data[bit / 8] << 1) | (pulses[i + 1].us >= BIT_ONE_US);
+    }
+    if (i >= count || pulses[i].level != 0) {
+        return DHT_DECODE_TIMEOUT;      // the last high pulse has no end, its length and so bit 40 are not known
+    }
+
+    if ((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4]) {
+        return DHT_DECODE_CHECKSUM;
+    }
+    *humidity = (int16_t)(data[0] << 8 | data[1]);
+    *temperature = (int16_t)((data[2] & 0x7F) << 8 | data[3]);
+    if (data[2] & 0x80) {       // sign and magnitude
+        *temperature = -*temperature;
+    }
+    return DHT_DECODE_OK;
+}
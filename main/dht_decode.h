@@ -0,0 +1,32 @@
+/*
+DHT22 / AM2301 pulse train decoder:
+-Input is the captured line as alternating low/high pulses with their length in us, starting anywhere before the sensor response.
+-The sensor answers with 80 us low, 80 us high, then 40 bits: 50 us low followed by ~27 us high for 0 or ~70 us high for 1.
+ A last 50 us low ends the high pulse of bit 40, a train without it was cut short and is a timeout.
+-Plain C without ESP-IDF dependencies, also built natively, see host/CMakeLists.txt.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DHT_BITS                (40)
+#define DHT_PULSES_MIN          (2 + 2 * DHT_BITS + 1)  // response low/high, a low/high pair per bit and the end low
+
+typedef struct {
+    uint8_t level;      // line level during the pulse, 0 or 1
+    uint16_t us;        // pulse length
+} dht_pulse_t;
+
+typedef enum {
+    DHT_DECODE_OK,
+    DHT_DECODE_TIMEOUT,     // no sensor response or the train ended early
+    DHT_DECODE_CHECKSUM,    // all bits received, checksum byte does not match
+    DHT_DECODE_FRAMING      // a pulse is outside the protocol timing
+} dht_decode_result_t;
+
+/**
+ * Decode a captured pulse train into humidity and temperature, both in 0.1 units as dht_read_data() reports them.
+ * The outputs are only written on DHT_DECODE_OK.
+ */
+dht_decode_result_t dht_decode(const dht_pulse_t *pulses, size_t count, int16_t *humidity, int16_t *temperature);
@@ -0,0 +1,132 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/ringbuf.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "power.h"
+#include "dht_decode.h"
+#include "dht_rmt.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define DHT_RMT_CLK_DIV         (80)        // 1 us per tick from the 80 MHz APB clock
+#define DHT_RMT_IDLE_US         (200)       // capture ends when the line stays put this long
+#define DHT_RMT_FILTER_TICKS    (100)       // glitch filter in APB cycles, 1.25 us
+#define DHT_RMT_RINGBUF_SIZE    (1024)
+#define DHT_PULSES_MAX          (DHT_PULSES_MIN + 8)   // some slack for the host release
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const char *TAG = "DHT22: ";
+
+static gpio_num_t dht_pin;
+static rmt_channel_t rmt_channel;
+static RingbufHandle_t rmt_rb;
+static dht_rmt_stats_t stats;
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+esp_err_t dht_rmt_init(gpio_num_t pin, rmt_channel_t channel)
+{
+    rmt_config_t config = RMT_DEFAULT_CONFIG_RX(pin, channel);
+    config.clk_div = DHT_RMT_CLK_DIV;
+    config.rx_config.filter_en = true;
+    config.rx_config.filter_ticks_thresh = DHT_RMT_FILTER_TICKS;
+    config.rx_config.idle_threshold = DHT_RMT_IDLE_US;
+
+    dht_pin = pin;
+    rmt_channel = channel;
+    esp_err_t err = rmt_config(&config);
+    if (err == ESP_OK) {
+        err = rmt_driver_install(channel, DHT_RMT_RINGBUF_SIZE, 0);
+    }
+    if (err == ESP_OK) {
+        err = rmt_get_ringbuf_handle(channel, &rmt_rb);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%s) installing RMT RX", esp_err_to_name(err));
+        return err;
+    }
+
+    // the RMT input stays routed, the pin additionally drives low as open drain for the start pulse
+    gpio_set_pull_mode(pin, GPIO_PULLUP_ONLY);
+    gpio_set_level(pin, 1);
+    return gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+}
+
+static size_t rmt_to_pulses(const rmt_item32_t *items, size_t n_items, dht_pulse_t *pulses)
+{
+    size_t n = 0;
+
+    for (size_t i = 0; i < n_items && n + 2 <= DHT_PULSES_MAX; i++) {
+        pulses[n++] = (dht_pulse_t){ items[i].level0, items[i].duration0 };
+        if (items[i].duration1 == 0) {
+            break;      // end marker: the line went idle
+        }
+        pulses[n++] = (dht_pulse_t){ items[i].level1, items[i].duration1 };
+    }
+    return n;
+}
+
+esp_err_t dht_rmt_read(int16_t *humidity, int16_t *temperature)
+{
+    dht_pulse_t pulses[DHT_PULSES_MAX];
+    size_t n_pulses = 0;
+    size_t size = 0;
+
+    stats.reads++;
+
+    power_acquire(POWER_LOCK_IO);          // RMT ticks come from the APB clock, keep it at 80 MHz and awake for the read
+    gpio_set_level(dht_pin, 0);
+    vTaskDelay(pdMS_TO_TICKS(DHT_START_MS) + 1);     // +1: a delay of n ticks may end right after the next tick
+    rmt_rx_start(rmt_channel, true);
+    gpio_set_level(dht_pin, 1);
+
+    rmt_item32_t *items = xRingbufferReceive(rmt_rb, &size, pdMS_TO_TICKS(DHT_CAPTURE_MS) + 1);
+    rmt_rx_stop(rmt_channel);
+    power_release(POWER_LOCK_IO);
+    if (items != NULL) {
+        n_pulses = rmt_to_pulses(items, size / sizeof(rmt_item32_t), pulses);
+        vRingbufferReturnItem(rmt_rb, items);
+    }
+
+    esp_err_t err;
+    switch (dht_decode(pulses, n_pulses, humidity, temperature)) {
+        case DHT_DECODE_OK:
+            stats.ok++;
+            err = ESP_OK;
+            break;
+        case DHT_DECODE_CHECKSUM:
+            stats.checksum++;
+            err = ESP_ERR_INVALID_CRC;
+            break;
+        case DHT_DECODE_FRAMING:
+            stats.framing++;
+            err = ESP_ERR_INVALID_RESPONSE;
+            break;
+        case DHT_DECODE_TIMEOUT:
+        default:
+            stats.timeouts++;
+            err = ESP_ERR_TIMEOUT;
+            break;
+    }
+    if (err == ESP_OK) {
+        stats.failed_run = 0;
+        stats.last_ok_us = esp_timer_get_time();
+    }
+    else {
+        stats.failed_run++;
+    }
+    return err;
+}
+
+void dht_rmt_get_stats(dht_rmt_stats_t *out)
+{
+    *out = stats;
+}
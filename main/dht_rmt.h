@@ -0,0 +1,41 @@
+/*
+DHT22 capture with the RMT peripheral:
+-The start pulse is a task delay with the open drain line held low, the sensor answer is recorded by RMT RX in hardware.
+-No busy waiting and no critical sections, other tasks keep running during a read. Decoding is done by dht_decode().
+-Replaces the bit-banged dht_read_data() of esp-idf-lib.
+*/
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "driver/rmt.h"
+
+#define DHT_START_MS            (20)        // host start low, AM2301 needs at least 1 ms
+#define DHT_CAPTURE_MS          (20)        // the full answer takes about 5 ms
+
+typedef struct {
+    uint32_t reads;
+    uint32_t ok;
+    uint32_t timeouts;          // no answer or an incomplete train
+    uint32_t checksum;          // checksum mismatch
+    uint32_t framing;           // pulse timing outside the protocol
+    uint32_t failed_run;        // failed reads since the last good one
+    int64_t last_ok_us;         // esp_timer time of the last good reading, 0 = none yet
+} dht_rmt_stats_t;
+
+/**
+ * Set up the data pin as open drain with pull-up and install the RMT RX channel.
+ */
+esp_err_t dht_rmt_init(gpio_num_t pin, rmt_channel_t channel);
+
+/**
+ * Trigger one measurement and decode it. Sleeps about DHT_START_MS + 5 ms, never spins.
+ * Returns ESP_ERR_TIMEOUT or ESP_ERR_INVALID_CRC / ESP_ERR_INVALID_RESPONSE on errors, see the counters.
+ */
+esp_err_t dht_rmt_read(int16_t *humidity, int16_t *temperature);
+
+/**
+ * Copy the read and error counters.
+ */
+void dht_rmt_get_stats(dht_rmt_stats_t *stats);
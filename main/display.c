@@ -0,0 +1,307 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#if CONFIG_DISPLAY_FRAMEBUFFER
+#include "oled_fb.h"
+#include "ssd1306.h"
+#else
+#include "lvgl.h"
+#include "lvgl_helpers.h"
+#endif
+#include "power.h"
+#include "boot_trace.h"
+#include "display.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+// every text the display shows: the build generates the fonts with only the characters of these strings, printf
+// conversions %d, %i, %u and %% included (fonts/font_subset.py), a character without a glyph in the font fails the build
+#define DISPLAY_TEXT(font, text)    text
+
+#if CONFIG_DISPLAY_FRAMEBUFFER
+#define GUI_STACK               (3072)      // formatting, the render and the I2C transaction, no LVGL
+#else
+#define GUI_STACK               (4096*2)
+#endif
+
+/**********************
+ *  TYPES
+ **********************/
+#if CONFIG_DISPLAY_FRAMEBUFFER
+typedef struct {
+    uint8_t x, y, w, h;                 // box on the screen, cleared and redrawn as a whole
+    const oled_font_t *font;
+    oled_align_t align;
+    char text[24];                      // text shown
+} display_label_t;
+#else
+typedef lv_obj_t display_label_t;
+#endif
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const char *TAG = "Display: ";
+
+static QueueHandle_t xDisplay_queue;
+static display_stats_t stats;
+
+#if CONFIG_DISPLAY_FRAMEBUFFER
+extern const oled_font_t oled_font_montserrat_48, oled_font_montserrat_14;     // display_fonts.c, generated
+
+static oled_fb_t fb;
+// the places of the LVGL labels: temperature at the top, humidity on the bottom text line
+static display_label_t label_temp = { 0, 0, OLED_WIDTH, 48, &oled_font_montserrat_48, OLED_ALIGN_CENTER, "" };
+static display_label_t label_humidity = { 28, 48, OLED_WIDTH - 28, 16, &oled_font_montserrat_14, OLED_ALIGN_LEFT, "" };
+static display_label_t *label1_temp = &label_temp;
+static display_label_t *label2_humidity = &label_humidity;
+#else
+LV_FONT_DECLARE(display_font_montserrat_48);       // display_fonts.c, generated
+LV_FONT_DECLARE(display_font_montserrat_14);
+
+static display_label_t *label1_temp;
+static display_label_t *label2_humidity;
+#endif
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static void update_time(int64_t start_us)       // time of one update: apply the messages, render, flush
+{
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start_us);
+
+    stats.update_us_last = us;
+    if (us > stats.update_us_max) {
+        stats.update_us_max = us;
+    }
+}
+
+#if CONFIG_DISPLAY_FRAMEBUFFER
+static bool label_set(display_label_t *label, const char *text)    // true when the label changed and needs a flush
+{
+    if (strcmp(label->text, text) == 0) {
+        stats.unchanged++;
+        return false;
+    }
+    snprintf(label->text, sizeof(label->text), "%s", text);
+    oled_fb_text(&fb, label->x, label->y, label->w, label->h, label->font, label->align, label->text);
+    return true;
+}
+
+#else
+static void display_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)  // count I2C traffic, then hand over to the driver
+{
+    stats.flushes++;
+    stats.bytes += (area->x2 - area->x1 + 1) * ((area->y2 - area->y1 + 8) / 8);     // the rounder aligns areas to 8 row pages
+    disp_driver_flush(drv, area, color_map);
+}
+
+static void display_tick(void)     // advance LVGL time by the elapsed real time, replaces the 1 ms lv_tick_inc() timer
+{
+    static int64_t last_us;
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - last_us) / 1000);
+
+    if (ms > 0) {
+        lv_tick_inc(ms);
+        last_us += (int64_t)ms * 1000;
+    }
+}
+
+static bool label_set(display_label_t *label, const char *text)    // true when the label changed and needs a redraw
+{
+    if (strcmp(lv_label_get_text(label), text) == 0) {
+        stats.unchanged++;
+        return false;
+    }
+    lv_label_set_text(label, text);
+    return true;
+}
+#endif
+
+static bool display_apply(const display_msg_t *msg)
+{
+    char text[24];
+    bool changed = false;
+
+    switch (msg->type) {
+        case DISPLAY_MSG_SENSOR:
+            snprintf(text, sizeof(text), DISPLAY_TEXT(montserrat_48, "%dC"), msg->sensor.temperature / 10);
+            changed |= label_set(label1_temp, text);
+            snprintf(text, sizeof(text), DISPLAY_TEXT(montserrat_14, "Humidity  %d%%."), msg->sensor.humidity / 10);
+            changed |= label_set(label2_humidity, text);
+            break;
+    }
+    return changed;
+}
+
+#if !CONFIG_DISPLAY_FRAMEBUFFER
+static void display_screen(void)    // temperature and humidity labels
+{
+    /* Get the current screen  */
+    lv_obj_t * scr = lv_disp_get_scr_act(NULL);
+
+    // Temp setup
+    static lv_style_t style_temp;                                                   // create style
+    lv_style_init(&style_temp);                                                     // initiate style
+    lv_style_set_text_font(&style_temp, LV_STATE_DEFAULT, &display_font_montserrat_48);  // set font type for style
+    label1_temp =  lv_label_create(scr, NULL);                                      // Create label on the currently active screen*/
+    lv_obj_add_style(label1_temp,LV_OBJ_PART_MAIN, &style_temp);                    // add style to label
+    lv_obj_align(label1_temp, NULL, LV_ALIGN_IN_TOP_MID, 5, 0);                     // Set label position on screen
+    lv_label_set_text(label1_temp, "");
+
+    // Humidity setup
+    static lv_style_t style_humidity;
+    lv_style_init(&style_humidity);
+    lv_style_set_text_font(&style_humidity, LV_STATE_DEFAULT, &display_font_montserrat_14);
+    label2_humidity =  lv_label_create(scr, NULL);
+    lv_obj_add_style(label2_humidity,LV_OBJ_PART_MAIN, &style_humidity);
+    lv_obj_align(label2_humidity, NULL, LV_ALIGN_IN_BOTTOM_MID, -36, 0);
+    lv_label_set_text(label2_humidity, "");
+}
+#endif
+
+/**********************
+ *  TASKS
+ **********************/
+#if CONFIG_DISPLAY_FRAMEBUFFER
+static void guiTask(void *pvParameter) {    // display setup, then render and flush on demand
+    (void) pvParameter;
+    uint32_t bytes;
+
+    oled_fb_init(&fb);
+    if (ssd1306_init() == ESP_OK && ssd1306_flush(&fb, &bytes) >= 0) {     // blank screen
+        stats.bytes += bytes;
+    }
+    boot_mark(BOOT_DISPLAY);
+
+    while (1) {
+        display_msg_t msg;
+        bool changed = false;
+
+        xQueueReceive(xDisplay_queue, &msg, portMAX_DELAY);
+        int64_t start_us = esp_timer_get_time();
+        do {
+            changed |= display_apply(&msg);     // apply everything queued, flush once
+        } while (xQueueReceive(xDisplay_queue, &msg, 0) == pdTRUE);
+        stats.wakeups++;
+        if (!changed) {
+            continue;
+        }
+        power_acquire(POWER_LOCK_WORK);
+        int pages = ssd1306_flush(&fb, &bytes);     // the labels are drawn already, send the changed page windows
+        power_release(POWER_LOCK_WORK);
+        if (pages > 0) {
+            stats.flushes += pages;
+            stats.bytes += bytes;
+        }
+        stats.renders++;
+        update_time(start_us);
+    }
+}
+
+#else
+static void guiTask(void *pvParameter) {    // display setup, then render on demand
+    (void) pvParameter;
+    lv_init();
+    /* Initialize SPI or I2C bus used by the drivers */
+    lvgl_driver_init();
+    lv_color_t* buf1 = heap_caps_malloc(DISP_BUF_SIZE * sizeof(lv_color_t), MALLOC_CAP_DMA);
+    assert(buf1 != NULL);
+    static lv_color_t *buf2 = NULL;
+
+    static lv_disp_buf_t disp_buf;
+    uint32_t size_in_px = DISP_BUF_SIZE;
+#if defined CONFIG_LV_TFT_DISPLAY_CONTROLLER_IL3820         \
+    || defined CONFIG_LV_TFT_DISPLAY_CONTROLLER_JD79653A    \
+    || defined CONFIG_LV_TFT_DISPLAY_CONTROLLER_UC8151D     \
+    || defined CONFIG_LV_TFT_DISPLAY_CONTROLLER_SSD1306
+
+    /* Actual size in pixels, not bytes. */
+    size_in_px *= 8;
+#endif
+
+    /* Initialize the working buffer depending on the selected display.
+     * NOTE: buf2 == NULL when using monochrome displays. */
+    lv_disp_buf_init(&disp_buf, buf1, buf2, size_in_px);
+
+    lv_disp_drv_t disp_drv;
+    lv_disp_drv_init(&disp_drv);
+    disp_drv.flush_cb = display_flush;
+
+    /* When using a monochrome display we need to register the callbacks:
+     * - rounder_cb
+     * - set_px_cb */
+#ifdef CONFIG_LV_TFT_DISPLAY_MONOCHROME
+    disp_drv.rounder_cb = disp_driver_rounder;
+    disp_drv.set_px_cb = disp_driver_set_px;
+#endif
+
+    disp_drv.buffer = &disp_buf;
+    lv_disp_drv_register(&disp_drv);
+
+    display_screen();
+    lv_refr_now(NULL);
+    boot_mark(BOOT_DISPLAY);
+
+    /* No tick timer: LVGL time is caught up on every wakeup */
+    while (1) {
+        display_msg_t msg;
+        bool animating = lv_anim_count_running() > 0;
+        bool changed = false;
+        bool received = xQueueReceive(xDisplay_queue, &msg, animating ? pdMS_TO_TICKS(DISPLAY_ANIM_PERIOD_MS) : portMAX_DELAY) == pdTRUE;
+        int64_t start_us = esp_timer_get_time();
+
+        if (received) {
+            do {
+                changed |= display_apply(&msg);     // apply everything queued, render once
+            } while (xQueueReceive(xDisplay_queue, &msg, 0) == pdTRUE);
+        }
+        stats.wakeups++;
+        if (!changed && !animating) {
+            continue;
+        }
+        power_acquire(POWER_LOCK_WORK);      // render at full clock, the I2C driver holds its own lock for the flush
+        display_tick();
+        lv_task_handler();      // animations and other due LVGL tasks
+        lv_refr_now(NULL);      // redraw and flush the invalidated areas right away
+        power_release(POWER_LOCK_WORK);
+        stats.renders++;
+        update_time(start_us);
+    }
+
+    /* A task should NEVER return */
+    free(buf1);
+    vTaskDelete(NULL);
+}
+#endif
+
+void display_start(void)
+{
+    xDisplay_queue = xQueueCreate(DISPLAY_QUEUE_LEN, sizeof(display_msg_t));
+    xTaskCreatePinnedToCore(guiTask, "gui", GUI_STACK, NULL, 4, NULL, 1);
+}
+
+bool display_post(const display_msg_t *msg)
+{
+    if (xQueueSend(xDisplay_queue, msg, 0) != pdTRUE) {
+        stats.dropped++;
+        ESP_LOGW(TAG, "Display queue full, update dropped");
+        return false;
+    }
+    stats.posted++;
+    return true;
+}
+
+void display_get_stats(display_stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,57 @@
+/*
+OLED display pipeline:
+-The GUI task owns LVGL. Other tasks never call LVGL, they post display_msg_t updates to its queue.
+-The task sleeps on the queue and only renders when a message changed a label, or while an animation runs.
+-LVGL time is advanced from esp_timer_get_time() when the task wakes, there is no periodic tick interrupt.
+-A label set to the text it already shows is not touched, so it causes neither a redraw nor an I2C flush.
+-CONFIG_DISPLAY_FRAMEBUFFER replaces LVGL with a 1 KB framebuffer (oled_fb.c) and an own SSD1306 driver (ssd1306.c):
+ labels are redrawn straight into the page bytes and only the changed page windows are sent, LVGL is not linked.
+*/
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DISPLAY_QUEUE_LEN       (8)     // pending updates for the GUI task
+#define DISPLAY_ANIM_PERIOD_MS  (30)    // render period while an animation runs, LV_DISP_DEF_REFR_PERIOD
+
+typedef enum {
+    DISPLAY_MSG_SENSOR,     // new temperature and humidity
+} display_msg_type_t;
+
+typedef struct {
+    display_msg_type_t type;
+    union {
+        struct {
+            int16_t temperature;        // 0.1 C
+            int16_t humidity;           // 0.1 %
+        } sensor;
+    };
+} display_msg_t;
+
+typedef struct {
+    uint32_t posted;            // messages accepted
+    uint32_t dropped;           // messages lost to a full queue
+    uint32_t wakeups;           // GUI task loop iterations
+    uint32_t unchanged;         // label updates skipped, text was already shown
+    uint32_t renders;           // render passes with a changed label or a running animation
+    uint32_t flushes;           // areas (LVGL) or page windows (framebuffer) sent to the display
+    uint32_t bytes;             // pixel bytes sent to the display
+    uint32_t update_us_last;    // last update from message to flushed display, microseconds
+    uint32_t update_us_max;
+} display_stats_t;
+
+/**
+ * Create the GUI task, it initializes the renderer and the display driver and builds the screen.
+ */
+void display_start(void);
+
+/**
+ * Post an update to the GUI task. Never blocks, returns false when the queue is full.
+ */
+bool display_post(const display_msg_t *msg);
+
+/**
+ * Copy the wakeup, render and flush counters and the update times.
+ */
+void display_get_stats(display_stats_t *stats);
@@ -0,0 +1,216 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "supervisor.h"
+#include "executive.h"
+
+/**********************
+ *  TYPES
+ **********************/
+typedef struct {
+    exec_fn_t fn;
+    void *ctx;
+    int64_t period_us;
+    int64_t deadline_us;
+    int64_t due;                // us on the esp_timer clock, valid while armed
+    bool armed;
+    sup_watch_t watch;          // heartbeat per run, fixed once added
+    exec_job_stats_t stats;
+} exec_entry_t;
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const char *TAG = "Executive: ";
+
+static TaskHandle_t xExec;
+static portMUX_TYPE exec_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static exec_entry_t jobs[EXEC_JOBS_MAX];   // protected by exec_lock, fn and ctx are fixed once added
+static int n_jobs;
+static exec_stats_t stats;
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static int exec_next(int64_t now, int64_t *wait_us)    // earliest armed job: its index if due, else -1 and the time until it is, exec_lock held
+{
+    int next = -1;
+
+    for (int i = 0; i < n_jobs; i++) {
+        if (jobs[i].armed && (next < 0 || jobs[i].due < jobs[next].due)) {
+            next = i;
+        }
+    }
+    if (next < 0) {
+        *wait_us = -1;
+        return -1;
+    }
+    if (jobs[next].due > now) {
+        *wait_us = jobs[next].due - now;
+        return -1;
+    }
+    return next;
+}
+
+static void exec_reschedule(exec_entry_t *job, int64_t now)    // one-shot jobs disarm, periodic ones keep their phase, exec_lock held
+{
+    if (job->period_us == 0) {
+        job->armed = false;
+        return;
+    }
+    int64_t behind = now - job->due;
+    if (behind >= job->period_us) {
+        int64_t n = behind / job->period_us;
+        job->stats.skipped += (uint32_t)n;
+        job->due += n * job->period_us;
+    }
+    job->due += job->period_us;
+}
+
+/**********************
+ *  TASKS
+ **********************/
+static void exec_task(void *pvParameters)   // run due jobs one after the other, sleep until the next one is due or a trigger arrives
+{
+    while (1) {
+        int64_t now = esp_timer_get_time();
+        int64_t wait_us, due = 0;
+        exec_entry_t *job = NULL;
+
+        portENTER_CRITICAL(&exec_lock);
+        int next = exec_next(now, &wait_us);
+        if (next >= 0) {
+            job = &jobs[next];
+            due = job->due;
+            exec_reschedule(job, now);
+        }
+        portEXIT_CRITICAL(&exec_lock);
+
+        if (job == NULL) {
+            TickType_t ticks = wait_us < 0 ? portMAX_DELAY : pdMS_TO_TICKS((uint32_t)((wait_us + 999) / 1000)) + 1;
+            ulTaskNotifyTake(pdTRUE, ticks);
+            stats.wakeups++;
+            continue;
+        }
+
+        sup_begin(job->watch);
+        job->fn(job->ctx);
+        sup_end(job->watch);
+        int64_t end = esp_timer_get_time();
+
+        portENTER_CRITICAL(&exec_lock);
+        uint32_t latency = (uint32_t)(now - due);
+        uint32_t run = (uint32_t)(end - now);
+        bool missed = end - due > job->deadline_us;
+        job->stats.runs++;
+        job->stats.missed += missed;
+        if (latency > job->stats.max_latency_us) {
+            job->stats.max_latency_us = latency;
+        }
+        if (run > job->stats.max_run_us) {
+            job->stats.max_run_us = run;
+        }
+        portEXIT_CRITICAL(&exec_lock);
+
+        if (missed) {
+            ESP_LOGW(TAG, "%s missed its %lld ms deadline: started %u us late, ran %u us",
+                     job->stats.name, job->deadline_us / 1000, latency, run);
+        }
+    }
+}
+
+/**********************
+ *  API
+ **********************/
+esp_err_t exec_init(void)
+{
+    if (xTaskCreate(exec_task, "exec", EXEC_STACK_SIZE, NULL, EXEC_PRIORITY, &xExec) != pdPASS) {
+        ESP_LOGE(TAG, "task creation failed");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+exec_job_t exec_add(const char *name, exec_fn_t fn, void *ctx, uint32_t period_ms, uint32_t deadline_ms, bool critical)
+{
+    exec_job_t handle = -1;
+
+    portENTER_CRITICAL(&exec_lock);
+    if (n_jobs < EXEC_JOBS_MAX) {
+        exec_entry_t *job = &jobs[n_jobs];
+        job->fn = fn;
+        job->ctx = ctx;
+        job->period_us = (int64_t)period_ms * 1000;
+        job->deadline_us = (int64_t)deadline_ms * 1000;
+        job->due = esp_timer_get_time() + job->period_us;
+        job->armed = period_ms != 0;
+        job->watch = -1;
+        job->stats.name = name;
+        handle = n_jobs++;
+        stats.jobs = n_jobs;
+    }
+    portEXIT_CRITICAL(&exec_lock);
+
+    if (handle < 0) {
+        ESP_LOGE(TAG, "no room for job %s, raise EXEC_JOBS_MAX", name);
+        return handle;
+    }
+    sup_watch_t watch = sup_watch(name, period_ms, deadline_ms, critical);
+    portENTER_CRITICAL(&exec_lock);
+    jobs[handle].watch = watch;
+    portEXIT_CRITICAL(&exec_lock);
+    if (xExec != NULL) {
+        xTaskNotifyGive(xExec);     // recompute the sleep
+    }
+    return handle;
+}
+
+void exec_trigger(exec_job_t job, uint32_t delay_ms)
+{
+    if (job < 0 || job >= n_jobs) {
+        return;
+    }
+    portENTER_CRITICAL(&exec_lock);
+    jobs[job].due = esp_timer_get_time() + (int64_t)delay_ms * 1000;
+    jobs[job].armed = true;
+    portEXIT_CRITICAL(&exec_lock);
+
+    xTaskNotifyGive(xExec);
+}
+
+void exec_set_period(exec_job_t job, uint32_t period_ms)
+{
+    if (job < 0 || job >= n_jobs) {
+        return;
+    }
+    portENTER_CRITICAL(&exec_lock);
+    jobs[job].period_us = (int64_t)period_ms * 1000;
+    portEXIT_CRITICAL(&exec_lock);
+    sup_set_period(jobs[job].watch, period_ms);
+}
+
+bool exec_get_job_stats(exec_job_t job, exec_job_stats_t *out)
+{
+    if (job < 0 || job >= n_jobs) {
+        return false;
+    }
+    portENTER_CRITICAL(&exec_lock);
+    *out = jobs[job].stats;
+    out->period_ms = (uint32_t)(jobs[job].period_us / 1000);
+    out->deadline_ms = (uint32_t)(jobs[job].deadline_us / 1000);
+    portEXIT_CRITICAL(&exec_lock);
+    return true;
+}
+
+void exec_get_stats(exec_stats_t *out)
+{
+    portENTER_CRITICAL(&exec_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&exec_lock);
+    out->stack_free = xExec != NULL ? uxTaskGetStackHighWaterMark(xExec) : 0;
+}
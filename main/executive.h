@@ -0,0 +1,77 @@
+/*
+Executive:
+-One task runs the periodic and deferred background jobs as callbacks: sensor sampling, the control tick (mode re-evaluation and
+ LED matrix refresh), the persistence flush and the telemetry writer. Each job declares its period and its deadline.
+-Jobs are cooperative, a job runs to completion and the next one waits. Blocking is fine for a few ms (a sensor capture, a flash
+ write), long waits are not: split them into a job that is triggered again.
+-The task sleeps until the next job is due or a job is triggered, so it does not keep the chip out of light sleep.
+-Counts runs, late starts and deadline misses per job, the worst start latency and run time.
+-Every job is a watch of the supervisor with its period and deadline, each run is a heartbeat (supervisor.h). Jobs that keep
+ the heaters right (sensor, control tick, persistence) are critical. The others are not: a late or overlong run of them is
+ counted but does not force the heaters off, a hang still does, since it holds up the critical jobs behind it.
+-Replaces the dht22, persist and telemetry tasks and the control tick timer. Event driven tasks (control, touch buttons, PWM
+ fades, GUI) stay tasks.
+*/
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define EXEC_JOBS_MAX           (8)
+#define EXEC_STACK_SIZE         (4 * 1024)  // deepest job: NVS commit or a telemetry page write, check with 'exec'
+#define EXEC_PRIORITY           (4)         // below control, buttons and PWM, above the console
+#define EXEC_REPLACED_RAM       (8 * 1024 + 3 * 1024 + 3 * 1024 + 3 * 350)  // dht22, persist and telemetry stacks plus TCBs
+
+typedef int exec_job_t;                     // job handle, -1 = not added
+
+typedef void (*exec_fn_t)(void *ctx);
+
+typedef struct {
+    const char *name;
+    uint32_t period_ms;         // 0 = runs only when triggered
+    uint32_t deadline_ms;       // from the due time to the end of the run
+    uint32_t runs;
+    uint32_t missed;            // runs that ended after their deadline
+    uint32_t skipped;           // periods dropped because the job fell more than one period behind
+    uint32_t max_latency_us;    // worst start after the due time
+    uint32_t max_run_us;        // worst run time
+} exec_job_stats_t;
+
+typedef struct {
+    uint32_t jobs;
+    uint32_t wakeups;           // times the task woke up
+    uint32_t stack_free;        // bytes, high-water mark of the task stack
+} exec_stats_t;
+
+/**
+ * Start the executive task. Call before any module adds a job.
+ */
+esp_err_t exec_init(void);
+
+/**
+ * Add a job, period_ms 0 for a job that only runs when triggered. A periodic job first runs one period from now.
+ * critical: sustained misses force the heaters off, see sup_watch(). Returns the handle or -1 when the table is full.
+ */
+exec_job_t exec_add(const char *name, exec_fn_t fn, void *ctx, uint32_t period_ms, uint32_t deadline_ms, bool critical);
+
+/**
+ * Run a job delay_ms from now, replacing its pending due time. Triggering again before it ran pushes the run out,
+ * which debounces bursts. A periodic job continues its period from that run. Safe from any task.
+ */
+void exec_trigger(exec_job_t job, uint32_t delay_ms);
+
+/**
+ * Change the period, takes effect after the next run.
+ */
+void exec_set_period(exec_job_t job, uint32_t period_ms);
+
+/**
+ * Copy the counters of one job, false if the handle is not valid.
+ */
+bool exec_get_job_stats(exec_job_t job, exec_job_stats_t *stats);
+
+/**
+ * Copy the task counters.
+ */
+void exec_get_stats(exec_stats_t *stats);
@@ -0,0 +1,284 @@
+#!/usr/bin/env python
+"""
+Display font subsetting: builds the fonts of the display from the LVGL v7 font sources (lv_font_conv output, plain
+bitmaps), with only the glyphs the firmware shows.
+
+    font_subset.py lvgl|oled OUT.c TEXT.c KEY=LVGL_FONT.c [KEY=LVGL_FONT.c ...]
+
+The glyphs of font KEY are the characters of every DISPLAY_TEXT(KEY, "...") string in TEXT.c. printf conversions
+%d, %i and %u stand for their digits and sign, %% for '%'. A character the source font has no glyph for, or a
+conversion without a known character set, fails the build.
+
+lvgl: 'lv_font_t display_font_KEY', the source glyphs, kerning and metrics, with one sparse cmap
+oled: 'const oled_font_t oled_font_KEY', 1 bpp column-major glyph tables of oled_fb.h, the native byte layout of the
+      SSD1306 pages, a pixel is set when its coverage is at least half
+
+The table sizes of each subset and of the font it replaces are printed: the LVGL source font, or for oled the
+printable ASCII range.
+"""
+import re
+import sys
+
+THRESHOLD = 0.5
+CMAP_SIZE = 20          # sizeof(lv_font_fmt_txt_cmap_t)
+GLYPH_DSC_SIZE = 8      # sizeof(lv_font_fmt_txt_glyph_dsc_t)
+OLED_GLYPH_SIZE = 8     # sizeof(oled_glyph_t)
+
+
+def fail(msg):
+    sys.exit('font_subset: error: ' + msg)
+
+
+def array(src, name, path, required=True):
+    m = re.search(r'\b%s\[\]\s*=\s*\{(.*?)\};' % name, src, re.S)
+    if m is None:
+        if required:
+            fail('%s: no %s[]' % (path, name))
+        return None
+    body = re.sub(r'/\*.*?\*/', '', m.group(1), flags=re.S)
+    return [int(v, 0) for v in re.findall(r'-?0x[0-9a-fA-F]+|-?\d+', body)], m.end()
+
+
+def field(src, name, path):
+    m = re.search(r'\.%s\s*=\s*(-?\d+)' % name, src)
+    if m is None:
+        fail('%s: no .%s' % (path, name))
+    return int(m.group(1))
+
+
+class LvFont:
+    def __init__(self, path):
+        self.path = path
+        with open(path) as f:
+            src = f.read()
+        if field(src, 'bitmap_format', path) != 0:
+            fail('%s: compressed bitmaps are not supported' % path)
+        if 'kern_pair_glyph_ids' in src:
+            fail('%s: pair kerning is not supported' % path)
+        self.bpp = field(src, 'bpp', path)
+        self.line_h = field(src, 'line_height', path)
+        self.base = field(src, 'base_line', path)
+        self.bitmap_name = 'gylph_bitmap' if 'gylph_bitmap[]' in src else 'glyph_bitmap'     # lv_font_conv's spelling varies
+        self.bitmap, end = array(src, self.bitmap_name, path)
+        self.glyphs = [tuple(int(v) for v in g.groups()) for g in re.finditer(
+            r'\{\s*\.bitmap_index\s*=\s*(\d+),\s*\.adv_w\s*=\s*(\d+),\s*\.box_w\s*=\s*(\d+),'
+            r'\s*\.box_h\s*=\s*(\d+),\s*\.ofs_x\s*=\s*(-?\d+),\s*\.ofs_y\s*=\s*(-?\d+)\s*\}', src)]
+
+        # code point -> glyph id, from the full and the sparse ranges
+        self.gid = {}
+        self.cmap_count = 0
+        self.list_len = 0
+        for m in re.finditer(r'\.range_start\s*=\s*(\d+),\s*\.range_length\s*=\s*(\d+),\s*\.glyph_id_start\s*=\s*(\d+),'
+                             r'\s*\.unicode_list\s*=\s*(\w+),\s*\.glyph_id_ofs_list\s*=\s*(\w+),.*?\.type\s*=\s*(\w+)',
+                             src, re.S):
+            start, length, first = int(m.group(1)), int(m.group(2)), int(m.group(3))
+            ulist, olist, kind = m.group(4), m.group(5), m.group(6)
+            self.cmap_count += 1
+            if kind.endswith('FORMAT0_TINY') and ulist == 'NULL' and olist == 'NULL':
+                for i in range(length):
+                    self.gid[start + i] = first + i
+            elif kind.endswith('SPARSE_TINY') and olist == 'NULL':
+                offsets, _ = array(src, ulist, path)
+                self.list_len += len(offsets)
+                for i, ofs in enumerate(offsets):
+                    self.gid[start + ofs] = first + i
+            else:
+                fail('%s: cmap type %s is not supported' % (path, kind))
+        if not self.glyphs or not self.gid:
+            fail('%s: not an LVGL v7 font source' % path)
+
+        # class kerning: glyph id -> left/right class, class pair values
+        self.kern = None
+        left = array(src, 'kern_left_class_mapping', path, False)
+        if left is not None:
+            right, _ = array(src, 'kern_right_class_mapping', path)
+            values, end = array(src, 'kern_class_values', path)
+            self.kern = (left[0], right, values, field(src, 'right_class_cnt', path))
+        else:
+            _, end = array(src, 'cmaps', path)
+        # kerning descriptor, font descriptor and lv_font_t: copied, they carry the version specific fields
+        m = re.compile(r'\blv_font_t\s+(\w+)\s*=\s*\{.*?\n\};', re.S).search(src, end)
+        if m is None:
+            fail('%s: no lv_font_t' % path)
+        self.name = m.group(1)
+        self.tail = src[end:m.end()]
+
+    def glyph(self, c):
+        g = self.gid.get(c)
+        if g is None:
+            return None
+        return self.glyphs[g]
+
+    def glyph_bytes(self, g):
+        return (g[2] * g[3] * self.bpp + 7) // 8
+
+    def size(self):
+        n = len(self.bitmap) + GLYPH_DSC_SIZE * len(self.glyphs) + CMAP_SIZE * self.cmap_count + 2 * self.list_len
+        if self.kern:
+            n += len(self.kern[0]) + len(self.kern[1]) + len(self.kern[2])
+        return n
+
+    def coverage(self, g, x, y):        # 0..1, pixels are packed row by row without row padding
+        n = (y * g[2] + x) * self.bpp
+        byte = self.bitmap[g[0] + n // 8]
+        shift = 8 - self.bpp - n % 8
+        return ((byte >> shift) & ((1 << self.bpp) - 1)) / float((1 << self.bpp) - 1)
+
+
+def unescape(literal):
+    return re.sub(r'\\(x[0-9a-fA-F]{2}|.)',
+                  lambda m: chr(int(m.group(1)[1:], 16)) if m.group(1)[0] == 'x' else
+                  {'n': '\n', 't': '\t'}.get(m.group(1), m.group(1)), literal)
+
+
+def scan(path, keys):
+    """Characters of the DISPLAY_TEXT strings of path, per font key, with the line of their first use."""
+    with open(path, encoding='utf-8') as f:
+        src = f.read()
+    chars = {k: {} for k in keys}
+    for m in re.finditer(r'DISPLAY_TEXT\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)', src):
+        key, text = m.group(1), unescape(m.group(2))
+        line = src.count('\n', 0, m.start()) + 1
+        if key not in chars:
+            fail('%s:%d: DISPLAY_TEXT font %s is not generated' % (path, line, key))
+        i = 0
+        while i < len(text):
+            c = re.match(r'%([-+ #0]*)\d*(?:\.\d+)?(?:hh|h|ll|l)?(.)', text[i:])
+            used = chars[key]
+            if text[i] != '%':
+                used.setdefault(text[i], line)
+                i += 1
+                continue
+            if c is None or c.group(2) not in 'diu%':
+                fail('%s:%d: conversion in "%s" has no known characters' % (path, line, m.group(2)))
+            conv = '%' if c.group(2) == '%' else '0123456789' + ''.join(ch for ch in c.group(1) if ch in '+ ')
+            conv += '-' if c.group(2) in 'di' else ''
+            for ch in conv:
+                used.setdefault(ch, line)
+            i += c.end()
+    return chars
+
+
+def c_array(out, decl, values, fmt):
+    out.append('%s = {' % decl)
+    for i in range(0, len(values), 16):
+        out.append('    ' + ', '.join(fmt % v for v in values[i:i + 16]) + ',')
+    out.append('};')
+    out.append('')
+
+
+LV_STATICS = ('gylph_bitmap', 'glyph_bitmap', 'glyph_dsc', 'cmaps', 'kern_left_class_mapping', 'kern_right_class_mapping',
+              'kern_class_values', 'kern_classes', 'font_dsc', 'cache')
+
+
+def emit_lvgl(key, font, chars, out):
+    name = 'display_font_' + key
+    bitmap, dsc, gids = [], [], []
+    for c in chars:
+        g = font.glyph(ord(c))
+        gids.append(font.gid[ord(c)])
+        dsc.append('    {.bitmap_index = %d, .adv_w = %d, .box_w = %d, .box_h = %d, .ofs_x = %d, .ofs_y = %d},    /* %s */'
+                   % ((len(bitmap),) + g[1:] + (repr(c),)))
+        bitmap += font.bitmap[g[0]:g[0] + font.glyph_bytes(g)]
+    start = ord(chars[0])
+    out.append('/* %s: %s */' % (name, repr(''.join(chars))))
+    c_array(out, 'static LV_ATTRIBUTE_LARGE_CONST const uint8_t %s_%s[]' % (name, font.bitmap_name), bitmap or [0], '0x%02x')
+    out.append('static const lv_font_fmt_txt_glyph_dsc_t %s_glyph_dsc[] = {' % name)
+    out.append('    {.bitmap_index = 0, .adv_w = 0, .box_w = 0, .box_h = 0, .ofs_x = 0, .ofs_y = 0},    /* id = 0 reserved */')
+    out += dsc
+    out.append('};')
+    out.append('')
+    c_array(out, 'static const uint16_t %s_unicode_list[]' % name, [ord(c) - start for c in chars], '0x%x')
+    out.append('static const lv_font_fmt_txt_cmap_t %s_cmaps[] = {' % name)
+    out.append('    {')
+    out.append('        .range_start = %d, .range_length = %d, .glyph_id_start = 1,' % (start, ord(chars[-1]) - start + 1))
+    out.append('        .unicode_list = %s_unicode_list, .glyph_id_ofs_list = NULL, .list_length = %d, .type = LV_FONT_FMT_TXT_CMAP_SPARSE_TINY'
+               % (name, len(chars)))
+    out.append('    }')
+    out.append('};')
+    out.append('')
+    size = len(bitmap) + GLYPH_DSC_SIZE * (len(chars) + 1) + CMAP_SIZE + 2 * len(chars)
+
+    tail = font.tail
+    if font.kern:       # keep the classes of the subset glyphs, renumbered
+        left, right, values, right_cnt = font.kern
+        lmap = [left[g] for g in [0] + gids]
+        rmap = [right[g] for g in [0] + gids]
+        lcls = sorted(set(lmap) - {0})
+        rcls = sorted(set(rmap) - {0})
+        pairs = [values[(l - 1) * right_cnt + (r - 1)] for l in lcls for r in rcls] or [0]
+        lmap = [lcls.index(v) + 1 if v else 0 for v in lmap]
+        rmap = [rcls.index(v) + 1 if v else 0 for v in rmap]
+        c_array(out, 'static const uint8_t %s_kern_left_class_mapping[]' % name, lmap, '%d')
+        c_array(out, 'static const uint8_t %s_kern_right_class_mapping[]' % name, rmap, '%d')
+        c_array(out, 'static const int8_t %s_kern_class_values[]' % name, pairs, '%d')
+        size += len(lmap) + len(rmap) + len(pairs)
+        tail = re.sub(r'(\.left_class_cnt\s*=\s*)\d+', r'\g<1>%d' % max(len(lcls), 1), tail)
+        tail = re.sub(r'(\.right_class_cnt\s*=\s*)\d+', r'\g<1>%d' % max(len(rcls), 1), tail)
+    tail = re.sub(r'(\.cmap_num\s*=\s*)\d+', r'\g<1>1', tail)
+    tail = re.sub(r'\blv_font_t\s+%s\b' % font.name, 'lv_font_t ' + name, tail)
+    tail = re.sub(r'(?<![.\w])(%s)\b' % '|'.join(LV_STATICS), lambda m: name + '_' + m.group(1), tail)   # not the members
+    out.append(tail.strip('\n'))
+    out.append('')
+    return name, size, font.size(), 'for ' + font.name
+
+
+def emit_oled(key, font, chars, out):
+    name = 'oled_font_' + key
+    data, glyphs = [], []
+    for c in chars:
+        if ord(c) > 0x7e:
+            fail('%s: framebuffer fonts are ASCII only, %s' % (name, repr(c)))
+        index, adv_w, w, h, ofs_x, ofs_y = font.glyph(ord(c))
+        rows = (h + 7) // 8
+        offset = len(data)
+        g = (index, adv_w, w, h, ofs_x, ofs_y)
+        for x in range(w):
+            for r in range(rows):
+                data.append(sum(1 << b for b in range(8) if r * 8 + b < h and font.coverage(g, x, r * 8 + b) >= THRESHOLD))
+        y = font.line_h - font.base - (ofs_y + h)
+        glyphs.append('    { %5d, %2d, %2d, %2d, %3d, %3d },    // %s' % (offset, (adv_w + 8) >> 4, w, h, ofs_x, y, repr(c)))
+    if len(data) > 0xffff:
+        fail('%s: bitmap exceeds 64 KB' % name)
+    full = sum(g[2] * ((g[3] + 7) // 8) + OLED_GLYPH_SIZE for g in map(font.glyph, range(0x20, 0x7f)) if g)
+    c_array(out, 'static const uint8_t %s_bitmap[]' % name, data or [0], '0x%02x')
+    out.append('static const oled_glyph_t %s_glyphs[] = {' % name)
+    out += glyphs
+    out.append('};')
+    out.append('')
+    cmap = ''.join('\\\\' if c == '\\' else '\\"' if c == '"' else c for c in chars)
+    out.append('const oled_font_t %s = { %s_bitmap, %s_glyphs, 0x%02x, %d, %d, "%s" };'
+               % (name, name, name, ord(chars[0]), len(chars), font.line_h, cmap))
+    out.append('')
+    return name, len(data) + OLED_GLYPH_SIZE * len(chars) + len(chars) + 1, full, 'for printable ASCII'
+
+
+def main():
+    if len(sys.argv) < 5 or sys.argv[1] not in ('lvgl', 'oled'):
+        sys.exit(__doc__)
+    kind, out_path, text_path = sys.argv[1:4]
+    fonts = dict(arg.split('=', 1) for arg in sys.argv[4:])
+    chars = scan(text_path, fonts)
+    out = ['// Generated by fonts/font_subset.py from the DISPLAY_TEXT strings of %s, do not edit'
+           % text_path.replace('\\', '/').split('/')[-1]]
+    out += ['#include "lvgl.h"', ''] if kind == 'lvgl' else ['#include "oled_fb.h"', '']
+    saved = 0
+    for key, path in fonts.items():
+        font = LvFont(path)
+        if not chars[key]:
+            fail('%s: no DISPLAY_TEXT uses font %s' % (text_path, key))
+        for c, line in chars[key].items():
+            if font.glyph(ord(c)) is None:
+                fail('%s:%d: font %s has no glyph for %s (U+%04X)' % (text_path, line, key, repr(c), ord(c)))
+        used = sorted(chars[key], key=ord)
+        name, size, full, what = (emit_lvgl if kind == 'lvgl' else emit_oled)(key, font, used, out)
+        saved += full - size
+        print('%s: %d of %d glyphs, %d bytes instead of %d %s, %d saved'
+              % (name, len(used), len(font.gid), size, full, what, full - size))
+    print('display fonts: %d bytes saved' % saved)
+    with open(out_path, 'w') as f:
+        f.write('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
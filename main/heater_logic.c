@@ -0,0 +1,353 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <string.h>
+#include "heater_logic.h"
+#include "sensor_math.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+// button modes. e.g value 5 equals 6 modes: 0,1,2,3,4,5 and value 1 equals 2 modes: 0,1
+#define button_mode_button 2
+#define button_on_off 1
+#define button_on_off_duty_cycle 5
+// zone buttons: heater_zones[].levels
+
+#define LEDC_DUTY               (1000) //4000 Mode buttons LED brightness
+
+#define DEWPOINT_SPREAD_MAX     (15)   // 0.1 C, heat when the air is this close to its dew point (about 90% humidity)
+#define DEWPOINT_HOLD_LEVEL     (1)    // dewpoint mode after the boost window while the air stays humid, keeps the surfaces above the dew point
+
+/**********************
+ *  ARRAYS
+ **********************/
+static const uint8_t led_states[HEATER_LEVEL_NUM] = { // Possible led states that can be assigned to symbols array for current project. leds are lit from left to right
+    0b00000000,     // 0 led
+    0b10000000,     // 1 led
+    0b11000000,     // 2 led
+    0b11100000,     // 3 led
+    0b11110000,     // 4 led
+    0b11111000      // 5 led
+};
+
+static const uint32_t duty_cycles[HEATER_LEVEL_NUM]={  // PWM duty cycle preset values for the 5 Mosfets. 13 bit resolution: set duty to e.g. 50%: ((2 ** 13) - 1) * 50% = 4095.
+//  0%, 20%,  40%,  60%,  80%, 100%
+    0, 1638, 3276, 4914, 6552, 8191
+};
+
+static const uint32_t duty_cycles_LED[HEATER_LEVEL_NUM]={  // Duty cycle preset values to control mode led brightness. 13 bit resolution: set duty to e.g. 50%: ((2 ** 13) - 1) * 50% = 4095
+    5, 300, 2000, 5000, 7000, 8191
+};
+
+static const uint8_t max7219_LED_brightness[HEATER_LEVEL_NUM]={  // Duty cycle to control mode led array brightness. Value has to be between 0-15
+    0, 2, 5, 9, 12, 15
+};
+
+// LEDc channels 0-2 use mode_states as input for the duty cycle, the lit entry is scaled by the brightness setting
+static const uint32_t mode_states[3][3]={ // LEDS_DUTY controls the mode LEDs light intensity
+    {LEDC_DUTY, 0, 0},
+    {0, LEDC_DUTY, 0},
+    {0, 0, LEDC_DUTY}
+};
+
+/**********************
+ *  VARIABLES
+ **********************/
+static int8_t zone_of_pad[HEATER_PAD_MAX];     // zone stepped by a touch pad, -1: none. Built from the zone table by heater_init()
+
+/**********************
+ *  MODES
+ **********************/
+// Auto mode:
+// - inputs: Temp and Relative humidity.
+// -- Temp array give input to power level
+// -- Dew-point spread <= 1.5 C set 100% power level for the boost window, then whatever temp array demands, see heater_boost()
+// -- Off while the last sample is older than HEATER_SENSOR_TIMEOUT_S
+static int mode_auto(const heater_state_t *s){
+    static const int16_t temp_auto_array[6]={   // 0.1 C
+        290,   //    > 15 C
+        280,   // 10 < 15 C
+        270,   //  8 < 10 C
+        260,   //  5 <  8 C
+        250,   //  0 <  5 C
+        240    //    <  0 C
+    };
+
+    // power level is the number of temp limits above the measured temp, minus one. Warmer than all limits is off.
+    int below = 0;
+    for(int i = 0; i < 6; i++){
+        if(s->temperature < temp_auto_array[i]){
+            below++;
+        }
+    }
+    return below > 0 ? below - 1 : 0;
+}
+
+// Dewpoint mode:
+// -input: Temp and Relative humidity
+// -- Dew-point spread <= 1.5 C set 100% power level for the boost window, see heater_boost()
+// -- then DEWPOINT_HOLD_LEVEL as long as the spread stays <= 1.5 C, off once the air dries
+// -- Off while the last sample is older than HEATER_SENSOR_TIMEOUT_S
+
+static void heater_levels(heater_state_t *s)   // compute the power levels for the active mode, the only place pl[] is written
+{
+    int level;
+
+    if(s->on_off_b_state == 0){                 // OFF state
+        memset(s->pl, 0, sizeof(s->pl));
+        return;
+    }
+    switch(s->mode_b_state){
+        case MODE_MANUAL:                       // all settings are set manual
+            for(int z = 0; z < HEATER_ZONE_NUM; z++){
+                int follows = heater_zones[z].follows;  // the thumb takes the grips level, or its long press level while overridden
+                if(follows < 0){
+                    s->pl[z] = s->level_b_state[z];
+                }
+                else{
+                    s->pl[z] = s->override[follows] ? s->level_b_long[follows] : s->level_b_state[follows];
+                }
+            }
+            return;
+        case MODE_DEWPOINT:
+            level = s->spread <= DEWPOINT_SPREAD_MAX ? DEWPOINT_HOLD_LEVEL : 0;
+            break;
+        case MODE_AUTO:
+        default:
+            level = mode_auto(s);
+            break;
+    }
+    if(s->sensor_stale){                        // heating on old data could run forever on a dead sensor
+        memset(s->pl, 0, sizeof(s->pl));
+        return;
+    }
+    for(int i = 0; i < HEATER_ZONE_NUM; i++){
+        s->pl[i] = s->boost[i] ? HEATER_LEVEL_NUM - 1 : level;
+    }
+}
+
+static void heater_outputs(const heater_state_t *s, heater_outputs_t *out)  // map power levels and brightness to the LED matrix, mode LEDs and PWM outputs
+{
+    // max7219 LED array and mode LEDs brightness, set with on/off button long press
+    out->brightness = max7219_LED_brightness[s->on_off_b_long];
+
+    // Write power levels to led matrix
+    memset(out->symbols, 0, sizeof(out->symbols));
+    for(int z = 0; z < HEATER_ZONE_NUM; z++){
+        int row = heater_zones[z].led_row;
+        if(row >= 0 && row < HEATER_LED_ROWS){
+            out->symbols[row] = led_states[s->pl[z]];
+        }
+    }
+
+    // mode state leds output, dark when off
+    for(int i = 0; i < HEATER_MODE_NUM; i++){
+        uint32_t duty = mode_states[s->mode_b_state][i] ? duty_cycles_LED[s->on_off_b_long] : 0;
+        out->duty[i] = s->on_off_b_state ? duty : 0;
+    }
+    // Write power levels to PWM output channels for Mosfets. 0-5 = 0-100%
+    for(int z = 0; z < HEATER_ZONE_NUM; z++){
+        out->duty[HEATER_MODE_NUM + z] = duty_cycles[s->pl[z]];
+    }
+}
+
+/**********************
+ *  BUTTONS
+ **********************/
+static int next_state(int state, int last)  // increment states for each button press, wrap to 0 after last
+{
+    return state >= last ? 0 : state + 1;
+}
+
+static bool heater_button(heater_t *heater, uint32_t pad, button_gesture_t gesture)  // button state transitions, true when a remembered state changed
+{
+    heater_state_t *s = &heater->state;
+
+    if (gesture == BUTTON_PRESS) {
+        s->press = true;
+        s->long_press = false;
+        return false;
+    }
+    if (gesture == BUTTON_LONGPRESS) {
+        s->press = false;
+        s->long_press = true;
+        return false;
+    }
+
+    // BUTTON_RELEASE
+    bool short_press = s->press == true && s->long_press == false;
+    bool held = s->press == false && s->long_press == true;
+    bool changed = true;
+
+    switch(pad){
+        case HEATER_PAD_ON_OFF:
+            if(short_press){
+                s->on_off_b_state = next_state(s->on_off_b_state, button_on_off);
+            }
+            else if(held){                      // LED duty dim control, start @ 1 to not dim LEDs to 0
+                s->on_off_b_long = s->on_off_b_long >= button_on_off_duty_cycle ? 1 : s->on_off_b_long + 1;
+            }
+            break;
+        case HEATER_PAD_MODE:
+            s->mode_b_state = next_state(s->mode_b_state, button_mode_button);
+            break;
+        default:{                               // zone buttons, one table lookup whatever the number of zones
+            int z = pad < HEATER_PAD_MAX ? zone_of_pad[pad] : -1;
+            if(z < 0){
+                changed = false;
+            }
+            else if(heater_zones[z].nvs_key_long == NULL || short_press){
+                s->level_b_state[z] = next_state(s->level_b_state[z], heater_zones[z].levels);
+            }
+            else if(held){                      // the following zones take this level for a while
+                s->level_b_long[z] = next_state(s->level_b_long[z], heater_zones[z].levels);
+                s->override[z] = true;
+                heater->hal.timer(heater->hal.ctx, HEATER_TIMER_OVERRIDE + z, HEATER_OVERRIDE_S);
+            }
+            break;
+        }
+    }
+    s->long_press = false;
+    return changed;
+}
+
+/**********************
+ *  TIMERS
+ **********************/
+static void heater_boost(heater_t *heater)     // start the boost windows once per humid spell, end them when switched off
+{
+    heater_state_t *s = &heater->state;
+
+    if(s->on_off_b_state == 0){
+        for(int z = 0; z < HEATER_ZONE_NUM; z++){
+            if(s->boost[z]){
+                s->boost[z] = false;
+                heater->hal.timer(heater->hal.ctx, HEATER_TIMER_BOOST + z, 0);
+            }
+        }
+        s->boosted = false;                     // switching on in humid air boosts again
+        return;
+    }
+    if(s->spread > DEWPOINT_SPREAD_MAX){
+        s->boosted = false;                     // running windows end on their timers
+        return;
+    }
+    if(s->boosted || s->sensor_stale || s->mode_b_state == MODE_MANUAL){
+        return;
+    }
+    s->boosted = true;
+    for(int z = 0; z < HEATER_ZONE_NUM; z++){
+        if(heater_zones[z].boost_s > 0){
+            s->boost[z] = true;
+            heater->hal.timer(heater->hal.ctx, HEATER_TIMER_BOOST + z, heater_zones[z].boost_s);
+        }
+    }
+}
+
+static bool heater_expired(heater_state_t *s, heater_timer_t timer)    // end a timed window, true when a remembered state changed
+{
+    if(timer >= HEATER_TIMER_BOOST && timer < HEATER_TIMER_OVERRIDE){
+        s->boost[timer - HEATER_TIMER_BOOST] = false;
+    }
+    else if(timer >= HEATER_TIMER_OVERRIDE && timer < HEATER_TIMER_AUTO_OFF){
+        s->override[timer - HEATER_TIMER_OVERRIDE] = false;
+    }
+    else if(timer == HEATER_TIMER_AUTO_OFF && s->on_off_b_state){
+        s->on_off_b_state = 0;
+        return true;
+    }
+    else if(timer == HEATER_TIMER_SENSOR){
+        s->sensor_stale = true;
+    }
+    return false;
+}
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static void heater_zones_map(void)     // touch pad to zone lookup from the zone table
+{
+    for(int pad = 0; pad < HEATER_PAD_MAX; pad++){
+        zone_of_pad[pad] = -1;
+    }
+    for(int z = 0; z < HEATER_ZONE_NUM; z++){
+        const heater_zone_t *zone = &heater_zones[z];
+        if(zone->pad < HEATER_PAD_MAX){
+            zone_of_pad[zone->pad] = z;
+        }
+    }
+}
+
+void heater_compute(heater_state_t *state, heater_outputs_t *out)
+{
+    heater_levels(state);
+    heater_outputs(state, out);
+}
+
+static int clamp_state(int state, int last)
+{
+    return (state < 0 || state > last) ? 0 : state;
+}
+
+void heater_init(heater_t *heater, const heater_state_t *restored, const heater_hal_t *hal)
+{
+    heater->state = *restored;
+    heater_state_t *s = &heater->state;
+
+    // no sample yet: no heat in auto and dewpoint mode until the first sensor event
+    s->sensor_stale = true;
+    s->dewpoint = sensor_dewpoint(s->temperature, s->humidity);
+    s->spread = sensor_spread(s->temperature, s->humidity);
+
+    // restored values index the preset tables, never trust them blindly
+    s->mode_b_state   = clamp_state(s->mode_b_state, button_mode_button);
+    s->on_off_b_state = clamp_state(s->on_off_b_state, button_on_off);
+    s->on_off_b_long  = clamp_state(s->on_off_b_long, button_on_off_duty_cycle);
+    for(int z = 0; z < HEATER_ZONE_NUM; z++){
+        s->level_b_state[z] = clamp_state(s->level_b_state[z], heater_zones[z].levels);
+        s->level_b_long[z]  = clamp_state(s->level_b_long[z], heater_zones[z].levels);
+    }
+    heater_zones_map();
+    heater->hal = *hal;
+    if(HEATER_AUTO_OFF_S > 0 && s->on_off_b_state){
+        heater->hal.timer(heater->hal.ctx, HEATER_TIMER_AUTO_OFF, HEATER_AUTO_OFF_S);
+    }
+    heater_compute(&heater->state, &heater->out);
+    heater->hal.apply(heater->hal.ctx, &heater->out);
+}
+
+void heater_step(heater_t *heater, const control_event_t *event)
+{
+    heater_state_t *s = &heater->state;
+
+    switch(event->type){
+        case CONTROL_EVT_BUTTON:
+            if(heater_button(heater, event->button.pad, event->button.gesture)){
+                heater->hal.save(heater->hal.ctx, s);
+            }
+            if(HEATER_AUTO_OFF_S > 0 && event->button.gesture == BUTTON_RELEASE){
+                heater->hal.timer(heater->hal.ctx, HEATER_TIMER_AUTO_OFF, s->on_off_b_state ? HEATER_AUTO_OFF_S : 0);
+            }
+            break;
+        case CONTROL_EVT_SENSOR:
+            s->temperature = event->sensor.temperature;
+            s->humidity = event->sensor.humidity;
+            s->dewpoint = sensor_dewpoint(s->temperature, s->humidity);
+            s->spread = sensor_spread(s->temperature, s->humidity);
+            s->sensor_stale = false;
+            heater->hal.timer(heater->hal.ctx, HEATER_TIMER_SENSOR, HEATER_SENSOR_TIMEOUT_S);
+            break;
+        case CONTROL_EVT_TICK:
+            break;
+        case CONTROL_EVT_TIMER:
+            if(heater_expired(s, event->timer)){
+                heater->hal.save(heater->hal.ctx, s);
+            }
+            break;
+    }
+
+    heater_boost(heater);
+    heater_compute(s, &heater->out);
+    heater->hal.apply(heater->hal.ctx, &heater->out);
+}
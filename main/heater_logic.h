@@ -0,0 +1,132 @@
+/*
+Heater control logic:
+-Button state transitions, the Auto/Manual/Dewpoint power level computation and the mapping to duty cycles and LED rows.
+-Dewpoint mode heats only while the air is within 1.5 C of its dew point: 100% in the boost window, then 20% (DEWPOINT_HOLD_LEVEL in
+ heater_logic.c) for as long as the spread stays there, off once the air dries.
+-Zones, their buttons and LED rows come from the zone table, see heater_zones.h.
+-Timed windows run on timers started through the HAL, their expiry comes back as an event: the boost of every zone when the air
+ gets close to its dew point, the long press override of following zones and the optional auto-off.
+-Auto and dewpoint mode heat on the DHT22 samples only while they are fresh: HEATER_SENSOR_TIMEOUT_S without a valid sample and
+ those zones go to 0 until the next one arrives.
+-Plain C without ESP-IDF dependencies, all hardware access goes through heater_hal_t.
+-Builds for the ESP32-S2 in the main component and natively on a workstation, see host/CMakeLists.txt.
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "heater_zones.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define HEATER_LED_ROWS         (4)     // rows of the max7219 LED matrix in use
+#define HEATER_LEVEL_NUM        (6)     // power levels 0-5 = 0-100%
+#define HEATER_OVERRIDE_S       (600)   // a long press level holds this long on the following zones (thumb), then they follow again
+#define HEATER_AUTO_OFF_S       (0)     // switch off this long after the last button release, 0 = never
+#define HEATER_SENSOR_TIMEOUT_S (30)    // no valid DHT22 sample for this long (6 reads while on): auto and dewpoint mode stop heating
+
+/**********************
+ *  TYPES
+ **********************/
+typedef enum {
+    CONTROL_EVT_BUTTON,     // touch button gesture
+    CONTROL_EVT_SENSOR,     // new valid DHT22 sample, failed reads post nothing
+    CONTROL_EVT_TICK,       // periodic timer tick
+    CONTROL_EVT_TIMER       // a timer started through heater_hal_t expired
+} control_event_type_t;
+
+typedef enum {
+    HEATER_TIMER_BOOST,                                             // + zone: end of the zone's boost window
+    HEATER_TIMER_OVERRIDE = HEATER_TIMER_BOOST + HEATER_ZONE_NUM,   // + zone: end of the long press level on its followers
+    HEATER_TIMER_AUTO_OFF = HEATER_TIMER_OVERRIDE + HEATER_ZONE_NUM,
+    HEATER_TIMER_SENSOR,                                            // restarted by every sample: the last one is too old
+    HEATER_TIMER_NUM
+} heater_timer_t;
+
+typedef enum {
+    BUTTON_PRESS,
+    BUTTON_LONGPRESS,
+    BUTTON_RELEASE
+} button_gesture_t;
+
+typedef struct {
+    control_event_type_t type;
+    union {
+        struct {
+            uint32_t pad;               // touch pad number of the button
+            button_gesture_t gesture;
+        } button;
+        struct {
+            int16_t temperature;        // 0.1 C
+            int16_t humidity;           // 0.1 %
+        } sensor;
+        heater_timer_t timer;           // expired timer
+    };
+} control_event_t;
+
+typedef enum {
+    MODE_AUTO,
+    MODE_MANUAL,
+    MODE_DEWPOINT
+} heater_mode_t;
+
+typedef struct {
+    // Current button state, remembered between power cycles
+    int mode_b_state;
+    int on_off_b_state;
+    int on_off_b_long;
+    int level_b_state[HEATER_ZONE_NUM];     // manual level per zone, see heater_zones[]
+    int level_b_long[HEATER_ZONE_NUM];      // long press setting of zones with nvs_key_long, the override level of their followers
+
+    // for button logic
+    bool press;
+    bool long_press;
+
+    int16_t temperature;            // DHT22 temp, 0.1 C
+    int16_t humidity;               // DHT22 relative humidity, 0.1 %
+    int16_t dewpoint;               // 0.1 C, from temperature and humidity
+    int16_t spread;                 // temperature - dewpoint, 0.1 C
+    bool sensor_stale;              // no valid sample within HEATER_SENSOR_TIMEOUT_S, or none yet: auto and dewpoint zones at 0
+
+    // timed windows, not remembered
+    bool boost[HEATER_ZONE_NUM];    // full power until the zone's boost timer expires
+    bool boosted;                   // the boost of the current humid spell started, cleared when the air dries
+    bool override[HEATER_ZONE_NUM]; // followers take this zone's long press level until its override timer expires
+
+    int pl[HEATER_ZONE_NUM];        // power level per zone, see heater_zones[]
+} heater_state_t;
+
+typedef struct {
+    uint32_t duty[HEATER_CH_NUM];   // PWM duty per output: mode LEDs, then the zones
+    uint8_t symbols[HEATER_LED_ROWS];   // max7219 rows, the zones show their level on led_row
+    uint8_t brightness;             // max7219 brightness 0-15
+} heater_outputs_t;
+
+typedef struct {
+    void (*apply)(void *ctx, const heater_outputs_t *out);     // drive PWM outputs and LED matrix
+    void (*save)(void *ctx, const heater_state_t *state);      // remember button states between power cycles
+    void (*timer)(void *ctx, heater_timer_t timer, uint32_t seconds);  // (re)start a timer, 0 cancels it, expiry: CONTROL_EVT_TIMER
+    void *ctx;
+} heater_hal_t;
+
+typedef struct {
+    heater_state_t state;
+    heater_outputs_t out;
+    heater_hal_t hal;
+} heater_t;
+
+/**
+ * Start the control logic from a restored state and apply the resulting outputs.
+ */
+void heater_init(heater_t *heater, const heater_state_t *restored, const heater_hal_t *hal);
+
+/**
+ * One full control step: apply the event, recompute power levels and outputs, hand them to the HAL.
+ */
+void heater_step(heater_t *heater, const control_event_t *event);
+
+/**
+ * Compute power levels and outputs for a state without touching the HAL.
+ */
+void heater_compute(heater_state_t *state, heater_outputs_t *out);
@@ -0,0 +1,58 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <string.h>
+#include "heater_snapshot.h"
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static void store_words(heater_snapshot_t *snap, const heater_state_t *state)
+{
+    uint32_t w[HEATER_SNAPSHOT_WORDS] = {0};
+
+    memcpy(w, state, sizeof(*state));
+    for (size_t i = 0; i < HEATER_SNAPSHOT_WORDS; i++) {
+        atomic_store_explicit(&snap->words[i], w[i], memory_order_relaxed);
+    }
+}
+
+void heater_snapshot_init(heater_snapshot_t *snap, const heater_state_t *state)
+{
+    store_words(snap, state);
+    atomic_store_explicit(&snap->seq, 0, memory_order_release);
+}
+
+void heater_snapshot_publish(heater_snapshot_t *snap, const heater_state_t *state)
+{
+    unsigned seq = atomic_load_explicit(&snap->seq, memory_order_relaxed);     // only this task writes seq
+
+    atomic_store_explicit(&snap->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);     // odd counter visible before any word changes
+    store_words(snap, state);
+    atomic_store_explicit(&snap->seq, seq + 2, memory_order_release);     // words visible before the even counter
+}
+
+bool heater_snapshot_read(heater_snapshot_t *snap, heater_state_t *state, uint32_t *generation)
+{
+    uint32_t w[HEATER_SNAPSHOT_WORDS];
+
+    for (int attempt = 0; attempt < HEATER_SNAPSHOT_SPINS; attempt++) {
+        unsigned begin = atomic_load_explicit(&snap->seq, memory_order_acquire);
+        if (begin & 1) {
+            continue;       // publish in progress
+        }
+        for (size_t i = 0; i < HEATER_SNAPSHOT_WORDS; i++) {
+            w[i] = atomic_load_explicit(&snap->words[i], memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);     // words read before the counter is checked again
+        if (atomic_load_explicit(&snap->seq, memory_order_relaxed) == begin) {
+            memcpy(state, w, sizeof(*state));
+            if (generation != NULL) {
+                *generation = begin / 2;
+            }
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,40 @@
+/*
+Control state snapshot:
+-The control task is the only writer of heater_state_t. It publishes a copy after every step, other tasks read that copy.
+-Seqlock: the sequence counter is odd while a publish is in progress. A reader copies the state between two reads of the
+ counter and retries if it changed, so it always gets one complete generation. Nobody takes a lock or disables interrupts.
+-The copy is held as 32 bit atomic words with relaxed loads and stores, ordered by the fences around them.
+-A reader that preempts the writer in the middle of a publish cannot succeed until the writer runs again. heater_snapshot_read()
+ therefore gives up after HEATER_SNAPSHOT_SPINS attempts, the caller then yields and tries again.
+-Plain C11 without ESP-IDF dependencies, also built natively with a multi-threaded stress test, see host/stress_snapshot.c.
+*/
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "heater_logic.h"
+
+#define HEATER_SNAPSHOT_SPINS   (4)
+#define HEATER_SNAPSHOT_WORDS   ((sizeof(heater_state_t) + sizeof(uint32_t) - 1) / sizeof(uint32_t))
+
+typedef struct {
+    atomic_uint seq;                                // 2 * generation, +1 while a publish is in progress
+    atomic_uint words[HEATER_SNAPSHOT_WORDS];       // the published heater_state_t
+} heater_snapshot_t;
+
+/**
+ * Publish the initial state as generation 0, before any reader starts.
+ */
+void heater_snapshot_init(heater_snapshot_t *snap, const heater_state_t *state);
+
+/**
+ * Publish a new generation. Single writer only, never blocks.
+ */
+void heater_snapshot_publish(heater_snapshot_t *snap, const heater_state_t *state);
+
+/**
+ * Copy the latest complete generation into *state, generation may be NULL.
+ * Returns false, with *state undefined, if a publish was in progress on every attempt.
+ */
+bool heater_snapshot_read(heater_snapshot_t *snap, heater_state_t *state, uint32_t *generation);
@@ -0,0 +1,26 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stddef.h>
+#include "heater_zones.h"
+
+/**********************
+ *  TABLES
+ **********************/
+// zone index = power level index pl[z], the order of the LED matrix rows and of the telemetry columns
+const heater_zone_t heater_zones[] = {
+    // name        gpio ch timer pad             follows row levels nvs key           long press key  boost s
+    { "backrest",    34, 7, 1, 4,               -1,     0,  5,     "back_b_state",   NULL,           1800 },
+    { "passenger",   33, 6, 1, 5,               -1,     1,  5,     "pass_b_state",   NULL,           1800 },
+    { "driver",      21, 5, 1, 6,               -1,     2,  5,     "driver_b_state", NULL,           1800 },
+    { "grips",       17, 4, 1, 11,              -1,     3,  5,     "grips_b_state",  "grips_b_long", 1800 },
+    { "thumb",       16, 3, 1, HEATER_PAD_NONE,  3,    -1,  5,     NULL,             NULL,           1800 },    // grips button, shown on the grips row, long press level as override
+};
+_Static_assert(sizeof(heater_zones) / sizeof(heater_zones[0]) == HEATER_ZONE_NUM, "HEATER_ZONE_NUM does not match the zone table");
+
+const heater_led_t heater_mode_leds[] = {
+    { 35, 0, 1 },       // auto
+    { 36, 1, 1 },       // manual
+    { 37, 2, 1 },       // dewpoint
+};
+_Static_assert(sizeof(heater_mode_leds) / sizeof(heater_mode_leds[0]) == HEATER_MODE_NUM, "HEATER_MODE_NUM does not match the mode LED table");
@@ -0,0 +1,53 @@
+/*
+Heater zone table:
+-One descriptor per heater zone: output GPIO, LEDC channel and timer, touch pad, LED matrix row, NVS key, level count and boost window.
+-The control logic, the PWM output stage, the touch setup, the persistence keys and the console all iterate this table,
+ adding a zone is one row here plus HEATER_ZONE_NUM.
+-Zones on different LEDC timers are phase staggered per timer, see pwm_out.c.
+-Plain C without ESP-IDF dependencies, also built natively, see host/CMakeLists.txt.
+*/
+#pragma once
+
+#include <stdint.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+#define HEATER_ZONE_NUM         (5)     // rows of heater_zones[], power levels pl[0..4]
+#define HEATER_MODE_NUM         (3)     // mode LEDs, one per mode
+#define HEATER_CH_NUM           (HEATER_MODE_NUM + HEATER_ZONE_NUM)     // PWM outputs: mode LEDs first, then the zones in table order
+#define HEATER_PAD_NONE         (0xff)  // zone without a button of its own
+#define HEATER_PAD_MAX          (15)    // touch pads 0-14 of the ESP32-S2
+
+// touch pad numbers of the buttons that are not zones
+#define HEATER_PAD_ON_OFF       (7)
+#define HEATER_PAD_MODE         (10)
+
+/**********************
+ *  TYPES
+ **********************/
+typedef struct {
+    const char *name;           // console and log name
+    uint8_t gpio;               // heater Mosfet gate
+    uint8_t ledc_channel;
+    uint8_t ledc_timer;
+    uint8_t pad;                // touch pad stepping the manual level, HEATER_PAD_NONE: no button
+    int8_t follows;             // zone whose manual level this zone takes, -1: its own
+    int8_t led_row;             // max7219 row showing the power level, -1: none
+    uint8_t levels;             // highest manual level, at most HEATER_LEVEL_NUM - 1, the button wraps to 0 after it
+    const char *nvs_key;        // remembered manual level, NULL: not remembered
+    const char *nvs_key_long;   // remembered long press setting, NULL: a long press steps the manual level too
+    uint16_t boost_s;           // full power window when the air gets close to its dew point (auto, dewpoint), 0: no boost
+} heater_zone_t;
+
+typedef struct {
+    uint8_t gpio;
+    uint8_t ledc_channel;
+    uint8_t ledc_timer;
+} heater_led_t;
+
+/**********************
+ *  TABLES
+ **********************/
+extern const heater_zone_t heater_zones[HEATER_ZONE_NUM];
+extern const heater_led_t heater_mode_leds[HEATER_MODE_NUM];   // auto, manual, dewpoint
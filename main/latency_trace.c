@@ -0,0 +1,114 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "latency_trace.h"
+
+/**********************
+ *  TYPES
+ **********************/
+typedef struct {
+    int64_t touch_us;                   // LAT_STAGE_TOUCH time, written before the entry is published
+    uint32_t dt[LAT_STAGE_NUM];         // us after the touch per stage, 0 = not reached yet
+} lat_entry_t;
+
+/**********************
+ *  VARIABLES
+ **********************/
+static lat_entry_t ring[LATENCY_TRACE_LEN];
+static uint32_t head;                   // number of traces opened, latest is ring[(head - 1) % LATENCY_TRACE_LEN]
+
+// stage that has to be stamped first, PWM and matrix both follow the computation
+static const lat_stage_t predecessor[LAT_STAGE_NUM] = {
+    [LAT_STAGE_TOUCH]   = LAT_STAGE_TOUCH,
+    [LAT_STAGE_STATE]   = LAT_STAGE_TOUCH,
+    [LAT_STAGE_COMPUTE] = LAT_STAGE_STATE,
+    [LAT_STAGE_PWM]     = LAT_STAGE_COMPUTE,
+    [LAT_STAGE_MATRIX]  = LAT_STAGE_COMPUTE
+};
+
+static const char *stage_names[LAT_STAGE_NUM] = {
+    "touch", "state", "compute", "pwm", "matrix"
+};
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+void latency_begin(void)
+{
+    uint32_t n = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    lat_entry_t *e = &ring[n % LATENCY_TRACE_LEN];
+
+    for (int s = 0; s < LAT_STAGE_NUM; s++) {
+        __atomic_store_n(&e->dt[s], 0, __ATOMIC_RELAXED);
+    }
+    e->touch_us = esp_timer_get_time();
+    __atomic_store_n(&e->dt[LAT_STAGE_TOUCH], 1, __ATOMIC_RELAXED);   // touch is the reference, mark it reached
+    __atomic_store_n(&head, n + 1, __ATOMIC_RELEASE);                 // publish only a fully reset entry
+}
+
+void latency_mark(lat_stage_t stage)
+{
+    uint32_t n = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    if (n == 0 || stage == LAT_STAGE_TOUCH) {
+        return;
+    }
+    lat_entry_t *e = &ring[(n - 1) % LATENCY_TRACE_LEN];
+    uint32_t prev = __atomic_load_n(&e->dt[predecessor[stage]], __ATOMIC_ACQUIRE);
+    int64_t now = esp_timer_get_time() - e->touch_us;
+
+    if (prev == 0 || now >= LATENCY_WINDOW_US) {
+        return;     // predecessor not reached, the output did not come from this touch, or the trace has expired
+    }
+    if (__atomic_load_n(&e->dt[stage], __ATOMIC_RELAXED) == 0) {
+        __atomic_store_n(&e->dt[stage], now > 1 ? (uint32_t)now : 1, __ATOMIC_RELEASE);
+    }
+}
+
+static void sort_u32(uint32_t *v, int n)    // insertion sort, n is at most LATENCY_TRACE_LEN
+{
+    for (int i = 1; i < n; i++) {
+        uint32_t x = v[i];
+        int j = i - 1;
+        while (j >= 0 && v[j] > x) {
+            v[j + 1] = v[j];
+            j--;
+        }
+        v[j + 1] = x;
+    }
+}
+
+void latency_report(void)
+{
+    uint32_t n = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    int traces = n < LATENCY_TRACE_LEN ? n : LATENCY_TRACE_LEN;
+    uint32_t v[LATENCY_TRACE_LEN];
+
+    printf("%u touch traces, latency from the touch release in us\n", (unsigned)n);
+    printf("%-8s %6s %8s %8s %8s %8s\n", "stage", "count", "min", "p50", "p99", "max");
+    for (int s = LAT_STAGE_STATE; s < LAT_STAGE_NUM; s++) {
+        int count = 0;
+        for (int i = 0; i < traces; i++) {
+            uint32_t dt = __atomic_load_n(&ring[i].dt[s], __ATOMIC_RELAXED);
+            if (dt != 0) {
+                v[count++] = dt;
+            }
+        }
+        if (count == 0) {
+            printf("%-8s %6d %8s %8s %8s %8s\n", stage_names[s], 0, "-", "-", "-", "-");
+            continue;
+        }
+        sort_u32(v, count);
+        printf("%-8s %6d %8u %8u %8u %8u\n", stage_names[s], count,
+               (unsigned)v[0], (unsigned)v[count / 2], (unsigned)v[(count * 99) / 100], (unsigned)v[count - 1]);
+    }
+}
+
+void latency_reset(void)
+{
+    __atomic_store_n(&head, 0, __ATOMIC_RELEASE);
+    memset(ring, 0, sizeof(ring));
+}
@@ -0,0 +1,41 @@
+/*
+Latency trace:
+-Fixed-size ring of touch-to-output traces, one entry per button release, stamped with esp_timer_get_time() at each pipeline stage.
+-Every stage is written by exactly one task and the ring head only by the touch task, so stamping is lock-free and never blocks.
+-A stage is only stamped when its predecessor was stamped, stale entries expire after LATENCY_WINDOW_US.
+*/
+#pragma once
+
+#include <stdint.h>
+
+#define LATENCY_TRACE_LEN       (64)        // traces kept, oldest are overwritten
+#define LATENCY_WINDOW_US       (2000000)   // stages later than this after the touch are not attributed to it
+
+typedef enum {
+    LAT_STAGE_TOUCH,        // TOUCH_BUTTON_EVT_ON_RELEASE received in button_handler_task
+    LAT_STAGE_STATE,        // release event dequeued by the control task, state transition starts
+    LAT_STAGE_COMPUTE,      // power levels and outputs computed, handed to the HAL
+    LAT_STAGE_PWM,          // ledc_update_duty done for the changed channels
+    LAT_STAGE_MATRIX,       // MAX7219 rows with the new levels queued for DMA, the transfer itself takes ~20 us
+    LAT_STAGE_NUM
+} lat_stage_t;
+
+/**
+ * Open a new trace and stamp LAT_STAGE_TOUCH. Only called from the touch task.
+ */
+void latency_begin(void);
+
+/**
+ * Stamp a stage of the latest trace with the current time.
+ */
+void latency_mark(lat_stage_t stage);
+
+/**
+ * Print min/p50/p99/max latency from the touch to every stage.
+ */
+void latency_report(void);
+
+/**
+ * Drop all traces.
+ */
+void latency_reset(void);
@@ -0,0 +1,225 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "latency_trace.h"
+#include "led_matrix.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define MAX7219_REG_DIGIT0      (0x01)      // rows are digit registers 1-8
+#define MAX7219_REG_DECODE      (0x09)
+#define MAX7219_REG_INTENSITY   (0x0A)
+#define MAX7219_REG_SCAN_LIMIT  (0x0B)
+#define MAX7219_REG_SHUTDOWN    (0x0C)
+#define MAX7219_REG_TEST        (0x0F)
+
+#define LED_MATRIX_CLOCK_HZ     (10000000)  // MAX7219 maximum
+#define SLOT_TRANS              (LED_MATRIX_ROWS + 1)   // rows + brightness
+
+/**********************
+ *  TYPES
+ **********************/
+typedef struct {
+    spi_transaction_t trans[SLOT_TRANS];
+    uint8_t *buf;               // DMA capable, SLOT_TRANS * cascade_size words
+    int queued;                 // transactions not reaped yet
+} matrix_slot_t;
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const char *TAG = "LED matrix: ";
+
+static spi_device_handle_t spi;
+static uint8_t cascade;
+static matrix_slot_t slots[2];
+static int active;                  // slot for the next frame
+
+static uint8_t shown[LED_MATRIX_CASCADE_MAX * LED_MATRIX_ROWS];    // image queued to the chips
+static int shown_brightness = -1;
+static uint8_t wanted[LED_MATRIX_CASCADE_MAX * LED_MATRIX_ROWS];   // image to show
+static uint8_t wanted_brightness;
+static bool dirty;                  // wanted differs from shown or was not compared yet
+static led_matrix_stats_t stats;
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static uint8_t *slot_words(matrix_slot_t *slot, int t)     // word buffer of transaction t
+{
+    return slot->buf + t * cascade * 2;
+}
+
+static void slot_fill(matrix_slot_t *slot, int t, uint8_t reg, const uint8_t *data, int stride)  // one register for every chip of the cascade
+{
+    uint8_t *words = slot_words(slot, t);
+
+    for (int c = 0; c < cascade; c++) {
+        words[2 * c] = reg;
+        words[2 * c + 1] = data[c * stride];
+    }
+    memset(&slot->trans[t], 0, sizeof(spi_transaction_t));
+    slot->trans[t].length = cascade * 16;
+    slot->trans[t].tx_buffer = words;
+    slot->trans[t].user = slot;
+}
+
+static void reap(void)  // collect finished transactions without waiting
+{
+    spi_transaction_t *t;
+
+    while (spi_device_get_trans_result(spi, &t, 0) == ESP_OK) {
+        ((matrix_slot_t *)t->user)->queued--;
+    }
+}
+
+static esp_err_t send_all(uint8_t reg, uint8_t value)   // blocking register write to all chips, init only
+{
+    uint8_t data[LED_MATRIX_CASCADE_MAX];
+
+    memset(data, value, sizeof(data));
+    slot_fill(&slots[0], 0, reg, data, 1);
+    return spi_device_transmit(spi, &slots[0].trans[0]);
+}
+
+esp_err_t led_matrix_init(const led_matrix_config_t *config)
+{
+    if (config->cascade_size == 0 || config->cascade_size > LED_MATRIX_CASCADE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    cascade = config->cascade_size;
+
+    spi_bus_config_t bus = {
+       .mosi_io_num = config->pin_mosi,
+       .miso_io_num = -1,
+       .sclk_io_num = config->pin_clk,
+       .quadwp_io_num = -1,
+       .quadhd_io_num = -1,
+       .max_transfer_sz = LED_MATRIX_CASCADE_MAX * 2,
+       .flags = 0
+    };
+    esp_err_t err = spi_bus_initialize(config->host, &bus, SPI_DMA_CH_AUTO);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%s) initializing SPI bus", esp_err_to_name(err));
+        return err;
+    }
+
+    spi_device_interface_config_t dev = {
+        .mode = 0,
+        .clock_speed_hz = LED_MATRIX_CLOCK_HZ,
+        .spics_io_num = config->pin_cs,
+        .queue_size = LED_MATRIX_QUEUE_LEN,
+        .flags = SPI_DEVICE_NO_DUMMY
+    };
+    err = spi_bus_add_device(config->host, &dev, &spi);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%s) adding SPI device", esp_err_to_name(err));
+        return err;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        slots[i].buf = heap_caps_malloc(SLOT_TRANS * cascade * 2, MALLOC_CAP_DMA);
+        if (slots[i].buf == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        slots[i].queued = 0;
+    }
+
+    // no BCD decoding, all 8 rows scanned, matrix cleared and dark before the display is switched on
+    err = send_all(MAX7219_REG_TEST, 0);
+    if (err == ESP_OK) err = send_all(MAX7219_REG_DECODE, 0);
+    if (err == ESP_OK) err = send_all(MAX7219_REG_SCAN_LIMIT, LED_MATRIX_ROWS - 1);
+    if (err == ESP_OK) err = send_all(MAX7219_REG_INTENSITY, 0);
+    for (int r = 0; r < LED_MATRIX_ROWS && err == ESP_OK; r++) {
+        err = send_all(MAX7219_REG_DIGIT0 + r, 0);
+    }
+    if (err == ESP_OK) err = send_all(MAX7219_REG_SHUTDOWN, 1);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%s) setting up MAX7219", esp_err_to_name(err));
+        return err;
+    }
+    memset(shown, 0, sizeof(shown));
+    shown_brightness = 0;
+    return ESP_OK;
+}
+
+void led_matrix_flush(void)
+{
+    if (!dirty) {
+        return;
+    }
+    reap();
+
+    matrix_slot_t *slot = &slots[active];
+    if (slot->queued > 0) {
+        stats.deferred++;       // the previous frame in this buffer is still on the bus
+        return;
+    }
+
+    // one transaction per changed row, each with the row of every chip
+    int row_of[SLOT_TRANS];     // row per transaction, -1 for brightness
+    int n = 0;
+    for (int r = 0; r < LED_MATRIX_ROWS; r++) {
+        bool changed = false;
+        for (int c = 0; c < cascade; c++) {
+            changed |= wanted[c * LED_MATRIX_ROWS + r] != shown[c * LED_MATRIX_ROWS + r];
+        }
+        if (changed) {
+            row_of[n] = r;
+            slot_fill(slot, n++, MAX7219_REG_DIGIT0 + r, &wanted[r], LED_MATRIX_ROWS);
+        }
+    }
+    if (wanted_brightness != shown_brightness) {
+        uint8_t level[LED_MATRIX_CASCADE_MAX];
+        memset(level, wanted_brightness, sizeof(level));
+        row_of[n] = -1;
+        slot_fill(slot, n++, MAX7219_REG_INTENSITY, level, 1);
+    }
+    if (n == 0) {
+        stats.skipped++;
+        dirty = false;
+        return;
+    }
+
+    for (int t = 0; t < n; t++) {
+        if (spi_device_queue_trans(spi, &slot->trans[t], 0) != ESP_OK) {
+            stats.errors++;     // the frame stays dirty, rows not queued yet are sent later
+            return;
+        }
+        slot->queued++;
+        if (row_of[t] < 0) {
+            shown_brightness = wanted_brightness;
+            continue;
+        }
+        for (int c = 0; c < cascade; c++) {
+            shown[c * LED_MATRIX_ROWS + row_of[t]] = wanted[c * LED_MATRIX_ROWS + row_of[t]];
+        }
+        stats.rows_sent++;
+    }
+    active ^= 1;
+    dirty = false;
+    stats.frames++;
+    latency_mark(LAT_STAGE_MATRIX);
+}
+
+bool led_matrix_show(const uint8_t *image, uint8_t brightness)
+{
+    if (!dirty && brightness == shown_brightness && memcmp(image, shown, cascade * LED_MATRIX_ROWS) == 0) {
+        stats.skipped++;
+        return true;
+    }
+    memcpy(wanted, image, cascade * LED_MATRIX_ROWS);
+    wanted_brightness = brightness;
+    dirty = true;
+    led_matrix_flush();
+    return !dirty;
+}
+
+void led_matrix_get_stats(led_matrix_stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,55 @@
+/*
+MAX7219 LED matrix driver:
+-Own SPI device with DMA and a transaction queue, frames are queued and the caller never waits for the bus.
+-Only rows that differ from what the chips already show are sent, brightness only when it changed.
+-One transaction per changed row carries the words for all chips of the cascade, so a frame costs at most 8 (+1 brightness) chip selects for any CASCADE_SIZE.
+-Two transaction buffers are used in turn. If both are still on the bus the frame is kept and sent by the next led_matrix_show() or led_matrix_flush().
+-Not thread safe, all calls have to come from one task (the control task).
+*/
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/spi_master.h"
+
+#define LED_MATRIX_ROWS         (8)         // digit registers per MAX7219
+#define LED_MATRIX_CASCADE_MAX  (8)         // chips per chain supported
+#define LED_MATRIX_QUEUE_LEN    (2 * (LED_MATRIX_ROWS + 1))     // two frames of rows + brightness in flight
+
+typedef struct {
+    spi_host_device_t host;
+    int pin_mosi;
+    int pin_clk;
+    int pin_cs;
+    uint8_t cascade_size;       // chips in the chain, 1..LED_MATRIX_CASCADE_MAX
+} led_matrix_config_t;
+
+typedef struct {
+    uint32_t frames;            // frames queued
+    uint32_t rows_sent;         // row transactions queued
+    uint32_t skipped;           // frames equal to what is shown, nothing sent
+    uint32_t deferred;          // frames postponed because both buffers were in flight
+    uint32_t errors;            // failed queue operations
+} led_matrix_stats_t;
+
+/**
+ * Initialize the SPI bus and device, set up all chips and clear the matrix. Blocks, call once at startup.
+ */
+esp_err_t led_matrix_init(const led_matrix_config_t *config);
+
+/**
+ * Show an image of cascade_size * LED_MATRIX_ROWS bytes, chip 0 first, and set the brightness 0-15.
+ * Returns false when the frame was deferred, it is then sent by the next call or led_matrix_flush().
+ */
+bool led_matrix_show(const uint8_t *image, uint8_t brightness);
+
+/**
+ * Send a deferred frame, if any.
+ */
+void led_matrix_flush(void);
+
+/**
+ * Copy the frame counters.
+ */
+void led_matrix_get_stats(led_matrix_stats_t *stats);
@@ -7,7 +7,7 @@ Mode button:
 
 Grip/throttle button:
 -Press: Grips power level
--Long press: Thumb power level
+-Long press: Thumb power level for 10 minutes, then the thumb follows the grips again
 
 Other buttons:
 -Set power levels on release
@@ -15,14 +15,15 @@ Other buttons:
 Auto mode:
 - inputs: Temp and Relative humidity.
 -- Temp array give input to power level
--- Relative humidity > 90% set 100% power level for 30 minutes, then off or whatever temp array demands
+-- Air within 1.5 C of its dew point (about 90% relative humidity) set 100% power level for 30 minutes, then off or whatever temp array demands
 
 Manual mode:
 -All settings are set manual, settings are remembered between power cycles
 
 Dewpoint mode:
--input: Relative humidity
--- Relative humidity > 90% set 100% power level for 30 minutes, then off
+-input: Temp and Relative humidity
+-- Air within 1.5 C of its dew point (about 90% relative humidity) set 100% power level for 30 minutes
+-- then 20% power level (DEWPOINT_HOLD_LEVEL) as long as the air stays within 1.5 C of its dew point, off once it dries
 */
 
 /*********************
@@ -30,33 +31,42 @@ Dewpoint mode:
  *********************/
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_log.h"
-#include "lvgl.h"
-#include "lvgl_helpers.h"
 #include "esp_freertos_hooks.h"
-#include "freertos/semphr.h"
 #include "touch_element/touch_button.h"
 #include "driver/gpio.h"
 #include "esp_idf_version.h"
-#include "max7219.h"
 #include "stdio.h"
-#include <dht.h>
-#include "driver/ledc.h"
+#include <string.h>
+#include "pwm_out.h"
 #include "esp_system.h"
 #include "esp_spi_flash.h"
 #include "esp_err.h"
-#include "nvs_flash.h"
+#include "esp_timer.h"
+#include "persist.h"
+#include "heater_logic.h"
+#include "heater_snapshot.h"
+#include "latency_trace.h"
+#include "console.h"
+#include "led_matrix.h"
+#include "dht_rmt.h"
+#include "display.h"
+#include "power.h"
+#include "telemetry.h"
+#include "boot_trace.h"
+#include "executive.h"
+#include "blog.h"
+#include "touch_tune.h"
+#include "supervisor.h"
+#include "timer_service.h"
 
 /*********************
  *      DEFINES
  *********************/
 
-// LVGL display controller
-#define LV_TICK_PERIOD_MS 1
-
 // max7219 specific
-#define SCROLL_DELAY 50
-#define CASCADE_SIZE 1
+#define CASCADE_SIZE 1      // number of chained max7219 chips
 
 #ifndef APP_CPU_NUM
 #define APP_CPU_NUM PRO_CPU_NUM
@@ -71,72 +81,47 @@ Dewpoint mode:
 #define PIN_NUM_CLK  3  // CLK  pin 13 on max7219
 #define PIN_NUM_CS   2  // LOAD pin12 on max7219
 
-// modes specific
-#define led_auto 35         // gpio for mode LED
-#define led_manual 36       // gpio for mode LED
-#define led_dewpoint 37     // gpio for mode LED
+// control core specific
+#define CONTROL_QUEUE_LEN       16      // pending events for the control task
+#define CONTROL_TICK_MS         60000   // periodic re-evaluation and task switch statistics
+#define CONTROL_TICK_DEADLINE_MS 1000   // executive deadline of the tick job
+#define CONTROL_STEP_DEADLINE_MS 500    // supervisor deadline of one event, a step takes well under 1 ms plus the LED matrix flush
 
-// button modes. e.g value 5 equals 6 modes: 0,1,2,3,4,5 and value 1 equals 2 modes: 0,1
-#define button_mode_button 2
-#define button_on_off 1
-#define button_on_off_duty_cycle 5
-#define button_grips 5
-#define button_grips_thumb 5
-#define button_driver_seat 5
-#define button_Passenger_seat 5
-#define button_backrest 5
+// DHT22 specific
+#define DHT_PERIOD_ON_MS        5000    // sample period while the system is on, more often heats up the sensor
+#define DHT_PERIOD_OFF_MS       60000   // sample period while off, for the display only
+#define DHT_DEADLINE_MS         1000    // executive deadline of a sample, the capture itself takes about 25 ms
 
 // touch button specific
-#define TOUCH_BUTTON_NUM        6       // total number of touch button channels, see channel array for details
+#define TOUCH_BUTTON_MAX        (2 + HEATER_ZONE_NUM)   // on/off and mode, then the zone buttons from the zone table
+#define TOUCH_BUTTON_SENS       0.15F   // touch element library sensitivity of every button
 
-// PWM output specific
-#define LEDC_LS_CH0_GPIO       (35)     // PWM output channel for auto mode LED
-#define LEDC_LS_CH0_CHANNEL    LEDC_CHANNEL_0
-#define LEDC_LS_CH1_GPIO       (36)     // PWM output channel for manual mode LED
-#define LEDC_LS_CH1_CHANNEL    LEDC_CHANNEL_1
-#define LEDC_LS_CH2_GPIO       (37)     // PWM output channel for dewpoint mode LED
-#define LEDC_LS_CH2_CHANNEL    LEDC_CHANNEL_2
-#define LEDC_LS_CH3_GPIO       (16)     // PWM output channel for thumb heater
-#define LEDC_LS_CH3_CHANNEL    LEDC_CHANNEL_3
-#define LEDC_LS_CH4_GPIO       (17)     // PWM output channel for grip heater
-#define LEDC_LS_CH4_CHANNEL    LEDC_CHANNEL_4
-#define LEDC_LS_CH5_GPIO       (21)     // PWM output channel for driver seat heater
-#define LEDC_LS_CH5_CHANNEL    LEDC_CHANNEL_5
-#define LEDC_LS_CH6_GPIO       (33)     // PWM output channel for Passenger seat heater
-#define LEDC_LS_CH6_CHANNEL    LEDC_CHANNEL_6
-#define LEDC_LS_CH7_GPIO       (34)     // PWM output channel for Back rest heater
-#define LEDC_LS_CH7_CHANNEL    LEDC_CHANNEL_7
-#define LEDC_LS_TIMER          LEDC_TIMER_1
-#define LEDC_LS_MODE           LEDC_LOW_SPEED_MODE
-#define LEDC_CH_NUM             (8)     // total number of channels
-#define LEDC_DUTY               (1000) //4000 Mode buttons LED brightness
-#define LEDC_FADE_TIME          (3000)
+// persistence specific: the system buttons, then the manual level and long press setting of every zone with an NVS key
+#define PERSIST_SLOT_ON_OFF     0
+#define PERSIST_SLOT_ON_OFF_LONG 1
+#define PERSIST_SLOT_MODE       2
+#define PERSIST_SLOT_ZONES      3
 
 
 /**********************
  *  STATIC TASKS
  **********************/
-static void lv_tick_task(void *arg);
-static void guiTask(void *pvParameter);
+static void control_post(const control_event_t *event);
+static void control_get_state(heater_state_t *state);
 
 /**********************
  *  HANDLES
  **********************/
-TaskHandle_t xMode_auto;
-TaskHandle_t xMode_manual;
-TaskHandle_t xMode_dewpoint;
-TaskHandle_t xNVS_read_write;
-TaskHandle_t xNVS_write;
-nvs_handle_t my_handle;
-esp_err_t err;
-SemaphoreHandle_t xGuiSemaphore;    /* Creates a semaphore to handle concurrent call to lvgl stuff. If you wish to call *any* lvgl function from other threads/tasks you should lock on the very same semaphore! */
-static touch_button_handle_t button_handle[TOUCH_BUTTON_NUM]; // Touch buttons handle
+QueueHandle_t xControl_queue;       // events for the control task
+static exec_job_t dht_job = -1;     // sensor sampling, run early when the system is switched on
+static sup_watch_t control_watch = -1;  // heartbeat per event, the tick job posts one at least every CONTROL_TICK_MS
+static touch_button_handle_t button_handle[TOUCH_BUTTON_MAX]; // Touch buttons handle
 
 
 /**********************
  *  ARRAYS
  **********************/
-u_char symbols[] = { // Array for max7219 LED matrix
+static uint8_t symbols[CASCADE_SIZE * LED_MATRIX_ROWS] = { // Array for max7219 LED matrix, chip 0 first
     0b00000000, // backrest leds
     0b00000000, // passenger seat leds
     0b00000000, // driver seat leds
@@ -147,59 +132,21 @@ u_char symbols[] = { // Array for max7219 LED matrix
     0b00000000  // not in use for current project
 };
 
-const static size_t symbols_size = sizeof(symbols) - sizeof(u_char) * CASCADE_SIZE;
-
-static const u_char led_states[] = { // Possible led states that can be assigned to symbols array for current project. leds are lit from left to right
-    0b00000000,     // 0 led
-    0b10000000,     // 1 led
-    0b11000000,     // 2 led
-    0b11100000,     // 3 led
-    0b11110000,     // 4 led 
-    0b11111000      // 5 led
-};
-
-static const touch_pad_t channel_array[TOUCH_BUTTON_NUM] = {    /* Touch buttons channel array */
-    TOUCH_PAD_NUM4,     //button_backrest
-    TOUCH_PAD_NUM5,     //button_Passenger_seat
-    TOUCH_PAD_NUM6,     //button_driver_seat
-    TOUCH_PAD_NUM7,     //button_on_off
-    TOUCH_PAD_NUM10,    //button_mode button
-    TOUCH_PAD_NUM11,    //button_grips
-};
-
-static const float channel_sens_array[TOUCH_BUTTON_NUM] = {     /* Touch buttons channel sensitivity array */
-    0.15F,
-    0.15F,
-    0.15F,
-    0.15F,
-    0.15F,
-    0.15F,
-};
-
-int *LED_levels[4];   // array with current power levels used for LED array, input may come from different modes/user input
-
-// LEDc channels 3-7 use power_levels as input for the duty cycle
-int power_levels[8]; // array with current power levels for the PWM outputs.
-
-uint32_t duty_cycles[6]={  // PWM duty cycle preset values for the 5 Mosfets. 13 bit resolution: set duty to e.g. 50%: ((2 ** 13) - 1) * 50% = 4095.
-//  0%, 20%,  40%,  60%,  80%, 100%    
-    0, 1638, 3276, 4914, 6552, 8191
+static touch_pad_t channel_array[TOUCH_BUTTON_MAX] = {     /* Touch buttons channel array, the zone buttons follow from the zone table */
+    HEATER_PAD_ON_OFF,  //button_on_off
+    HEATER_PAD_MODE,    //button_mode button
 };
+static int touch_button_num = 2;
 
-uint32_t duty_cycles_LED[6]={  // Duty cycle preset values to control mode led brightness. 13 bit resolution: set duty to e.g. 50%: ((2 ** 13) - 1) * 50% = 4095
-    5, 300, 2000, 5000, 7000, 8191
-};
-
-uint32_t max7219_LED_brightness[6]={  // Duty cycle to control mode led array brightness. Value has to be between 0-15
-    0, 2, 5, 9, 12, 15
-};
-
-// LEDc channels 0-2 use mode_states as input for the duty cycle
-int mode_states[3][3]={ // LEDS_DUTY controls the mode LEDs light intensity
-    {LEDC_DUTY, 0, 0},
-    {0, LEDC_DUTY, 0},
-    {0, 0, LEDC_DUTY}
+static const char *persist_keys[PERSIST_VALUES_MAX] = {     /* NVS keys of the remembered values, the zone keys follow from the zone table */
+    [PERSIST_SLOT_ON_OFF]       = "on_off_b_state",
+    [PERSIST_SLOT_ON_OFF_LONG]  = "on_off_b_long",
+    [PERSIST_SLOT_MODE]         = "mode_b_state",
 };
+static int persist_key_num = PERSIST_SLOT_ZONES;
+static int8_t persist_slot[HEATER_ZONE_NUM];        // slot of a zone's manual level, -1: not remembered
+static int8_t persist_slot_long[HEATER_ZONE_NUM];   // slot of a zone's long press setting, -1: not remembered
+_Static_assert(PERSIST_SLOT_ZONES + 2 * HEATER_ZONE_NUM <= PERSIST_VALUES_MAX, "too many remembered values for the persistence engine");
 
 /**********************
  *  TAGS
@@ -210,800 +157,308 @@ static const char *TAG03 = "DHT22: ";
 /**********************
  *  DHT22
  **********************/
-static const dht_sensor_type_t sensor_type = DHT_TYPE_AM2301; //AM2301 is for DHT22
 static const gpio_num_t dht_gpio = 38;
+static const rmt_channel_t dht_rmt_channel = RMT_CHANNEL_0;   // RX capture of the DHT22 answer
 
 /**********************
  *  VARIABLES
  **********************/
-// for button logic
-bool press      = false;    
-bool long_press = false;
-bool release    = false;
-
-// Current button state
-int mode_b_state    = 0;    
-int on_off_b_state  = 0;
-int on_off_b_long   = 0;
-int grips_b_state   = 0;
-int grips_b_long    = 0;
-int driver_b_state  = 0;
-int pass_b_state    = 0;
-int back_b_state    = 0;
+uint32_t control_wakeups = 0;   // number of times the control task was switched in
 
-int pl_0 = 0;               // input for power level backrest       @ array index 0
-int pl_1 = 0;               // input for power level passenger seat @ array index 1
-int pl_2 = 0;               // input for power level driver seat    @ array index 2
-int pl_3 = 0;               // input for power level grips          @ array index 3
-int pl_4 = 0;               // input for power level thumb throttle
-
-int max7219_brightness = 0;
-
-int16_t temperature = 0;    //var for DHT22 temp
-int16_t humidity = 0;       //var for DHT22 relative humidity
+static heater_t heater;         // control logic state, owned by the control task
+static heater_snapshot_t heater_view;   // heater.state published for other tasks after every step, lock-free
+static tw_timer_t heater_timers[HEATER_TIMER_NUM];   // windows of the control logic on the timer service, started by the control task
+_Static_assert(TELEMETRY_ZONES == HEATER_ZONE_NUM, "telemetry and heater logic disagree on the zone count");
 
 
 /**********************
- *  TASKS
+ *  JOBS
  **********************/
-static void guiTask(void *pvParameter) {    // display setup
-    (void) pvParameter;
-    xGuiSemaphore = xSemaphoreCreateMutex();
-    lv_init();
-    /* Initialize SPI or I2C bus used by the drivers */
-    lvgl_driver_init();
-    lv_color_t* buf1 = heap_caps_malloc(DISP_BUF_SIZE * sizeof(lv_color_t), MALLOC_CAP_DMA);
-    assert(buf1 != NULL);
-    static lv_color_t *buf2 = NULL;
-
-    static lv_disp_buf_t disp_buf;
-    uint32_t size_in_px = DISP_BUF_SIZE;
-#if defined CONFIG_LV_TFT_DISPLAY_CONTROLLER_IL3820         \
-    || defined CONFIG_LV_TFT_DISPLAY_CONTROLLER_JD79653A    \
-    || defined CONFIG_LV_TFT_DISPLAY_CONTROLLER_UC8151D     \
-    || defined CONFIG_LV_TFT_DISPLAY_CONTROLLER_SSD1306
-
-    /* Actual size in pixels, not bytes. */
-    size_in_px *= 8;
-#endif
-
-    /* Initialize the working buffer depending on the selected display.
-     * NOTE: buf2 == NULL when using monochrome displays. */
-    lv_disp_buf_init(&disp_buf, buf1, buf2, size_in_px);
-
-    lv_disp_drv_t disp_drv;
-    lv_disp_drv_init(&disp_drv);
-    disp_drv.flush_cb = disp_driver_flush;
-
-    /* When using a monochrome display we need to register the callbacks:
-     * - rounder_cb
-     * - set_px_cb */
-#ifdef CONFIG_LV_TFT_DISPLAY_MONOCHROME
-    disp_drv.rounder_cb = disp_driver_rounder;
-    disp_drv.set_px_cb = disp_driver_set_px;
-#endif
-
-    disp_drv.buffer = &disp_buf;
-    lv_disp_drv_register(&disp_drv);
-
-    /* Create and start a periodic timer interrupt to call lv_tick_inc */
-    const esp_timer_create_args_t periodic_timer_args = {
-        .callback = &lv_tick_task,
-        .name = "periodic_gui"
-    };
-    esp_timer_handle_t periodic_timer;
-    ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
-    ESP_ERROR_CHECK(esp_timer_start_periodic(periodic_timer, LV_TICK_PERIOD_MS * 1000));
-
-    while (1) {
-        /* Delay 1 tick (assumes FreeRTOS tick is 10ms */
-        vTaskDelay(pdMS_TO_TICKS(10));
-
-        /* Try to take the semaphore, call lvgl related function on success */
-        if (pdTRUE == xSemaphoreTake(xGuiSemaphore, portMAX_DELAY)) {
-            lv_task_handler();
-            xSemaphoreGive(xGuiSemaphore);
-       }
+static void dht22(void *ctx)  // executive job: temp and relative humidity sensor, post temp and humidity values to the control task and display
+{
+    control_event_t event = { .type = CONTROL_EVT_SENSOR };
+    esp_err_t err = dht_rmt_read(&event.sensor.humidity, &event.sensor.temperature);   // sleeps during the capture, no busy wait
+    if (err == ESP_OK){
+        control_post(&event);                                                                                   // hand the sample to the control task
+        BLOG(TAG03, "Humidity: %d%% Temp: %dC", event.sensor.humidity / 10, event.sensor.temperature / 10); // for logging
+        display_msg_t msg = {
+            .type = DISPLAY_MSG_SENSOR,
+            .sensor.temperature = event.sensor.temperature,
+            .sensor.humidity = event.sensor.humidity
+        };
+        display_post(&msg);                                                                                     // Write temp and relative humidity to display
     }
-
-    /* A task should NEVER return */
-    free(buf1);
-#ifndef CONFIG_LV_TFT_DISPLAY_MONOCHROME
-    free(buf2);
-#endif
-    vTaskDelete(NULL);
+    else
+        BLOG(TAG03, "Could not read data from sensor (%s)", (uint32_t)esp_err_to_name(err));
+    // http://www.kandrsmith.org/RJS/Misc/Hygrometers/dht_sht_how_fast.html, the period follows the on/off state, see control_task
 }
 
-static void lv_tick_task(void *arg) {   // LVGL specific
-    (void) arg;
-
-    lv_tick_inc(LV_TICK_PERIOD_MS);
+static void control_tick(void *ctx)     // executive job, keep short: just post the tick event
+{
+    control_event_t event = { .type = CONTROL_EVT_TICK };
+    xQueueSend(xControl_queue, &event, 0);
 }
 
-void dht22(void *pvParameters)  // temp and relative humidity sensor, write temp and humidity values to display
+/**********************
+ *  CONTROL CORE
+ **********************/
+static void control_apply(void *ctx, const heater_outputs_t *out)     // heater HAL: PWM outputs and LED matrix
 {
-    // dht22 spesific
-    gpio_set_pull_mode(dht_gpio, GPIO_PULLUP_ONLY);
-
-    // display spesific
-    /* Get the current screen  */
-    lv_obj_t * scr = lv_disp_get_scr_act(NULL);
-
-    // Temp setup
-    static lv_style_t style_temp;                                                   // create style
-    lv_style_init(&style_temp);                                                     // initiate style
-    lv_style_set_text_font(&style_temp, LV_STATE_DEFAULT, &lv_font_montserrat_48);  // set font type for style
-    lv_obj_t * label1_temp =  lv_label_create(scr, NULL);                           // Create label on the currently active screen*/
-    lv_obj_add_style(label1_temp,LV_OBJ_PART_MAIN, &style_temp);                    // add style to label
-    lv_obj_align(label1_temp, NULL, LV_ALIGN_IN_TOP_MID, 5, 0);                     // Set label position on screen
-
-    // Humidity setup
-    static lv_style_t style_humidity;
-    lv_style_init(&style_humidity);
-    lv_style_set_text_font(&style_humidity, LV_STATE_DEFAULT, &lv_font_montserrat_14);
-    lv_obj_t * label2_humidity =  lv_label_create(scr, NULL);
-    lv_obj_add_style(label2_humidity,LV_OBJ_PART_MAIN, &style_humidity);    
-    lv_obj_align(label2_humidity, NULL, LV_ALIGN_IN_BOTTOM_MID, -36, 0);
-
-    
-
-    while (1)
-    {
-        if (dht_read_data(sensor_type, dht_gpio, &humidity, &temperature) == ESP_OK){
-            ESP_LOGI(TAG03, "Humidity: %d%% Temp: %dC\n", humidity / 10, temperature / 10); // for logging                        
-            lv_label_set_text_fmt(label1_temp, "%dC", (temperature / 10));                    // Write temp to display          
-            lv_label_set_text_fmt(label2_humidity, "Humidity  %d%%.", humidity / 10);          // Write relative humidity to display
-        }
-        else
-            ESP_LOGI(TAG03, "Could not read data from sensor\n");                   
-        // http://www.kandrsmith.org/RJS/Misc/Hygrometers/dht_sht_how_fast.html        
-        vTaskDelay(pdMS_TO_TICKS(5000)); // If you read the sensor data too often, it will heat up
+    static const led_matrix_config_t matrix = {
+        .host = HOST,
+        .pin_mosi = PIN_NUM_MOSI,
+        .pin_clk = PIN_NUM_CLK,
+        .pin_cs = PIN_NUM_CS,
+        .cascade_size = CASCADE_SIZE
+    };
+    static bool started = false;
+
+    if(!started){                           // first call, from heater_init: bring the outputs up directly in the restored state
+        pwm_out_init(out->duty);
+        boot_mark(BOOT_OUTPUTS);
+        memcpy(symbols, out->symbols, HEATER_LED_ROWS);
+        ESP_ERROR_CHECK(led_matrix_init(&matrix));
+        led_matrix_show(symbols, out->brightness);
+        started = true;
+        return;
     }
+    latency_mark(LAT_STAGE_COMPUTE);
+    pwm_out_set(out->duty);                 // only changed channels are written
+    memcpy(symbols, out->symbols, HEATER_LED_ROWS);
+    led_matrix_show(symbols, out->brightness);  // only changed rows are queued, a deferred frame goes out with the next tick
 }
 
-void max7219(void *pvParameters)    // read and shift bits to max7219 LED driver chip
+static void control_timer_expired(void *ctx)   // timer service callback: hand the expiry to the control task
 {
-    // esp_err_t res;
-    
-    // Configure SPI bus
-    spi_bus_config_t cfg = {
-       .mosi_io_num = PIN_NUM_MOSI,
-       .miso_io_num = -1,
-       .sclk_io_num = PIN_NUM_CLK,
-       .quadwp_io_num = -1,
-       .quadhd_io_num = -1,
-       .max_transfer_sz = 0,
-       .flags = 0
-    };
-    ESP_ERROR_CHECK(spi_bus_initialize(HOST, &cfg, 1));
-
-    // Configure device
-    max7219_t dev = {
-       .cascade_size = CASCADE_SIZE,
-       .digits = 0,
-       .mirrored = false
+    control_event_t event = {
+        .type = CONTROL_EVT_TIMER,
+        .timer = (heater_timer_t)(int)ctx
     };
-    ESP_ERROR_CHECK(max7219_init_desc(&dev, HOST, PIN_NUM_CS)); //Initialize device descriptor.
-    ESP_ERROR_CHECK(max7219_init(&dev)); //initialize display
-    ESP_ERROR_CHECK(max7219_set_brightness(&dev, 0)); 
-    size_t offs = 0;
-
-    while (1)
-    { 
-        max7219_set_brightness(&dev, max7219_brightness); // max7219_brightness is set in NVS_read_write
-        vTaskDelay(pdMS_TO_TICKS(20)); 
+    control_post(&event);
+}
 
-        for(uint8_t j = 0; j < CASCADE_SIZE; j++){
-            // max7219_draw_image_8x8(&dev, i * 8, (uint8_t *)symbols + i * 8); // + offs               
-            max7219_draw_image_8x8(&dev, j * 8, (uint8_t *)symbols + j * 8); //
-            vTaskDelay(pdMS_TO_TICKS(SCROLL_DELAY)); 
-        }             
-        if (++offs == symbols_size){
-            offs = 0;
-        }
+static void control_timer(void *ctx, heater_timer_t timer, uint32_t seconds)   // heater HAL: start or cancel a window
+{
+    if(seconds == 0){
+        tmr_cancel(&heater_timers[timer]);
+    }
+    else{
+        tmr_start(&heater_timers[timer], seconds * 1000);
     }
 }
 
-void mode_auto(void *pvParameters){
-    //Auto mode:
-    // - inputs: Temp and Relative humidity.
-    // -- Temp array give input to power level
-    // -- Relative humidity > 90% set 100% power level for 30 minutes, then off or whatever temp array demands
-    int32_t temp_auto_array[6]={
-        29,   //    > 15 C
-        28,   // 10 < 15 C
-        27,   //  8 < 10 C
-        26,   //  5 <  8 C
-        25,   //  0 <  5 C
-        24   //    <  0 C
-    };
-
-    // ESP_LOGI(TAG, "Auto mode active"); 
-
-    int32_t temp[6];
-    int32_t min = 0;
-    int32_t location = 0;
-
-    while(1){ 
-        for(int i = 0; i< 6; i++){
-            if( temperature/10 < temp_auto_array[i]){   // compare measured temp with temp_auto_array  
-                temp[i] = temp_auto_array[i];
-            }           // temporary array with only values lower than measured temp.  
-            else if( temperature/10 > temp_auto_array[i]){
-                    temp[i]=99;
-            }
-        }   
-        for(int i=0; i<6; i++){
-            if (temp[i] < temp[location]){              // fin min value in temp array
-                location = i;
-            }
-        // ESP_LOGI(TAG, "Auto mode temp array values: [%d]", temp[i]); 
-        }
-    // map temps to PL_x value
-
-        if(humidity/10 >= 90){
-            pl_0 = 5;
-            pl_1 = 5;
-            pl_2 = 5;
-            pl_3 = 5;
-            pl_4 = 5;
-        }
-        else if(min == 99){
-            pl_0 = 0;
-            pl_1 = 0;
-            pl_2 = 0;
-            pl_3 = 0;
-            pl_4 = 0;
+static void control_save(void *ctx, const heater_state_t *s)   // heater HAL: stage the button states for the write-behind persistence engine
+{
+    persist_state_t state = {0};
+
+    state.value[PERSIST_SLOT_ON_OFF]      = s->on_off_b_state;
+    state.value[PERSIST_SLOT_ON_OFF_LONG] = s->on_off_b_long;
+    state.value[PERSIST_SLOT_MODE]        = s->mode_b_state;
+    for(int z = 0; z < HEATER_ZONE_NUM; z++){
+        if(persist_slot[z] >= 0){
+            state.value[persist_slot[z]] = s->level_b_state[z];
         }
-        else{
-            pl_0 = location;
-            pl_1 = location;
-            pl_2 = location;
-            pl_3 = location;
-            pl_4 = location;
+        if(persist_slot_long[z] >= 0){
+            state.value[persist_slot_long[z]] = s->level_b_long[z];
         }
-        vTaskDelay(pdMS_TO_TICKS(2000)); 
-        // ESP_LOGI(TAG, "Auto mode temp array MIN value: [%d]", temp[location]); 
-        // ESP_LOGI(TAG, "Auto mode temp array MIN array location: [%d]", location); 
     }
+    persist_update(&state);
 }
 
-void mode_manual(void *pvParameters){
-    // Manual mode:
-    // -All settings are set manual, settings are remembered between power cycles
-    // teste om grips long press er true og erstatte [3] med tommel varme mens den er trykket + 3 sekunder, deretter tilbake igjen
-    while(1){
-
-        if(long_press == false) {
-            // for(int i = 0; i<1;i++){
-            //         pl_3 = grips_b_long; // temporarely display power level for thumb throttle, this will also change PWM for grips, but only for 2 seconds, hence it is ok.
-            //         vTaskDelay(pdMS_TO_TICKS(2000)); 
-            //     }
-            pl_0 = back_b_state;
-            pl_1 = pass_b_state;
-            pl_2 = driver_b_state;
-            pl_3 = grips_b_state;
-            pl_4 = grips_b_state;   //grips_b_long;
-            vTaskDelay(pdMS_TO_TICKS(20)); 
-        }        
-
-        // else if (long_press == true){ 
-        //     pl_3 = grips_b_long; // temporarely display power level for thumb throttle, this will also change PWM for grips, but only for 2 seconds, hence it is ok.
-        //     // pl_4 = grips_b_lon
-        //     vTaskDelay(pdMS_TO_TICKS(20));                                       
-        // }
+static void control_restore(const persist_state_t *state, heater_state_t *s)    // remembered button states back into a control state
+{
+    s->on_off_b_state = state->value[PERSIST_SLOT_ON_OFF];
+    s->on_off_b_long  = state->value[PERSIST_SLOT_ON_OFF_LONG];
+    s->mode_b_state   = state->value[PERSIST_SLOT_MODE];
+    for(int z = 0; z < HEATER_ZONE_NUM; z++){
+        s->level_b_state[z] = persist_slot[z] >= 0 ? state->value[persist_slot[z]] : 0;
+        s->level_b_long[z] = persist_slot_long[z] >= 0 ? state->value[persist_slot_long[z]] : 0;
     }
 }
 
-void mode_dewpoint(void *pvParameters){
-
-    // Dewpoint mode:
-    // -input: Relative humidity
-    // -- Relative humidity > 90% set 100% power level for 30 minutes, then off
-    while(1){
-        if(humidity/10 >= 90){
-            pl_0 = 5;
-            pl_1 = 5;
-            pl_2 = 5;
-            pl_3 = 5;
-            pl_4 = 5;
-            vTaskDelay(pdMS_TO_TICKS(20)); 
+static void persist_keys_init(void)     // NVS keys of the zones from the zone table
+{
+    for(int z = 0; z < HEATER_ZONE_NUM; z++){
+        persist_slot[z] = heater_zones[z].nvs_key ? persist_key_num : -1;
+        if(heater_zones[z].nvs_key){
+            persist_keys[persist_key_num++] = heater_zones[z].nvs_key;
         }
-        else if(humidity/10 < 90){
-            pl_0 = 0;
-            pl_1 = 0;
-            pl_2 = 0;
-            pl_3 = 0;
-            pl_4 = 0;
-            vTaskDelay(pdMS_TO_TICKS(20)); 
+        persist_slot_long[z] = heater_zones[z].nvs_key_long ? persist_key_num : -1;
+        if(heater_zones[z].nvs_key_long){
+            persist_keys[persist_key_num++] = heater_zones[z].nvs_key_long;
         }
-        vTaskDelay(pdMS_TO_TICKS(2000)); 
     }
 }
 
-void NVS_read_write(void *pvParameters){ // read variables on boot-up, then write whenever changed.
-
-    // Initialize NVS
-    err = nvs_flash_init();
-    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        // NVS partition was truncated and needs to be erased
-        // Retry nvs_flash_init
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        err = nvs_flash_init();
+static void control_log(const heater_state_t *s)     // queue one telemetry sample, flash work happens in the telemetry task
+{
+    telemetry_sample_t sample = {
+        .temperature = s->temperature,
+        .humidity    = s->humidity,
+        .on          = s->on_off_b_state,
+        .mode        = s->mode_b_state
+    };
+    for(int i = 0; i < TELEMETRY_ZONES; i++){
+        sample.pl[i] = s->pl[i];
     }
-    ESP_ERROR_CHECK( err );
-
-    // Open
-    printf("\n");
-    printf("Opening Non-Volatile Storage (NVS) handle... ");
-    // nvs_handle_t my_handle;
-    err = nvs_open("storage", NVS_READWRITE, &my_handle);
-    if (err != ESP_OK) {
-        printf("Error (%s) opening NVS handle!\n", esp_err_to_name(err));
-    } else {
-        printf("Done\n");
-
-        // Read
-        printf("Reading on_off_b_state from NVS ... ");
-        // int32_t restart_counter = 0; // value will default to 0, if not set yet in NVS
-        err = nvs_get_i32(my_handle, "on_off_b_state", &on_off_b_state);
-        err = nvs_get_i32(my_handle, "mode_b_state", &mode_b_state);
-        err = nvs_get_i32(my_handle, "grips_b_state", &grips_b_state);
-        err = nvs_get_i32(my_handle, "driver_b_state", &driver_b_state);
-        err = nvs_get_i32(my_handle, "pass_b_state", &pass_b_state);
-        err = nvs_get_i32(my_handle, "back_b_state",    &back_b_state);
-        err = nvs_get_i32(my_handle, "on_off_b_long", &on_off_b_long);
-        switch (err) {
-            case ESP_OK:
-                printf("Done\n");
-                printf("on_off_b_state = %d\n", on_off_b_state);
-                break;
-            case ESP_ERR_NVS_NOT_FOUND:
-                printf("The value is not initialized yet!\n");
-                break;
-            default :
-                printf("Error (%s) reading!\n", esp_err_to_name(err));
-            }
-            nvs_close(my_handle);
-        }
-    
-    // xTaskCreate(NVS_write, "NVS_write", 4 * configMINIMAL_STACK_SIZE, NULL, 4, NULL);
-
-    int on_off_b_state_old = 0;
-    int on_off_b_state_new = 0;
-
-    int mode_b_state_old= 0; 
-    int mode_b_state_new= 0; 
-
-    int grips_b_state_old = 0;
-    int grips_b_state_new = 0;
-
-    int grips_b_long_old = 0;
-    int grips_b_long_new = 0;
-
-    int driver_b_state_old = 0;
-    int driver_b_state_new = 0;
-
-    int pass_b_state_old = 0;
-    int pass_b_state_new = 0;
-
-    int back_b_state_old = 0;
-    int back_b_state_new = 0;
+    telemetry_log(&sample);
+}
 
-    int on_off_b_long_old = 0;
-    int on_off_b_long_new = 0;
+static void control_task(void *pvParameters)   // single control state machine, sleeps until an event arrives
+{
+    control_event_t event;
+    uint32_t wakeups_last = 0;
 
     while(1){
-    
-        on_off_b_state_new  = on_off_b_state; 
-        mode_b_state_new    = mode_b_state; 
-        grips_b_state_new   = grips_b_state;
-        grips_b_long_new    = grips_b_long;
-        driver_b_state_new  = driver_b_state;
-        pass_b_state_new    = pass_b_state; 
-        back_b_state_new    = back_b_state; 
-        on_off_b_long_new   = on_off_b_long;
-
-        if(on_off_b_state_new != on_off_b_state_old){
-            on_off_b_state_old = on_off_b_state_new;
-            err = nvs_open("storage", NVS_READWRITE, &my_handle);
-            err = nvs_set_i32(my_handle, "on_off_b_state", on_off_b_state);
-            err = nvs_commit(my_handle);
-            nvs_close(my_handle);
-            printf("NVS updated with new on_off_b_state\n");
-            printf("New state is: %d\n", on_off_b_state);        
+        xQueueReceive(xControl_queue, &event, portMAX_DELAY);
+        control_wakeups++;      // every received event is one switch into this task
+        if(event.type == CONTROL_EVT_TIMER && tmr_pending(&heater_timers[event.timer])){
+            continue;           // restarted after this expiry was posted, the window goes on
         }
+        sup_begin(control_watch);
 
-        if(mode_b_state_new != mode_b_state_old){
-            mode_b_state_old = mode_b_state_new;
-            err = nvs_open("storage", NVS_READWRITE, &my_handle);
-            err = nvs_set_i32(my_handle, "mode_b_state", mode_b_state);
-            err = nvs_commit(my_handle);
-            nvs_close(my_handle);
-            printf("NVS updated with new mode_b_state\n");
-            printf("New state is: %d\n", mode_b_state);  
-
-        }
-        if(grips_b_state_new != grips_b_state_old){
-            grips_b_state_old = grips_b_state_new;
-            err = nvs_open("storage", NVS_READWRITE, &my_handle);
-            err = nvs_set_i32(my_handle, "grips_b_state", grips_b_state);
-            err = nvs_commit(my_handle);
-            nvs_close(my_handle);
-            printf("NVS updated with new grips_b_state\n");
-            printf("New state is: %d\n", grips_b_state); 
+        if(event.type == CONTROL_EVT_TICK){
+            BLOG(TAG, "Control: %u task switches in the last %d s", control_wakeups - wakeups_last, CONTROL_TICK_MS / 1000);
+            wakeups_last = control_wakeups;
+            led_matrix_flush();
+            control_log(&heater.state);     // the tick is the 1 minute telemetry sample clock
         }
-        if(driver_b_state_new != driver_b_state_old){
-            driver_b_state_old = driver_b_state_new;
-            err = nvs_open("storage", NVS_READWRITE, &my_handle);
-            err = nvs_set_i32(my_handle, "driver_b_state", driver_b_state);
-            err = nvs_commit(my_handle);
-            nvs_close(my_handle);
-            printf("NVS updated with new driver_b_state\n");
-            printf("New state is: %d\n", driver_b_state); 
+        if(event.type == CONTROL_EVT_BUTTON && event.button.gesture == BUTTON_RELEASE){
+            latency_mark(LAT_STAGE_STATE);
         }
-        if(pass_b_state_new != pass_b_state_old){
-            pass_b_state_old = pass_b_state_new;
-            err = nvs_open("storage", NVS_READWRITE, &my_handle);
-            err = nvs_set_i32(my_handle, "pass_b_state", pass_b_state);
-            err = nvs_commit(my_handle);
-            nvs_close(my_handle); 
-            printf("NVS updated with new pass_b_state\n");
-            printf("New state is: %d\n", pass_b_state); 
-        }
-        if(back_b_state_new != back_b_state_old){
-            back_b_state_old = back_b_state_new;
-            err = nvs_open("storage", NVS_READWRITE, &my_handle);
-            err = nvs_set_i32(my_handle, "back_b_state", back_b_state);
-            err = nvs_commit(my_handle);
-            nvs_close(my_handle);
-            printf("NVS updated with new back_b_state\n");
-            printf("New state is: %d\n", back_b_state); 
+        int was_on = heater.state.on_off_b_state;
+        bool was_stale = heater.state.sensor_stale;
+        heater_step(&heater, &event);       // one full control step, outputs go through control_apply
+
+        if(heater.state.sensor_stale && !was_stale){
+            ESP_LOGW(TAG, "No valid DHT22 sample for %d s, auto and dewpoint heating stopped", HEATER_SENSOR_TIMEOUT_S);
         }
-        if(on_off_b_long_new != on_off_b_long_old){
-            on_off_b_long_old = on_off_b_long_new;
-            err = nvs_open("storage", NVS_READWRITE, &my_handle);
-            err = nvs_set_i32(my_handle, "on_off_b_long", on_off_b_long);
-            err = nvs_commit(my_handle);
-            nvs_close(my_handle);
-            printf("NVS updated with new on_off_b_long\n");
-            printf("New state is: %d\n", on_off_b_long); 
+
+        if(heater.state.on_off_b_state != was_on){
+            power_set_active(heater.state.on_off_b_state);
+            sup_set_active(heater.state.on_off_b_state);
+            touch_tune_set_active(heater.state.on_off_b_state);
+            exec_set_period(dht_job, heater.state.on_off_b_state ? DHT_PERIOD_ON_MS : DHT_PERIOD_OFF_MS);
+            if(heater.state.on_off_b_state){
+                exec_trigger(dht_job, 0);   // fresh sample for the dew point logic instead of the slow off period
+            }
         }
+
+        heater_snapshot_publish(&heater_view, &heater.state);
+        sup_end(control_watch);
     }
 }
 
-void brightness(void *pvParameters){    // adjust max7219 LED array and mode LEDs brightness with on/off button long press
-
-    while(1){
-        // update duty cycle in mode states array for LED dimming;
-        int duty_new = duty_cycles_LED[on_off_b_long]; //map duty cycles for mode LED brightness 
-        vTaskDelay(pdMS_TO_TICKS(20));
-        mode_states[0][0] = duty_new; 
-        mode_states[1][1] = duty_new; 
-        mode_states[2][2] = duty_new; 
-
-        // Map brightness levels for max7219 driver        
-        max7219_brightness = max7219_LED_brightness[on_off_b_long];  
+static void control_get_state(heater_state_t *state)  // consistent copy of the control state for other tasks, never blocks the control task
+{
+    while(!heater_snapshot_read(&heater_view, state, NULL)){
+        vTaskDelay(1);      // this task preempted the control task mid-publish, let it finish
     }
-
 }
 
-void buttons_modes(void *pvParameter)   // coordinate modes and tasks based on button states, set PWM outputs for mode LEDs and power board Mosfets
+static void control_post(const control_event_t *event)    // hand an event to the control task, never blocks the caller
 {
-    ledc_timer_config_t ledc_timer = {
-        .duty_resolution = LEDC_TIMER_13_BIT, // resolution of PWM duty
-        .freq_hz = 5000,                      // frequency of PWM signal
-        .speed_mode = LEDC_LS_MODE,           // timer mode
-        .timer_num = LEDC_LS_TIMER,            // timer index
-        .clk_cfg = LEDC_AUTO_CLK,              // Auto select the source clock
-    };
-    
-    ledc_timer_config(&ledc_timer);
+    if(xQueueSend(xControl_queue, event, 0) != pdTRUE){
+        ESP_LOGW(TAG, "Control queue full, event %d dropped", event->type);
+    }
+}
 
-    ledc_channel_config_t ledc_channel[LEDC_CH_NUM] = {
-        {
-            .channel    = LEDC_LS_CH0_CHANNEL,
-            .duty       = 0,
-            .gpio_num   = LEDC_LS_CH0_GPIO,
-            .speed_mode = LEDC_LS_MODE,
-            .hpoint     = 0,
-            .timer_sel  = LEDC_LS_TIMER,
-            .flags.output_invert = 0
-        },
-        {
-            .channel    = LEDC_LS_CH1_CHANNEL,
-            .duty       = 0,
-            .gpio_num   = LEDC_LS_CH1_GPIO,
-            .speed_mode = LEDC_LS_MODE,
-            .hpoint     = 0,
-            .timer_sel  = LEDC_LS_TIMER,
-            .flags.output_invert = 0
-        },
-        {
-            .channel    = LEDC_LS_CH2_CHANNEL,
-            .duty       = 0,
-            .gpio_num   = LEDC_LS_CH2_GPIO,
-            .speed_mode = LEDC_LS_MODE,
-            .hpoint     = 0,
-            .timer_sel  = LEDC_LS_TIMER,
-            .flags.output_invert = 0
-        },
-        {
-            .channel    = LEDC_LS_CH3_CHANNEL,
-            .duty       = 0,
-            .gpio_num   = LEDC_LS_CH3_GPIO,
-            .speed_mode = LEDC_LS_MODE,
-            .hpoint     = 0,
-            .timer_sel  = LEDC_LS_TIMER,
-            .flags.output_invert = 0
-        },
-        {
-            .channel    = LEDC_LS_CH4_CHANNEL,
-            .duty       = 0,
-            .gpio_num   = LEDC_LS_CH4_GPIO,
-            .speed_mode = LEDC_LS_MODE,
-            .hpoint     = 0,
-            .timer_sel  = LEDC_LS_TIMER,
-            .flags.output_invert = 0
-        },
-        {
-            .channel    = LEDC_LS_CH5_CHANNEL,
-            .duty       = 0,
-            .gpio_num   = LEDC_LS_CH5_GPIO,
-            .speed_mode = LEDC_LS_MODE,
-            .hpoint     = 0,
-            .timer_sel  = LEDC_LS_TIMER,
-            .flags.output_invert = 0
-        },
-        {
-            .channel    = LEDC_LS_CH6_CHANNEL,
-            .duty       = 0,
-            .gpio_num   = LEDC_LS_CH6_GPIO,
-            .speed_mode = LEDC_LS_MODE,
-            .hpoint     = 0,
-            .timer_sel  = LEDC_LS_TIMER,
-            .flags.output_invert = 0
-        },
-        {
-            .channel    = LEDC_LS_CH7_CHANNEL,
-            .duty       = 0,
-            .gpio_num   = LEDC_LS_CH7_GPIO,
-            .speed_mode = LEDC_LS_MODE,
-            .hpoint     = 0,
-            .timer_sel  = LEDC_LS_TIMER,
-            .flags.output_invert = 0
-        },
+static void control_start(const heater_state_t *restored)
+{
+    static const heater_hal_t hal = {
+        .apply = control_apply,
+        .save = control_save,
+        .timer = control_timer
     };
-
-    // Set LED Controller with previously prepared configuration
-    for (int ch = 0; ch < LEDC_CH_NUM; ch++) {
-        ledc_channel_config(&ledc_channel[ch]);
+    xControl_queue = xQueueCreate(CONTROL_QUEUE_LEN, sizeof(control_event_t));     // timer expiries post to it
+    for(int i = 0; i < HEATER_TIMER_NUM; i++){
+        tw_timer_init(&heater_timers[i], control_timer_expired, (void *)i);
     }
+    heater_init(&heater, restored, &hal);    // computes the outputs from the restored state and starts the output stages
+    heater_snapshot_init(&heater_view, &heater.state);
+    power_set_active(heater.state.on_off_b_state);
+    sup_set_active(heater.state.on_off_b_state);
+    touch_tune_set_active(heater.state.on_off_b_state);
 
+    control_watch = sup_watch("control", CONTROL_TICK_MS + CONTROL_TICK_DEADLINE_MS, CONTROL_STEP_DEADLINE_MS, true);   // a late tick is no miss of its own
+    xTaskCreate(control_task, "control", 3 * 1024, NULL, 5, NULL);
 
-    xTaskCreate(max7219, "max7219", 4 * configMINIMAL_STACK_SIZE, NULL, 4, NULL);
-    xTaskCreate(&mode_auto, "mode_auto", 4* 1024, NULL, 4, &xMode_auto);
-    vTaskSuspend(xMode_auto);
-    xTaskCreate(&mode_manual, "mode_manual", 4* 1024, NULL, 4, &xMode_manual);
-    vTaskSuspend(xMode_manual);
-    xTaskCreate(&mode_dewpoint, "mode_dewpoint", 4* 1024, NULL, 4, &xMode_dewpoint);
-    vTaskSuspend(xMode_dewpoint);
-    xTaskCreate(NVS_read_write, "NVS_read_write", 4 * configMINIMAL_STACK_SIZE, NULL, 4, NULL);
-    xTaskCreate(&brightness, "brightness", 4* 1024, NULL, 4, NULL);
-
-  
-    int temp_duty_cycles[8];   // temporary array to map power levels to duty cycles for PWM outputs
- 
-    while(1){ 
-
-        // write power levels to max7219 LED levels array
-            LED_levels[0] = &pl_0;
-            LED_levels[1] = &pl_1;
-            LED_levels[2] = &pl_2;
-            LED_levels[3] = &pl_3;
-        // write power levels for the PWM outputs to duty_cycles
-            power_levels[0] = 0;    //not in use
-            power_levels[1] = 0;    //not in use
-            power_levels[2] = 0;    //not in use
-            power_levels[3] = pl_4;
-            power_levels[4] = pl_3;
-            power_levels[5] = pl_2;
-            power_levels[6] = pl_1;
-            power_levels[7] = pl_0;
-        
-        // Write button state to led matrix
-        for(uint8_t i = 0; i < 4; i++ ){ 
-            symbols[i] = led_states[*LED_levels[i]];
-        } 
-
-        // Write button states to PWM output channels for Mosfets
-        for(int i=3; i<8;i++){  
-            temp_duty_cycles[i]= duty_cycles[power_levels[i]]; 
-        } 
+    exec_add("tick", control_tick, NULL, CONTROL_TICK_MS, CONTROL_TICK_DEADLINE_MS, true);
+    boot_mark(BOOT_CONTROL);
+}
 
-        if(on_off_b_state == 0){                // OFF state           
-            vTaskSuspend(xMode_auto);
-            vTaskSuspend(xMode_manual);
-            vTaskSuspend(xMode_dewpoint);
-            
-            pl_0 = 0;
-            pl_1 = 0;
-            pl_2 = 0;
-            pl_3 = 0;
-            pl_4 = 0;
-            
-            for (int i=0; i<3;i++){
-                ledc_set_duty(ledc_channel[i].speed_mode, ledc_channel[i].channel, 0);
-                ledc_update_duty(ledc_channel[i].speed_mode, ledc_channel[i].channel);
-            }
-                // set duty cycle for PWM outputs. 0-5 = 0-100%
-            for(int i=3; i<8; i++){  
-                    ledc_set_duty(ledc_channel[i].speed_mode, ledc_channel[i].channel, temp_duty_cycles[i]);
-                    ledc_update_duty(ledc_channel[i].speed_mode, ledc_channel[i].channel);  
-            }
+static void button_post(uint32_t pad, button_gesture_t gesture)   // forward one button gesture to the control task
+{
+    control_event_t event = {
+        .type = CONTROL_EVT_BUTTON,
+        .button.pad = pad,
+        .button.gesture = gesture
+    };
 
-        }
-        else if (on_off_b_state == 1){          // ON state
+    if (gesture == BUTTON_PRESS) {
+        BLOG(TAG, "Button[%d] Press", pad);
+    }
+    else if (gesture == BUTTON_LONGPRESS) {
+        BLOG(TAG, "Button[%d] LongPress", pad);
+    }
+    else {
+        latency_begin();            // start of the touch-to-output trace
+        BLOG(TAG, "Button[%d] Release", pad);
+    }
+    control_post(&event);
+}
 
-            // mode state leds output
-            for(int i=0; i<3; i++){  
-                ledc_set_duty(ledc_channel[i].speed_mode, ledc_channel[i].channel, mode_states[mode_b_state][i]);
-                ledc_update_duty(ledc_channel[i].speed_mode, ledc_channel[i].channel);   
-            }
-                // set duty cycle for PWM outputs. 0-5 = 0-100%
-            for(int i=3; i<8; i++){  
-                    ledc_set_duty(ledc_channel[i].speed_mode, ledc_channel[i].channel, temp_duty_cycles[i]);
-                    ledc_update_duty(ledc_channel[i].speed_mode, ledc_channel[i].channel);  
-            }
-            
-            if(mode_b_state == 0){              // Auto mode
-                vTaskResume(xMode_auto);
-                vTaskSuspend(xMode_manual);
-                vTaskSuspend(xMode_dewpoint);
-            }
-            else if(mode_b_state == 1){         // Manual mode
-                vTaskSuspend(xMode_auto);
-                vTaskResume(xMode_manual);
-                vTaskSuspend(xMode_dewpoint);
-            } 
-            else if(mode_b_state == 2){         // Dewpoint mode
-                vTaskSuspend(xMode_auto);
-                vTaskSuspend(xMode_manual);
-                vTaskResume(xMode_dewpoint);
-            }           
-        }
+#if CONFIG_TOUCH_ADAPTIVE
+static void button_adaptive(int index, touch_adapt_event_t event)   // touch job callback, replaces the button task
+{
+    if (event == TOUCH_ADAPT_PRESS) {
+        button_post(channel_array[index], BUTTON_PRESS);
+    }
+    else if (event == TOUCH_ADAPT_LONGPRESS) {
+        button_post(channel_array[index], BUTTON_LONGPRESS);
     }
-}        
-            
-static void button_handler_task(void *arg)  // read the touch buttons and update button states
+    else if (event == TOUCH_ADAPT_RELEASE) {
+        button_post(channel_array[index], BUTTON_RELEASE);
+    }
+}
+#else
+static void button_handler_task(void *arg)  // read the touch buttons and forward them to the control task
 {
-
     touch_elem_message_t element_message;
     while (1) {
         touch_element_message_receive(&element_message, portMAX_DELAY); //Block take
         const touch_button_message_t *button_message = touch_button_get_message(&element_message);
-        
+
         if (button_message->event == TOUCH_BUTTON_EVT_ON_PRESS) {
-            ESP_LOGI(TAG, "Button[%d] Press", (uint32_t)element_message.arg); 
-            press = true;
-            long_press = false;          
+            button_post((uint32_t)element_message.arg, BUTTON_PRESS);
         }
         else if (button_message->event == TOUCH_BUTTON_EVT_ON_LONGPRESS) {
-            ESP_LOGI(TAG, "Button[%d] LongPress", (uint32_t)element_message.arg);
-            press = false;
-            long_press = true; 
+            button_post((uint32_t)element_message.arg, BUTTON_LONGPRESS);
         }       
         else if (button_message->event == TOUCH_BUTTON_EVT_ON_RELEASE) {
-            ESP_LOGI(TAG, "Button[%d] Release", (uint32_t)element_message.arg);
-
-            if((uint32_t)element_message.arg == 4){
-                ESP_LOGI(TAG, "button_backrest is pressed"); 
-                if(back_b_state >= button_backrest){       // increment states for each button press
-                    back_b_state = 0;
-                    }
-                else if (back_b_state < 6){
-                    back_b_state++;                    
-                    }                          
-            ESP_LOGI(TAG, "button_backrest mode[%d]", (int)back_b_state);
-            }
-            else if((uint32_t)element_message.arg == 5){
-                ESP_LOGI(TAG, "button_Passenger_seat is pressed"); 
-                if(pass_b_state >= button_Passenger_seat){
-                    pass_b_state = 0;
-                    }
-                else if (pass_b_state < 6){
-                    pass_b_state++;                    
-                    }
-            ESP_LOGI(TAG, "button_Passenger_seat mode[%d]", (int)pass_b_state); 
-            }
-
-            else if((uint32_t)element_message.arg == 6){
-                ESP_LOGI(TAG, "button_driver_seat is pressed"); 
-                if(driver_b_state >= button_driver_seat){
-                    driver_b_state = 0;
-                    }
-                else if (driver_b_state < 6){
-                    driver_b_state++;                    
-                    }
-            ESP_LOGI(TAG, "button_driver_seat mode[%d]", (int)driver_b_state); 
-            }
-
-            else if((uint32_t)element_message.arg == 7){
-            //     ESP_LOGI(TAG, "button_on_off is pressed"); 
-            //     if(on_off_b_state >= button_on_off){
-            //         on_off_b_state = 0;
-            //         }
-            //     else if (on_off_b_state < 2){
-            //         on_off_b_state++;                    
-            //         }
-            // ESP_LOGI(TAG, "button_on_off mode[%d]", (int)on_off_b_state); 
-
-                if(press == true && long_press == false){
-                    ESP_LOGI(TAG, "button_on_off is pressed");                
-                    if(on_off_b_state >= button_on_off){
-                        on_off_b_state = 0;
-                    }
-                    else if (on_off_b_state < 6){
-                        on_off_b_state++;                    
-                    }
-                    // nvs_set_i16(my_handle, "back_b_state", back_b_state);
-                    ESP_LOGI(TAG, "button_on_off mode[%d]", (int)grips_b_state); 
-                }
-                else if(press == false && long_press == true){
-                    ESP_LOGI(TAG, "button_on_off long pressed for LED duty dim control");                
-                    if(on_off_b_long >= button_on_off_duty_cycle){
-                        on_off_b_long = 1;      // start @ 1 to not dim LEDs to 0
-                    }
-                    else if (on_off_b_long < 6){
-                        on_off_b_long ++;                    
-                    }
-                    ESP_LOGI(TAG, "LED duty dim control[%d]", (int)on_off_b_long); 
-                }
-            }
-
-            else if ((uint32_t)element_message.arg == 10){
-                ESP_LOGI(TAG, "Mode button is pressed");                  
-                if(mode_b_state>= button_mode_button){
-                    mode_b_state= 0;
-                    }
-                else if (mode_b_state< 3){
-                    mode_b_state++;                    
-                    }
-                    ESP_LOGI(TAG, "mode_button mode[%d]", (int)mode_b_state);                    
-            }
-            else if((uint32_t)element_message.arg == 11){
-                if(press == true && long_press == false){
-                    ESP_LOGI(TAG, "button_grips is pressed");                
-                    if(grips_b_state >= button_grips){
-                        grips_b_state = 0;
-                    }
-                    else if (grips_b_state < 6){
-                        grips_b_state++;                    
-                    }
-                    // nvs_set_i16(my_handle, "back_b_state", back_b_state);
-                    ESP_LOGI(TAG, "button_grips mode[%d]", (int)grips_b_state); 
-                }
-                else if(press == false && long_press == true){
-                    ESP_LOGI(TAG, "button_grips_thumb is pressed");                
-                    if(grips_b_long >= button_grips_thumb){
-                        grips_b_long = 0;
-                    }
-                    else if (grips_b_long < 6){
-                        grips_b_long++;                    
-                    }
-                    ESP_LOGI(TAG, "button_grips Thumb longpress[%d]", (int)grips_b_long); 
-                }
-            }
-        long_press = false; 
+            button_post((uint32_t)element_message.arg, BUTTON_RELEASE);
         }
     }
 }
+#endif
 
 
 void app_main(void)
 {
-    xTaskCreatePinnedToCore(guiTask, "gui", 4096*2, NULL, 4, NULL, 1);
-    // lv_task_create(label_refresher_task, 100, LV_TASK_PRIO_MID, NULL);
+    // Boot order: state first, then the outputs in their final state, then input, diagnostics and the display last
+    persist_state_t state = {0};
+    heater_state_t restored = {0};
+    boot_mark(BOOT_APP_MAIN);
+    ESP_ERROR_CHECK(power_init());             // DFS and light sleep, before any module takes a power lock
+    ESP_ERROR_CHECK(exec_init());              // background jobs, before any module adds one
+    ESP_ERROR_CHECK(sup_init());               // deadline and heartbeat monitor of the jobs and the control task
+    ESP_ERROR_CHECK(tmr_init());               // timed windows of the control logic, before control_start
+    ESP_ERROR_CHECK(blog_init());              // deferred log output, hot paths log with BLOG()
+    persist_keys_init();
+    ESP_ERROR_CHECK(persist_init(persist_keys, persist_key_num, &state));     // restore remembered button states before any output starts
+    boot_mark(BOOT_RESTORED);
+    control_restore(&state, &restored);
+    control_start(&restored);
 
 
     /*< Initialize Touch Element library */
@@ -1025,32 +480,49 @@ void app_main(void)
     touch_button_global_config_t button_global_config = TOUCH_BUTTON_GLOBAL_DEFAULT_CONFIG();
     ESP_ERROR_CHECK(touch_button_install(&button_global_config));
     ESP_LOGI(TAG, "Touch button install");
-    for (int i = 0; i < TOUCH_BUTTON_NUM; i++) {
+    for (int z = 0; z < HEATER_ZONE_NUM; z++) {
+        if (heater_zones[z].pad != HEATER_PAD_NONE) {
+            channel_array[touch_button_num++] = heater_zones[z].pad;
+        }
+    }
+    for (int i = 0; i < touch_button_num; i++) {
         touch_button_config_t button_config = {
             .channel_num = channel_array[i],
-            .channel_sens = channel_sens_array[i]
+            .channel_sens = TOUCH_BUTTON_SENS
         };
         /* Create touch button */
         ESP_ERROR_CHECK(touch_button_create(&button_config, &button_handle[i]));
+#if !CONFIG_TOUCH_ADAPTIVE
         /* Subscribe touch button event(Press, Release, LongPress) */
         ESP_ERROR_CHECK(touch_button_subscribe_event(button_handle[i], TOUCH_ELEM_EVENT_ON_PRESS | TOUCH_ELEM_EVENT_ON_RELEASE | TOUCH_ELEM_EVENT_ON_LONGPRESS,
                                                      (void *)channel_array[i]));
         /* Button set dispatch method */
         ESP_ERROR_CHECK(touch_button_set_dispatch_method(button_handle[i], TOUCH_ELEM_DISP_EVENT));
+#endif
 #ifdef CONFIG_TOUCH_WATERPROOF_GUARD_ENABLE
         /* Add button element into waterproof guard sensor's protection */
         ESP_ERROR_CHECK(touch_element_waterproof_add(button_handle[i]));
 #endif
     }   
     ESP_LOGI(TAG, "Touch buttons create");
+#if CONFIG_TOUCH_ADAPTIVE
+    touch_element_start();
+    ESP_ERROR_CHECK(touch_tune_init(channel_array, touch_button_num, button_adaptive));   // the touch job detects the gestures
+#else
     /*< Create a monitor task to take Touch Button event */
-    xTaskCreate(button_handler_task, "button_handler_task", 4 * 2048, NULL, 5, NULL);
+    xTaskCreate(button_handler_task, "button_handler_task", 3 * 1024, NULL, 5, NULL);
     touch_element_start();
-    xTaskCreate(dht22, "dht22", 4 * 2048, NULL, 4, NULL); // configMINIMAL_STACK_SIZE
-    xTaskCreate(buttons_modes, "buttons_modes", 4 * 2048, NULL, 4, NULL);
-
-    
-    
-    // xTaskCreate(&lv_example_label_1, "lv_example_label_1", 4 * 2048, NULL, 3, NULL);
-    
+    ESP_ERROR_CHECK(touch_tune_init(channel_array, touch_button_num, NULL));              // recorder only
+#endif
+    ESP_ERROR_CHECK(power_wake_on_touch());    // a touch ends light sleep while the system is off
+    boot_mark(BOOT_TOUCH);
+    ESP_ERROR_CHECK(console_start(control_get_state));      // diagnostics commands, type 'help' on the console
+    boot_mark(BOOT_CONSOLE);
+    ESP_ERROR_CHECK_WITHOUT_ABORT(telemetry_init());     // flash scan, runs without the log if it fails
+    boot_mark(BOOT_TELEMETRY);
+    display_start();                           // LVGL and OLED setup off the critical path, the GUI task marks BOOT_DISPLAY
+    ESP_ERROR_CHECK(dht_rmt_init(dht_gpio, dht_rmt_channel));    // posts to the display queue, so after display_start
+    dht_job = exec_add("dht22", dht22, NULL, restored.on_off_b_state ? DHT_PERIOD_ON_MS : DHT_PERIOD_OFF_MS, DHT_DEADLINE_MS, true);
+    exec_trigger(dht_job, 0);                  // first sample right away
+    boot_log();
 }
\ No newline at end of file
@@ -0,0 +1,126 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <string.h>
+#include "oled_fb.h"
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static const oled_glyph_t *glyph_of(const oled_font_t *font, char c)
+{
+    if (font->map != NULL) {        // subset font, a handful of glyphs
+        const char *p = c != '\0' ? strchr(font->map, c) : NULL;
+        return p != NULL ? &font->glyphs[p - font->map] : NULL;
+    }
+    unsigned i = (unsigned char)c - font->first;
+    return i < font->count ? &font->glyphs[i] : NULL;
+}
+
+static uint8_t bits_at(uint64_t bits, int shift)    // 8 rows of a column, starting at row shift (may be negative)
+{
+    if (shift >= 64 || shift <= -8) {
+        return 0;
+    }
+    return (uint8_t)(shift >= 0 ? bits >> shift : bits << -shift);
+}
+
+static void mark_dirty(oled_dirty_t *d, int x)
+{
+    if (d->x0 > d->x1) {
+        d->x0 = d->x1 = x;
+    }
+    else if (x < d->x0) {
+        d->x0 = x;
+    }
+    else if (x > d->x1) {
+        d->x1 = x;
+    }
+}
+
+void oled_fb_init(oled_fb_t *fb)
+{
+    memset(fb->page, 0, sizeof(fb->page));
+    for (int p = 0; p < OLED_PAGES; p++) {
+        fb->dirty[p].x0 = 0;
+        fb->dirty[p].x1 = OLED_WIDTH - 1;
+    }
+}
+
+int oled_fb_text_width(const oled_font_t *font, const char *text)
+{
+    int w = 0;
+
+    for (; *text; text++) {
+        const oled_glyph_t *g = glyph_of(font, *text);
+        w += g ? g->adv : 0;
+    }
+    return w;
+}
+
+int oled_fb_text(oled_fb_t *fb, int x, int y, int w, int h, const oled_font_t *font, oled_align_t align, const char *text)
+{
+    uint64_t cols[OLED_WIDTH] = {0};    // new content of the box columns, bit 0 = box top row
+    int changed = 0;
+
+    if (x < 0 || y < 0 || w <= 0 || h <= 0 || x + w > OLED_WIDTH || y + h > OLED_HEIGHT) {
+        return 0;
+    }
+    int pen = x;
+    if (align != OLED_ALIGN_LEFT) {
+        int slack = w - oled_fb_text_width(font, text);
+        pen += align == OLED_ALIGN_CENTER ? slack / 2 : slack;
+    }
+
+    // glyph columns into the box, clipped to it
+    for (; *text; text++) {
+        const oled_glyph_t *g = glyph_of(font, *text);
+        if (g == NULL) {
+            continue;
+        }
+        int bytes = (g->h + 7) / 8;
+        for (int c = 0; c < g->w; c++) {
+            int cx = pen + g->x + c;
+            if (cx < x || cx >= x + w) {
+                continue;
+            }
+            uint64_t bits = 0;
+            for (int b = 0; b < bytes; b++) {
+                bits |= (uint64_t)font->bitmap[g->offset + c * bytes + b] << (8 * b);
+            }
+            cols[cx] |= g->y >= 0 ? (g->y < 64 ? bits << g->y : 0) : bits >> -g->y;
+        }
+        pen += g->adv;
+    }
+
+    // write every byte of the box once, only real changes mark the page dirty
+    uint64_t box_mask = h >= 64 ? ~0ull : (1ull << h) - 1;
+    for (int p = y / 8; p <= (y + h - 1) / 8; p++) {
+        int shift = p * 8 - y;          // box row of the page's top row
+        uint8_t mask = bits_at(box_mask, shift);
+        for (int cx = x; cx < x + w; cx++) {
+            uint8_t old = fb->page[p][cx];
+            uint8_t byte = (old & ~mask) | (bits_at(cols[cx] & box_mask, shift) & mask);
+            if (byte != old) {
+                fb->page[p][cx] = byte;
+                mark_dirty(&fb->dirty[p], cx);
+                changed++;
+            }
+        }
+    }
+    return changed;
+}
+
+bool oled_fb_take_dirty(oled_fb_t *fb, int p, int *x0, int *x1)
+{
+    oled_dirty_t *d = &fb->dirty[p];
+
+    if (d->x0 > d->x1) {
+        return false;
+    }
+    *x0 = d->x0;
+    *x1 = d->x1;
+    d->x0 = 1;
+    d->x1 = 0;
+    return true;
+}
@@ -0,0 +1,71 @@
+/*
+OLED framebuffer:
+-1 KB monochrome framebuffer of the 128x64 SSD1306 in its native layout: 8 pages of 128 column bytes, bit 0 is the top row.
+-Text is drawn into boxes from pre-rasterized 1 bpp glyphs, generated at build time from the LVGL fonts with only the
+ characters the display shows, see fonts/font_subset.py.
+-A box is rewritten column by column, every byte is written once and only bytes that differ mark their page dirty,
+ with the changed column range. The flush then sends only those page windows.
+-Plain C without ESP-IDF dependencies, also built natively for host/bench_oled.c.
+*/
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define OLED_WIDTH              (128)
+#define OLED_HEIGHT             (64)
+#define OLED_PAGES              (OLED_HEIGHT / 8)
+
+typedef struct {
+    uint16_t offset;            // first column byte in the font bitmap
+    uint8_t adv;                // advance width, pixels
+    uint8_t w;                  // bitmap columns
+    uint8_t h;                  // bitmap rows, ceil(h / 8) bytes per column
+    int8_t x;                   // left bearing
+    int8_t y;                   // bitmap top below the line top
+} oled_glyph_t;
+
+typedef struct {
+    const uint8_t *bitmap;      // per glyph: w columns of ceil(h / 8) bytes, bit 0 on top
+    const oled_glyph_t *glyphs;
+    uint16_t first;             // character of glyphs[0]
+    uint16_t count;
+    uint8_t line_h;             // line height, pixels
+    const char *map;            // characters of glyphs[] in order, NULL: first, first + 1, ... (count of them)
+} oled_font_t;
+
+typedef enum {
+    OLED_ALIGN_LEFT,
+    OLED_ALIGN_CENTER,
+    OLED_ALIGN_RIGHT
+} oled_align_t;
+
+typedef struct {
+    uint8_t x0, x1;             // changed columns, inclusive, x0 > x1 when clean
+} oled_dirty_t;
+
+typedef struct {
+    uint8_t page[OLED_PAGES][OLED_WIDTH];
+    oled_dirty_t dirty[OLED_PAGES];
+} oled_fb_t;
+
+/**
+ * Clear the framebuffer and mark every page dirty, the first flush sends a full frame.
+ */
+void oled_fb_init(oled_fb_t *fb);
+
+/**
+ * Width of text in pixels. Characters without a glyph are skipped.
+ */
+int oled_fb_text_width(const oled_font_t *font, const char *text);
+
+/**
+ * Replace the content of the box at x, y (w x h pixels) with text on its top line, aligned horizontally.
+ * Returns the number of bytes that changed.
+ */
+int oled_fb_text(oled_fb_t *fb, int x, int y, int w, int h, const oled_font_t *font, oled_align_t align, const char *text);
+
+/**
+ * True when page p has changed columns, their range goes to *x0, *x1. Clears the page's dirty range.
+ */
+bool oled_fb_take_dirty(oled_fb_t *fb, int p, int *x0, int *x1);
@@ -0,0 +1,291 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stddef.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "executive.h"
+#include "blog.h"
+#include "persist.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define PERSIST_NAMESPACE   "storage"
+#define PERSIST_KEY         "state"
+#define PERSIST_VERSION     (2)         // bump when persist_blob_t changes layout
+#define PERSIST_V1_SIZE     (8)         // values in a version 1 blob, see legacy_key_names
+
+/**********************
+ *  TYPES
+ **********************/
+typedef struct __attribute__((packed)) {
+    uint32_t key;               // CRC32 of the key name
+    uint8_t value;
+} persist_entry_t;
+
+typedef struct __attribute__((packed)) {   // on-flash layout, only count entries are stored, crc covers everything but itself
+    uint8_t version;
+    uint8_t count;
+    uint32_t crc;
+    persist_entry_t entries[PERSIST_VALUES_MAX];
+} persist_blob_t;
+
+typedef struct __attribute__((packed)) {   // version 1 on-flash layout: fixed fields in legacy_key_names order
+    uint8_t version;
+    uint8_t size;
+    uint8_t values[PERSIST_V1_SIZE];
+    uint32_t crc;
+} persist_blob_v1_t;
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const char *TAG = "Persist: ";
+
+static nvs_handle_t nvs;
+static exec_job_t persist_job = -1;
+static portMUX_TYPE persist_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const *keys;     // key names of the values, from persist_init()
+static int n_keys;
+static uint32_t key_hash[PERSIST_VALUES_MAX];
+static persist_state_t pending;     // last staged state, protected by persist_lock
+static persist_state_t committed;   // state currently stored in flash
+static bool dirty = false;          // pending is not in flash yet, protected by persist_lock
+static int64_t dirty_since;         // us, first update since the last commit, protected by persist_lock
+static bool legacy_keys = false;    // old one-key-per-state entries still present in NVS
+static persist_stats_t stats;
+
+// legacy keys, in version 1 blob field order
+static const char *legacy_key_names[PERSIST_V1_SIZE] = {
+    "on_off_b_state",
+    "on_off_b_long",
+    "mode_b_state",
+    "grips_b_state",
+    "grips_b_long",
+    "driver_b_state",
+    "pass_b_state",
+    "back_b_state"
+};
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static uint32_t persist_hash(const char *key)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)key, strlen(key));
+}
+
+static uint32_t persist_crc(const persist_blob_t *blob)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)blob, offsetof(persist_blob_t, crc));
+    return esp_rom_crc32_le(crc, (const uint8_t *)blob->entries, blob->count * sizeof(persist_entry_t));
+}
+
+static size_t persist_blob_len(const persist_blob_t *blob)
+{
+    return offsetof(persist_blob_t, entries) + blob->count * sizeof(persist_entry_t);
+}
+
+static void persist_set(persist_state_t *state, uint32_t hash, uint8_t value)   // values of unknown keys are dropped
+{
+    for (int i = 0; i < n_keys; i++) {
+        if (key_hash[i] == hash) {
+            state->value[i] = value;
+            return;
+        }
+    }
+}
+
+static bool persist_load_v1(const uint8_t *buf, size_t len, persist_state_t *state)
+{
+    const persist_blob_v1_t *blob = (const persist_blob_v1_t *)buf;
+
+    if (len != sizeof(*blob) || blob->size != PERSIST_V1_SIZE ||
+        blob->crc != esp_rom_crc32_le(0, buf, offsetof(persist_blob_v1_t, crc))) {
+        return false;
+    }
+    for (int i = 0; i < PERSIST_V1_SIZE; i++) {
+        persist_set(state, persist_hash(legacy_key_names[i]), blob->values[i]);
+    }
+    legacy_keys = true;             // rewrite in the current layout
+    ESP_LOGI(TAG, "Migrated version 1 state blob");
+    return true;
+}
+
+static bool persist_load_blob(persist_state_t *state)
+{
+    persist_blob_t blob;
+    size_t len = sizeof(blob);
+
+    esp_err_t err = nvs_get_blob(nvs, PERSIST_KEY, &blob, &len);
+    if (err != ESP_OK) {
+        if (err != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(TAG, "Error (%s) reading state blob", esp_err_to_name(err));
+        }
+        return false;
+    }
+    if (len >= 1 && blob.version == 1) {
+        return persist_load_v1((const uint8_t *)&blob, len, state);
+    }
+    if (len < offsetof(persist_blob_t, entries) || blob.version != PERSIST_VERSION || blob.count > PERSIST_VALUES_MAX ||
+        len != persist_blob_len(&blob)) {
+        ESP_LOGW(TAG, "State blob has unknown layout (len %u, version %u), ignored", (unsigned)len, blob.version);
+        return false;
+    }
+    if (blob.crc != persist_crc(&blob)) {
+        ESP_LOGW(TAG, "State blob CRC mismatch, ignored");
+        return false;
+    }
+    for (int i = 0; i < blob.count; i++) {
+        persist_set(state, blob.entries[i].key, blob.entries[i].value);
+    }
+    return true;
+}
+
+static void persist_load_legacy(persist_state_t *state)
+{
+    for (int i = 0; i < n_keys; i++) {
+        int32_t value;
+        if (nvs_get_i32(nvs, keys[i], &value) == ESP_OK) {
+            state->value[i] = (uint8_t)value;
+            legacy_keys = true;
+        }
+    }
+    if (legacy_keys) {
+        ESP_LOGI(TAG, "Migrated legacy per-key state");
+    }
+}
+
+static void persist_retry(void)     // a failed commit leaves the state dirty, the next update or the max delay writes it again
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&persist_lock);
+    bool retry = !dirty;            // else an update came in meanwhile and its trigger is pending
+    if (retry) {
+        dirty = true;
+        dirty_since = now;
+    }
+    portEXIT_CRITICAL(&persist_lock);
+
+    if (retry) {
+        exec_trigger(persist_job, PERSIST_MAX_DELAY_MS);
+    }
+}
+
+static void persist_commit(void *ctx)     // executive job, runs once input has been idle
+{
+    persist_blob_t blob = {
+        .version = PERSIST_VERSION,
+        .count = n_keys,
+    };
+    persist_state_t state;
+
+    portENTER_CRITICAL(&persist_lock);
+    state = pending;
+    dirty = false;
+    portEXIT_CRITICAL(&persist_lock);
+
+    if (!legacy_keys && memcmp(&state, &committed, sizeof(committed)) == 0) {
+        stats.skipped++;
+        return;
+    }
+    for (int i = 0; i < n_keys; i++) {
+        blob.entries[i].key = key_hash[i];
+        blob.entries[i].value = state.value[i];
+    }
+    blob.crc = persist_crc(&blob);
+    size_t len = persist_blob_len(&blob);
+
+    esp_err_t err = nvs_set_blob(nvs, PERSIST_KEY, &blob, len);
+    if (err == ESP_OK && legacy_keys) {
+        for (int i = 0; i < n_keys; i++) {
+            nvs_erase_key(nvs, keys[i]);
+        }
+        legacy_keys = false;
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    if (err != ESP_OK) {
+        stats.errors++;
+        ESP_LOGE(TAG, "Error (%s) writing state blob", esp_err_to_name(err));
+        persist_retry();
+        return;
+    }
+    committed = state;
+    stats.commits++;
+    stats.bytes_written += len;
+    BLOG(TAG, "State committed (%u commits for %u updates, %u bytes written)",
+             stats.commits, stats.updates, stats.bytes_written);
+}
+
+esp_err_t persist_init(const char *const *key_names, int n, persist_state_t *state)
+{
+    if (n > PERSIST_VALUES_MAX) {
+        ESP_LOGE(TAG, "%d values, at most %d", n, PERSIST_VALUES_MAX);
+        return ESP_ERR_INVALID_ARG;
+    }
+    keys = key_names;
+    n_keys = n;
+    for (int i = 0; i < n; i++) {
+        key_hash[i] = persist_hash(keys[i]);
+    }
+
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        // NVS partition was truncated and needs to be erased
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(err);
+
+    err = nvs_open(PERSIST_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%s) opening NVS handle", esp_err_to_name(err));
+        return err;
+    }
+
+    if (!persist_load_blob(state)) {
+        persist_load_legacy(state);
+    }
+    committed = *state;
+    pending = *state;
+
+    persist_job = exec_add("persist", persist_commit, NULL, 0, PERSIST_DEADLINE_MS, true);
+    if (legacy_keys) {
+        exec_trigger(persist_job, 0);   // rewrite the migrated state as a blob
+    }
+    return ESP_OK;
+}
+
+void persist_update(const persist_state_t *state)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&persist_lock);
+    pending = *state;
+    stats.updates++;
+    if (!dirty) {
+        dirty = true;
+        dirty_since = now;
+    }
+    // every update restarts the idle window, bounded by PERSIST_MAX_DELAY_MS from the first one
+    int64_t left_ms = PERSIST_MAX_DELAY_MS - (now - dirty_since) / 1000;
+    portEXIT_CRITICAL(&persist_lock);
+
+    exec_trigger(persist_job, left_ms < PERSIST_IDLE_MS ? (left_ms > 0 ? (uint32_t)left_ms : 0) : PERSIST_IDLE_MS);
+}
+
+void persist_get_stats(persist_stats_t *out)
+{
+    portENTER_CRITICAL(&persist_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&persist_lock);
+}
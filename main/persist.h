@@ -0,0 +1,45 @@
+/*
+Persistence engine:
+-All remembered button states are packed into one versioned, CRC protected blob stored under a single NVS key.
+-Each value is stored with a hash of its key name, so values of added or removed zones do not disturb the others.
+-Changes are staged in RAM, the commit runs as an executive job once the input has gone idle.
+-A burst of button taps therefore results in one flash commit, and a commit is skipped when the staged state equals the stored one.
+*/
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define PERSIST_IDLE_MS         (3000)      // commit when no change has been staged for this long
+#define PERSIST_MAX_DELAY_MS    (15000)     // upper bound for how long a change may stay unwritten
+#define PERSIST_DEADLINE_MS     (500)       // executive deadline of a commit, NVS page erases included
+#define PERSIST_VALUES_MAX      (16)
+
+typedef struct {
+    uint8_t value[PERSIST_VALUES_MAX];      // in the order of the keys given to persist_init()
+} persist_state_t;
+
+typedef struct {
+    uint32_t updates;           // number of persist_update() calls
+    uint32_t commits;           // number of nvs_commit() calls
+    uint32_t skipped;           // flushes where the state was unchanged
+    uint32_t bytes_written;     // blob bytes handed to NVS
+    uint32_t errors;            // failed NVS writes
+} persist_stats_t;
+
+/**
+ * Initialize NVS, read the stored values of n keys (at most PERSIST_VALUES_MAX, NVS key names) into *state and add the commit
+ * job. Call after exec_init(), keys must stay valid. Older layouts are migrated: the version 1 blob and one NVS key per value.
+ * *state is left untouched for values that were never stored.
+ */
+esp_err_t persist_init(const char *const *keys, int n, persist_state_t *state);
+
+/**
+ * Stage a new state and (re)schedule the commit. Cheap, never touches flash.
+ */
+void persist_update(const persist_state_t *state);
+
+/**
+ * Copy the commit/wear counters.
+ */
+void persist_get_stats(persist_stats_t *stats);
@@ -0,0 +1,145 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "power.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define POWER_FREQ_MIN_MHZ      (40)    // XTAL clock, APB follows it while no lock is held
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const char *TAG = "Power: ";
+
+static const struct {
+    esp_pm_lock_type_t type;
+    const char *name;
+} lock_types[POWER_LOCK_NUM] = {
+    [POWER_LOCK_WORK]    = { ESP_PM_CPU_FREQ_MAX,   "work" },
+    [POWER_LOCK_OUTPUTS] = { ESP_PM_APB_FREQ_MAX,   "outputs" },
+    [POWER_LOCK_IO]      = { ESP_PM_APB_FREQ_MAX,   "io" },
+};
+
+static esp_pm_lock_handle_t locks[POWER_LOCK_NUM];     // NULL without CONFIG_PM_ENABLE, counters still run
+static portMUX_TYPE power_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int depth[POWER_LOCK_NUM];                // nesting, protected by power_lock
+static int64_t held_since[POWER_LOCK_NUM];      // us, valid while depth > 0
+static int64_t active_since;                    // us, start of the current on or off phase
+static power_stats_t stats;
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+esp_err_t power_init(void)
+{
+    active_since = esp_timer_get_time();
+
+    esp_pm_config_esp32s2_t config = {
+        .max_freq_mhz = CONFIG_ESP32S2_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = POWER_FREQ_MIN_MHZ,
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE && CONFIG_POWER_LIGHT_SLEEP
+        .light_sleep_enable = true
+#endif
+    };
+    esp_err_t err = esp_pm_configure(&config);
+    if (err == ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGW(TAG, "power management disabled in menuconfig, running at a fixed clock");
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%s) configuring power management", esp_err_to_name(err));
+        return err;
+    }
+
+    for (int i = 0; i < POWER_LOCK_NUM; i++) {
+        err = esp_pm_lock_create(lock_types[i].type, 0, lock_types[i].name, &locks[i]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Error (%s) creating lock %s", esp_err_to_name(err), lock_types[i].name);
+            return err;
+        }
+    }
+    ESP_LOGI(TAG, "DFS %d-%d MHz, light sleep %s", POWER_FREQ_MIN_MHZ, CONFIG_ESP32S2_DEFAULT_CPU_FREQ_MHZ,
+             config.light_sleep_enable ? "on" : "off");
+    return ESP_OK;
+}
+
+esp_err_t power_wake_on_touch(void)
+{
+    esp_err_t err = esp_sleep_enable_touchpad_wakeup();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%s) enabling touch wakeup", esp_err_to_name(err));
+    }
+    return err;
+}
+
+void power_acquire(power_lock_t lock)
+{
+    portENTER_CRITICAL(&power_lock);
+    if (depth[lock]++ == 0) {
+        held_since[lock] = esp_timer_get_time();
+        stats.lock[lock].acquired++;
+    }
+    portEXIT_CRITICAL(&power_lock);
+
+    if (locks[lock] != NULL) {
+        esp_pm_lock_acquire(locks[lock]);
+    }
+}
+
+void power_release(power_lock_t lock)
+{
+    if (locks[lock] != NULL) {
+        esp_pm_lock_release(locks[lock]);
+    }
+
+    portENTER_CRITICAL(&power_lock);
+    if (depth[lock] > 0 && --depth[lock] == 0) {
+        stats.lock[lock].held_us += esp_timer_get_time() - held_since[lock];
+    }
+    portEXIT_CRITICAL(&power_lock);
+}
+
+void power_set_active(bool active)
+{
+    portENTER_CRITICAL(&power_lock);
+    if (active != stats.active) {
+        int64_t now = esp_timer_get_time();
+        if (stats.active) {
+            stats.on_us += now - active_since;
+        }
+        else {
+            stats.off_us += now - active_since;
+        }
+        active_since = now;
+        stats.active = active;
+    }
+    portEXIT_CRITICAL(&power_lock);
+}
+
+void power_get_stats(power_stats_t *out)
+{
+    portENTER_CRITICAL(&power_lock);
+    int64_t now = esp_timer_get_time();
+    *out = stats;
+    for (int i = 0; i < POWER_LOCK_NUM; i++) {
+        if (depth[i] > 0) {
+            out->lock[i].held_us += now - held_since[i];
+        }
+    }
+    if (stats.active) {
+        out->on_us += now - active_since;
+    }
+    else {
+        out->off_us += now - active_since;
+    }
+    portEXIT_CRITICAL(&power_lock);
+}
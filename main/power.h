@@ -0,0 +1,58 @@
+/*
+Power management:
+-Dynamic frequency scaling between the XTAL clock and the default CPU clock, automatic light sleep when no lock is held (Kconfig).
+-Real work takes a lock for its duration: full CPU clock for rendering, a stable 80 MHz APB clock while PWM
+ outputs run and during sensor captures. With the system off and the outputs at 0 the chip sleeps between events.
+-Touch pads wake the chip from light sleep, the touch element library then reports the press as usual.
+-Counts acquisitions and held time per lock and the time spent on and off, esp_pm_dump_locks() adds the time per clock mode and in sleep.
+*/
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum {
+    POWER_LOCK_WORK,        // CPU at full clock: rendering
+    POWER_LOCK_OUTPUTS,     // APB at 80 MHz, no light sleep: LEDC runs from the APB clock while any output is not 0
+    POWER_LOCK_IO,          // APB at 80 MHz, no light sleep: RMT timed sensor reads
+    POWER_LOCK_NUM
+} power_lock_t;
+
+typedef struct {
+    uint32_t acquired;      // 0 -> held transitions
+    uint64_t held_us;       // time held, nested holds count once
+} power_lock_stats_t;
+
+typedef struct {
+    power_lock_stats_t lock[POWER_LOCK_NUM];
+    uint64_t on_us;         // time with the system switched on
+    uint64_t off_us;        // time with the system switched off
+    bool active;
+} power_stats_t;
+
+/**
+ * Configure DFS and light sleep and create the locks. Call before any other module takes a lock.
+ */
+esp_err_t power_init(void);
+
+/**
+ * Wake from light sleep on a touch pad, call after the touch element library is started.
+ */
+esp_err_t power_wake_on_touch(void);
+
+/**
+ * Take or give back a lock, nesting is allowed.
+ */
+void power_acquire(power_lock_t lock);
+void power_release(power_lock_t lock);
+
+/**
+ * Record the on/off state of the system for the time counters.
+ */
+void power_set_active(bool active);
+
+/**
+ * Copy the counters, held times include the current hold.
+ */
+void power_get_stats(power_stats_t *stats);
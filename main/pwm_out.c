@@ -0,0 +1,360 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/ledc.h"
+#include "soc/soc_caps.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "latency_trace.h"
+#include "pwm_phase.h"
+#include "power.h"
+#include "pwm_out.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define LEDC_LS_MODE           LEDC_LOW_SPEED_MODE
+#define LEDC_TIMER_NUM         LEDC_TIMER_MAX
+#define LEDC_PERIOD            (1 << 13)    // timer counts per PWM period, 13 bit resolution
+#define LEDC_HEATER_FIRST      HEATER_MODE_NUM     // outputs from here on drive heater Mosfets and are phase staggered per timer
+#define LEDC_DUTY_FULL         (LEDC_PERIOD - 1)
+#define RAMP_SEGMENTS          (4)          // linear hardware fades per transition, together they approximate the curve
+#define RAMP_IDLE              RAMP_SEGMENTS
+
+static const char *TAG = "PWM: ";
+
+/**********************
+ *  CONFIGURATION
+ **********************/
+static const ledc_timer_config_t ledc_timer = {   // every timer used by the zone table runs this configuration
+    .duty_resolution = LEDC_TIMER_13_BIT, // resolution of PWM duty
+    .freq_hz = 5000,                      // frequency of PWM signal
+    .speed_mode = LEDC_LS_MODE,           // timer mode
+    .timer_num = LEDC_TIMER_1,            // timer index, replaced per timer
+    .clk_cfg = LEDC_AUTO_CLK,              // Auto select the source clock
+};
+
+_Static_assert(LEDC_CH_NUM <= SOC_LEDC_CHANNEL_NUM, "more zones and mode LEDs than LEDC channels");
+_Static_assert(HEATER_ZONE_NUM <= PWM_PHASE_CH_MAX, "more zones than the phase scheduler handles");
+
+typedef struct {
+    uint32_t up_ms;                         // off to full scale, smaller steps take a proportional share
+    uint32_t down_ms;                       // full scale to off
+    uint8_t up[RAMP_SEGMENTS];              // share of the step reached after each segment, 1/255, last entry 255
+    uint8_t down[RAMP_SEGMENTS];
+} pwm_ramp_t;
+
+static const pwm_ramp_t ramp_led = {       // mode LEDs: slow start and fast drop, the eye resolves low duties best
+    .up_ms   = CONFIG_PWM_LED_RAMP_MS,
+    .down_ms = CONFIG_PWM_LED_RAMP_MS,
+    .up      = { 16, 64, 143, 255 },
+    .down    = { 112, 191, 239, 255 },
+};
+
+static const pwm_ramp_t ramp_heater = {    // heaters: soft start while the cold elements draw the highest current, linear down
+    .up_ms   = CONFIG_PWM_HEATER_RAMP_UP_MS,
+    .down_ms = CONFIG_PWM_HEATER_RAMP_DOWN_MS,
+    .up      = { 16, 64, 143, 255 },
+    .down    = { 64, 128, 191, 255 },
+};
+
+typedef struct {
+    uint32_t from;                          // duty at the start of the transition
+    uint32_t to;                            // duty at the end of the transition
+    int segment;                            // next segment to start, RAMP_IDLE when no transition is in progress
+    bool fading;                            // a hardware fade runs, the channel waits for its fade end callback
+} pwm_ramp_state_t;
+
+/**********************
+ *  VARIABLES
+ **********************/
+static TaskHandle_t xPwm_out;
+static ledc_channel_config_t ledc_channel[LEDC_CH_NUM];   // per output, from the mode LED and zone tables
+static uint32_t timers_used;               // bit per LEDC timer driving an output
+static portMUX_TYPE pwm_out_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t pending[LEDC_CH_NUM];      // latest targets, protected by pwm_out_lock
+static uint32_t committed[LEDC_CH_NUM];    // duties latched in the LEDC registers, or the end duty of the running fade, owned by the output task
+static uint32_t committed_hpoint[LEDC_CH_NUM];     // switch-on offsets currently latched, owned by the output task
+static pwm_ramp_state_t ramp[LEDC_CH_NUM];        // owned by the output task
+static uint32_t fade_done;                 // channel bits set by the fade end callback, protected by pwm_out_lock
+static bool outputs_held;                  // POWER_LOCK_OUTPUTS taken, owned by the output task
+static bool safe;                          // heaters forced off until restart, protected by pwm_out_lock
+static pwm_out_stats_t stats;
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static void pwm_out_plan(const uint32_t duty[LEDC_CH_NUM], uint32_t hpoint[LEDC_CH_NUM])   // stagger the heater switch-on times per timer, mode LEDs stay at 0
+{
+    for (int ch = 0; ch < LEDC_HEATER_FIRST; ch++) {
+        hpoint[ch] = 0;
+    }
+    for (int timer = 0; timer < LEDC_TIMER_NUM; timer++) {     // counters of different timers are not aligned, plan each on its own
+        uint32_t d[HEATER_ZONE_NUM], h[HEATER_ZONE_NUM];
+        int index[HEATER_ZONE_NUM];
+        int n = 0;
+
+        if (!(timers_used & (1u << timer))) {
+            continue;
+        }
+        for (int ch = LEDC_HEATER_FIRST; ch < LEDC_CH_NUM; ch++) {
+            if (ledc_channel[ch].timer_sel == timer) {
+                index[n] = ch;
+                d[n++] = duty[ch];
+            }
+        }
+        pwm_phase_plan(d, h, n, LEDC_PERIOD);
+        for (int i = 0; i < n; i++) {
+            hpoint[index[i]] = h[i];
+        }
+    }
+}
+
+static void pwm_out_channels(void)     // LEDC configuration of every output from the mode LED and zone tables
+{
+    for (int ch = 0; ch < LEDC_CH_NUM; ch++) {
+        ledc_channel_config_t *config = &ledc_channel[ch];
+
+        if (ch < LEDC_HEATER_FIRST) {
+            config->channel   = heater_mode_leds[ch].ledc_channel;
+            config->gpio_num  = heater_mode_leds[ch].gpio;
+            config->timer_sel = heater_mode_leds[ch].ledc_timer;
+        }
+        else {
+            config->channel   = heater_zones[ch - LEDC_HEATER_FIRST].ledc_channel;
+            config->gpio_num  = heater_zones[ch - LEDC_HEATER_FIRST].gpio;
+            config->timer_sel = heater_zones[ch - LEDC_HEATER_FIRST].ledc_timer;
+        }
+        config->speed_mode = LEDC_LS_MODE;
+        config->duty = 0;
+        config->hpoint = 0;
+        config->flags.output_invert = 0;
+        timers_used |= 1u << config->timer_sel;
+    }
+}
+
+static bool pwm_out_busy(const uint32_t target[LEDC_CH_NUM])   // any output on, on its way or asked to go on
+{
+    for (int ch = 0; ch < LEDC_CH_NUM; ch++) {
+        if (target[ch] != 0 || committed[ch] != 0 || ramp[ch].fading || ramp[ch].segment != RAMP_IDLE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool IRAM_ATTR pwm_out_fade_end(const ledc_cb_param_t *param, void *user_arg)   // LEDC ISR: hand the channel back to the output task
+{
+    BaseType_t woken = pdFALSE;
+
+    if (param->event == LEDC_FADE_END_EVT) {
+        portENTER_CRITICAL_ISR(&pwm_out_lock);
+        fade_done |= 1u << (uint32_t)user_arg;
+        portEXIT_CRITICAL_ISR(&pwm_out_lock);
+        vTaskNotifyGiveFromISR(xPwm_out, &woken);
+    }
+    return woken == pdTRUE;
+}
+
+static void pwm_out_ramp_step(int ch)  // start the next segment of a transition, returns once a fade runs or the transition is done
+{
+    const pwm_ramp_t *r = ch < LEDC_HEATER_FIRST ? &ramp_led : &ramp_heater;
+    pwm_ramp_state_t *rs = &ramp[ch];
+    bool up = rs->to > rs->from;
+    uint32_t delta = up ? rs->to - rs->from : rs->from - rs->to;
+    uint32_t segment_ms = (up ? r->up_ms : r->down_ms) * delta / LEDC_DUTY_FULL / RAMP_SEGMENTS;
+
+    while (rs->segment < RAMP_SEGMENTS) {
+        uint32_t share = (up ? r->up : r->down)[rs->segment++];
+        uint32_t step = delta * share / 255;
+        uint32_t duty = up ? rs->from + step : rs->from - step;
+
+        if (duty == committed[ch]) {
+            continue;
+        }
+        if (segment_ms == 0) {              // too small for a fade, write directly
+            ledc_set_duty(ledc_channel[ch].speed_mode, ledc_channel[ch].channel, duty);
+            ledc_update_duty(ledc_channel[ch].speed_mode, ledc_channel[ch].channel);
+            committed[ch] = duty;
+            stats.applied++;
+            continue;
+        }
+        if (ledc_set_fade_with_time(ledc_channel[ch].speed_mode, ledc_channel[ch].channel, duty, segment_ms) != ESP_OK ||
+            ledc_fade_start(ledc_channel[ch].speed_mode, ledc_channel[ch].channel, LEDC_FADE_NO_WAIT) != ESP_OK) {
+            ESP_LOGE(TAG, "fade on channel %d failed", ch);
+            rs->segment = RAMP_IDLE;
+            return;
+        }
+        committed[ch] = duty;
+        rs->fading = true;
+        stats.fades++;
+        return;
+    }
+}
+
+static void pwm_out_off(int ch)     // heater output disabled at level 0 right away, also during a fade: only the LEDC spinlock, no fade lock
+{
+    ledc_stop(ledc_channel[ch].speed_mode, ledc_channel[ch].channel, 0);
+}
+
+static void pwm_out_task(void *pvParameters)   // start transitions for changed targets, continue them on fade end, sleep in between
+{
+    uint32_t target[LEDC_CH_NUM];
+    uint32_t hpoint[LEDC_CH_NUM];
+    uint32_t done;
+    bool off;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint32_t applied = stats.applied + stats.fades;
+
+        portENTER_CRITICAL(&pwm_out_lock);
+        memcpy(target, pending, sizeof(target));
+        done = fade_done;
+        fade_done = 0;
+        off = safe;
+        portEXIT_CRITICAL(&pwm_out_lock);
+
+        if (!outputs_held && pwm_out_busy(target)) {
+            power_acquire(POWER_LOCK_OUTPUTS);   // LEDC counts APB cycles, no frequency change or sleep while an output runs
+            outputs_held = true;
+        }
+        pwm_out_plan(target, hpoint);       // only runs on a new target or a fade end, the task sleeps otherwise
+        for (int ch = 0; ch < LEDC_CH_NUM; ch++) {
+            if (done & (1u << ch)) {
+                ramp[ch].fading = false;
+            }
+            if (off && ch >= LEDC_HEATER_FIRST) {
+                if (committed[ch] != 0 || ramp[ch].fading || ramp[ch].segment != RAMP_IDLE) {
+                    pwm_out_off(ch);        // no more fades or duty updates on the heaters, they would enable the output again
+                    committed[ch] = 0;
+                    ramp[ch] = (pwm_ramp_state_t){ .from = 0, .to = 0, .segment = RAMP_IDLE, .fading = false };
+                    stats.applied++;
+                }
+                continue;
+            }
+            if (ramp[ch].fading) {
+                continue;                   // the fade engine owns the channel until its fade end callback
+            }
+            if (target[ch] != ramp[ch].to) {    // new transition, also replaces one that is halfway
+                ramp[ch].from = committed[ch];
+                ramp[ch].to = target[ch];
+                ramp[ch].segment = 0;
+            }
+            else if (ramp[ch].segment == RAMP_IDLE && hpoint[ch] == committed_hpoint[ch]) {
+                stats.skipped++;
+                continue;
+            }
+            if (hpoint[ch] != committed_hpoint[ch]) {   // fades keep the hpoint, move the phase before the next segment
+                ledc_set_duty_with_hpoint(ledc_channel[ch].speed_mode, ledc_channel[ch].channel, committed[ch], hpoint[ch]);
+                ledc_update_duty(ledc_channel[ch].speed_mode, ledc_channel[ch].channel);
+                committed_hpoint[ch] = hpoint[ch];
+                stats.applied++;
+            }
+            pwm_out_ramp_step(ch);
+        }
+        if (stats.applied + stats.fades != applied) {
+            latency_mark(LAT_STAGE_PWM);
+        }
+        if (outputs_held && !pwm_out_busy(target)) {
+            power_release(POWER_LOCK_OUTPUTS);   // all outputs at 0 and settled
+            outputs_held = false;
+        }
+    }
+}
+
+void pwm_out_init(const uint32_t duty[LEDC_CH_NUM])
+{
+    uint32_t hpoint[LEDC_CH_NUM];
+
+    pwm_out_channels();
+    for (int timer = 0; timer < LEDC_TIMER_NUM; timer++) {
+        if (timers_used & (1u << timer)) {
+            ledc_timer_config_t config = ledc_timer;
+            config.timer_num = timer;
+            ledc_timer_config(&config);
+        }
+    }
+    ledc_fade_func_install(0);
+    pwm_out_plan(duty, hpoint);
+
+    // Set LED Controller with previously prepared configuration: mode LEDs start at their duty, heaters start off in their
+    // final phase and the output task soft starts them right away
+    for (int ch = 0; ch < LEDC_CH_NUM; ch++) {
+        ledc_channel_config_t config = ledc_channel[ch];
+        config.duty = ch < LEDC_HEATER_FIRST ? duty[ch] : 0;
+        config.hpoint = hpoint[ch];
+        ledc_channel_config(&config);
+        committed[ch] = config.duty;
+        committed_hpoint[ch] = hpoint[ch];
+        pending[ch] = safe && ch >= LEDC_HEATER_FIRST ? 0 : duty[ch];
+        ramp[ch].from = config.duty;
+        ramp[ch].to = config.duty;
+        ramp[ch].segment = RAMP_IDLE;
+    }
+
+    xTaskCreate(pwm_out_task, "pwm_out", 2 * 1024, NULL, 5, &xPwm_out);
+
+    // fade ends are reported from the LEDC interrupt, the task handle has to exist first
+    for (int ch = 0; ch < LEDC_CH_NUM; ch++) {
+        ledc_cbs_t cbs = { .fade_cb = pwm_out_fade_end };
+        ledc_cb_register(ledc_channel[ch].speed_mode, ledc_channel[ch].channel, &cbs, (void *)ch);
+    }
+    xTaskNotifyGive(xPwm_out);
+}
+
+void pwm_out_set(const uint32_t duty[LEDC_CH_NUM])
+{
+    bool changed;
+
+    uint32_t target[LEDC_CH_NUM];
+
+    memcpy(target, duty, sizeof(target));
+    portENTER_CRITICAL(&pwm_out_lock);
+    for (int ch = LEDC_HEATER_FIRST; safe && ch < LEDC_CH_NUM; ch++) {
+        target[ch] = 0;
+    }
+    changed = memcmp(pending, target, sizeof(pending)) != 0;
+    if (changed) {
+        memcpy(pending, target, sizeof(pending));
+        stats.targets++;
+    }
+    else {
+        stats.skipped += LEDC_CH_NUM;
+    }
+    portEXIT_CRITICAL(&pwm_out_lock);
+
+    if (changed) {
+        xTaskNotifyGive(xPwm_out);
+    }
+}
+
+void pwm_out_safe(void)
+{
+    portENTER_CRITICAL(&pwm_out_lock);
+    safe = true;
+    for (int ch = LEDC_HEATER_FIRST; ch < LEDC_CH_NUM; ch++) {
+        pending[ch] = 0;
+    }
+    portEXIT_CRITICAL(&pwm_out_lock);
+
+    if (xPwm_out == NULL) {
+        return;                 // not started, pwm_out_init() starts the heaters from the masked targets
+    }
+    // write the registers here as well, the output task may be the one that hangs
+    for (int ch = LEDC_HEATER_FIRST; ch < LEDC_CH_NUM; ch++) {
+        pwm_out_off(ch);
+    }
+    xTaskNotifyGive(xPwm_out);
+}
+
+void pwm_out_get_stats(pwm_out_stats_t *out)
+{
+    portENTER_CRITICAL(&pwm_out_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&pwm_out_lock);
+}
@@ -0,0 +1,45 @@
+/*
+PWM output stage:
+-Owns the LEDC timers and output channels of the mode LEDs and of every heater zone, see heater_zones.h.
+-Keeps the last committed duty per channel and only writes the registers of channels whose target changed.
+-Level changes ramp on the LEDC fade engine, a few linear fades per transition shape the curve of each channel class (see Kconfig).
+-The fade end callback wakes the task for the next segment, no CPU time is spent during a fade.
+-Heater channels get staggered switch-on offsets (hpoint) from pwm_phase_plan() per LEDC timer, recomputed whenever a duty changes.
+-The output task sleeps until a new target set arrives or a fade ends. It holds a power lock while any output is not 0.
+-pwm_out_safe() forces every heater output to 0 without a ramp and keeps it there until restart, for the supervisor.
+*/
+#pragma once
+
+#include <stdint.h>
+#include "heater_zones.h"
+
+#define LEDC_CH_NUM             HEATER_CH_NUM   // outputs: mode LEDs first, then the heater zones in table order
+
+typedef struct {
+    uint32_t targets;           // pwm_out_set() calls that carried a change
+    uint32_t applied;           // direct channel register updates written to LEDC
+    uint32_t fades;             // hardware fade segments started
+    uint32_t skipped;           // channel register updates avoided because the duty was unchanged
+} pwm_out_stats_t;
+
+/**
+ * Configure the LEDC timer and channels and start the output task. Mode LEDs start at the given duty,
+ * heaters soft start to it.
+ */
+void pwm_out_init(const uint32_t duty[LEDC_CH_NUM]);
+
+/**
+ * Stage new target duties for all channels. Wakes the output task only if a target differs, the outputs then ramp to it.
+ */
+void pwm_out_set(const uint32_t duty[LEDC_CH_NUM]);
+
+/**
+ * Force every heater output to 0, right away and from any task, and ignore heater targets from then on. Mode LEDs keep working.
+ * Never blocks: the outputs are disabled with ledc_stop(), which does not wait for a running fade as ledc_set_duty() does.
+ */
+void pwm_out_safe(void);
+
+/**
+ * Copy the register update counters.
+ */
+void pwm_out_get_stats(pwm_out_stats_t *stats);
@@ -0,0 +1,80 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include "pwm_phase.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define CANDIDATES_MAX      (2 + 2 * PWM_PHASE_CH_MAX)     // period start and end, next to every placed channel
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static uint32_t overlap(uint32_t a_start, uint32_t a_len, uint32_t b_start, uint32_t b_len)
+{
+    uint32_t start = a_start > b_start ? a_start : b_start;
+    uint32_t end_a = a_start + a_len;
+    uint32_t end_b = b_start + b_len;
+    uint32_t end = end_a < end_b ? end_a : end_b;
+
+    return end > start ? end - start : 0;
+}
+
+void pwm_phase_plan(const uint32_t *duty, uint32_t *hpoint, int n, uint32_t period)
+{
+    int order[PWM_PHASE_CH_MAX];
+    int placed[PWM_PHASE_CH_MAX];
+    int n_order = 0;
+    int n_placed = 0;
+
+    // channels to schedule, longest on-time first
+    for (int ch = 0; ch < n && ch < PWM_PHASE_CH_MAX; ch++) {
+        hpoint[ch] = 0;
+        if (duty[ch] == 0 || duty[ch] >= period) {
+            continue;
+        }
+        int i = n_order++;
+        while (i > 0 && duty[order[i - 1]] < duty[ch]) {
+            order[i] = order[i - 1];
+            i--;
+        }
+        order[i] = ch;
+    }
+
+    for (int k = 0; k < n_order; k++) {
+        int ch = order[k];
+        uint32_t len = duty[ch];
+        uint32_t last = period - len;       // latest start that still ends inside the period
+        uint32_t candidates[CANDIDATES_MAX];
+        int n_cand = 0;
+
+        // the best start touches a period end or a placed on-time
+        candidates[n_cand++] = 0;
+        candidates[n_cand++] = last;
+        for (int p = 0; p < n_placed; p++) {
+            uint32_t end = hpoint[placed[p]] + duty[placed[p]];
+            if (end <= last) {
+                candidates[n_cand++] = end;
+            }
+            if (hpoint[placed[p]] >= len) {
+                candidates[n_cand++] = hpoint[placed[p]] - len;
+            }
+        }
+
+        uint32_t best = 0;
+        uint32_t best_cost = UINT32_MAX;
+        for (int c = 0; c < n_cand; c++) {
+            uint32_t cost = 0;
+            for (int p = 0; p < n_placed; p++) {
+                cost += overlap(candidates[c], len, hpoint[placed[p]], duty[placed[p]]);
+            }
+            if (cost < best_cost || (cost == best_cost && candidates[c] < best)) {
+                best = candidates[c];
+                best_cost = cost;
+            }
+        }
+        hpoint[ch] = best;
+        placed[n_placed++] = ch;
+    }
+}
@@ -0,0 +1,19 @@
+/*
+PWM phase scheduler:
+-Channels on one LEDC timer switch on at their hpoint and off at hpoint + duty. With every hpoint at 0 all heaters switch on together.
+-pwm_phase_plan() spreads the on-times of the given channels across the period so they overlap as little as possible.
+-Greedy: the longest on-time is placed first, every further one goes to the offset with the least overlap with the placed ones.
+-hpoint + duty never exceeds the period, the LEDC does not wrap an on-time around the period end.
+-Plain C without ESP-IDF dependencies, also built natively, see host/CMakeLists.txt.
+*/
+#pragma once
+
+#include <stdint.h>
+
+#define PWM_PHASE_CH_MAX        (8)
+
+/**
+ * Compute hpoint offsets for n channels with the given duties, period is the timer period in counts (2^resolution).
+ * Channels that are off or fully on get hpoint 0.
+ */
+void pwm_phase_plan(const uint32_t *duty, uint32_t *hpoint, int n, uint32_t period);
@@ -0,0 +1,72 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include "sensor_math.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define MAGNUS_A_Q12        (72172)     // 17.62 * 4096
+#define MAGNUS_B_CENTI      (24312)     // 243.12 C in 0.01 C
+#define TEMP_MIN            (-400)      // DHT22 range in 0.1 C, keeps the Q12 products in 32 bit
+#define TEMP_MAX            (800)
+#define LN2_Q16             (45426)     // ln(2) * 65536
+#define LOG2_1000_Q16       (653118)    // log2(1000) * 65536, humidity is in 0.1 %
+
+/**********************
+ *  ARRAYS
+ **********************/
+static const int32_t log2_table[33] = {     // log2(1 + i/32) * 65536
+    0,     2909,  5732,  8473,  11136, 13727, 16248, 18704,
+    21098, 23433, 25711, 27936, 30109, 32234, 34312, 36346,
+    38336, 40286, 42196, 44068, 45904, 47705, 49472, 51207,
+    52911, 54584, 56229, 57845, 59434, 60997, 62534, 64047,
+    65536
+};
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static int32_t log2_q16(uint32_t x)     // log2(x) in Q16 for x >= 1
+{
+    int msb = 31 - __builtin_clz(x);
+    uint32_t mant = msb >= 16 ? x >> (msb - 16) : x << (16 - msb);     // 1.16 fixed point, 65536..131071
+    uint32_t frac = mant - 65536;
+    uint32_t i = frac >> 11;                // table index, 32 steps
+    uint32_t f = frac & 0x7FF;              // position between the entries
+    int32_t lo = log2_table[i];
+    int32_t hi = log2_table[i + 1];
+
+    return msb * 65536 + lo + (((hi - lo) * (int32_t)f) >> 11);
+}
+
+int16_t sensor_dewpoint(int16_t temperature, int16_t humidity)
+{
+    if (humidity < 1) {
+        humidity = 1;
+    }
+    if (humidity > 1000) {
+        humidity = 1000;
+    }
+    if (temperature < TEMP_MIN) {
+        temperature = TEMP_MIN;
+    }
+    if (temperature > TEMP_MAX) {
+        temperature = TEMP_MAX;
+    }
+
+    // gamma = ln(RH) + a * T / (b + T), all Q12
+    int32_t ln_rh = ((log2_q16(humidity) - LOG2_1000_Q16) >> 4) * LN2_Q16 / 65536;
+    int32_t t_centi = temperature * 10;
+    int32_t gamma = ln_rh + MAGNUS_A_Q12 * t_centi / (MAGNUS_B_CENTI + t_centi);
+
+    // dew point = b * gamma / (a - gamma), in 0.01 C, rounded to 0.1 C
+    int32_t dew_centi = MAGNUS_B_CENTI * gamma / (MAGNUS_A_Q12 - gamma);
+    return (int16_t)((dew_centi + (dew_centi >= 0 ? 5 : -5)) / 10);
+}
+
+int16_t sensor_spread(int16_t temperature, int16_t humidity)
+{
+    int16_t spread = temperature - sensor_dewpoint(temperature, humidity);
+    return spread > 0 ? spread : 0;
+}
@@ -0,0 +1,20 @@
+/*
+Fixed-point sensor math:
+-Dew point with the Magnus approximation (a = 17.62, b = 243.12 C) and the dew-point spread, in 0.1 C like the DHT22 values.
+-Integer only, the ESP32-S2 has no FPU. ln() uses a 33 entry log2 table with linear interpolation, intermediate values are Q12.
+-Error against a double precision Magnus formula is below 0.06 C from -40 to 80 C and 0.1 to 100 %, most of it the rounding to 0.1 C, see host/bench_sensor_math.c.
+-Plain C without ESP-IDF dependencies, also built natively, see host/CMakeLists.txt.
+*/
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Dew point in 0.1 C from temperature in 0.1 C and relative humidity in 0.1 %. Humidity is clamped to 0.1-100 %.
+ */
+int16_t sensor_dewpoint(int16_t temperature, int16_t humidity);
+
+/**
+ * Dew-point spread in 0.1 C: how far the air can cool before water condenses, 0 at 100 % humidity.
+ */
+int16_t sensor_spread(int16_t temperature, int16_t humidity);
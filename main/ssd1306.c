@@ -0,0 +1,110 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include "freertos/FreeRTOS.h"
+#include "driver/i2c.h"
+#include "esp_log.h"
+#include "ssd1306.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define CTRL_CMD                (0x80)      // control byte: one command byte follows, then another control byte
+#define CTRL_DATA               (0x40)      // control byte: display data up to the stop
+#define LINK_OPS                (12)        // start, address, 6 command pairs as writes, data, stop
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const char *TAG = "SSD1306: ";
+
+static const uint8_t init_cmds[] = {
+    0xae,           // display off
+    0xd5, 0x80,     // clock divide ratio and oscillator frequency
+    0xa8, 0x3f,     // multiplex ratio 64
+    0xd3, 0x00,     // display offset 0
+    0x40,           // start line 0
+    0x8d, 0x14,     // charge pump on
+    0x20, 0x00,     // horizontal addressing, the column and page windows of a flush wrap inside the window
+    0xa1,           // segment remap, column 127 is SEG0
+    0xc8,           // COM scan from COM63 to COM0
+    0xda, 0x12,     // COM pins alternative configuration
+    0x81, 0xcf,     // contrast
+    0xd9, 0xf1,     // pre-charge period
+    0xdb, 0x40,     // VCOMH deselect level
+    0xa4,           // display follows RAM
+    0xa6,           // normal, not inverted
+    0xaf,           // display on
+};
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static esp_err_t ssd1306_write(const uint8_t *cmds, int n_cmds, const uint8_t *data, int n_data)   // one transaction: commands, then data
+{
+    static uint8_t link[I2C_LINK_RECOMMENDED_SIZE(LINK_OPS)];
+    uint8_t pairs[2 * sizeof(init_cmds)];
+    esp_err_t err;
+
+    for (int i = 0; i < n_cmds; i++) {
+        pairs[2 * i] = CTRL_CMD;
+        pairs[2 * i + 1] = cmds[i];
+    }
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(link, sizeof(link));
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, SSD1306_I2C_ADDR << 1 | I2C_MASTER_WRITE, true);
+    i2c_master_write(cmd, pairs, 2 * n_cmds, true);
+    if (n_data > 0) {
+        i2c_master_write_byte(cmd, CTRL_DATA, true);
+        i2c_master_write(cmd, data, n_data, true);
+    }
+    i2c_master_stop(cmd);
+    err = i2c_master_cmd_begin(SSD1306_I2C_PORT, cmd, pdMS_TO_TICKS(SSD1306_TIMEOUT_MS));
+    i2c_cmd_link_delete_static(cmd);
+    return err;
+}
+
+esp_err_t ssd1306_init(void)
+{
+    const i2c_config_t config = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = SSD1306_I2C_SDA,
+        .scl_io_num = SSD1306_I2C_SCL,
+        .sda_pullup_en = GPIO_PULLUP_DISABLE,      // external pull-ups on the display module
+        .scl_pullup_en = GPIO_PULLUP_DISABLE,
+        .master.clk_speed = SSD1306_I2C_HZ,
+    };
+    esp_err_t err = i2c_param_config(SSD1306_I2C_PORT, &config);
+    if (err == ESP_OK) {
+        err = i2c_driver_install(SSD1306_I2C_PORT, I2C_MODE_MASTER, 0, 0, 0);
+    }
+    if (err == ESP_OK) {
+        err = ssd1306_write(init_cmds, sizeof(init_cmds), NULL, 0);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%s) initializing the display", esp_err_to_name(err));
+    }
+    return err;
+}
+
+int ssd1306_flush(oled_fb_t *fb, uint32_t *bytes)
+{
+    int pages = 0;
+    int x0, x1;
+
+    *bytes = 0;
+    for (int p = 0; p < OLED_PAGES; p++) {
+        if (!oled_fb_take_dirty(fb, p, &x0, &x1)) {
+            continue;
+        }
+        const uint8_t window[] = { 0x21, x0, x1, 0x22, p, p };     // column range, page range
+        esp_err_t err = ssd1306_write(window, sizeof(window), &fb->page[p][x0], x1 - x0 + 1);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Error (%s) writing page %d", esp_err_to_name(err), p);
+            return -1;
+        }
+        pages++;
+        *bytes += x1 - x0 + 1;
+    }
+    return pages;
+}
@@ -0,0 +1,27 @@
+/*
+SSD1306 I2C driver of the framebuffer renderer:
+-Own init sequence and page writes on the legacy I2C driver, no LVGL or lvgl_esp32_drivers code.
+-A flush sends only the dirty column window of each dirty page, one I2C transaction per page, commands and data together.
+*/
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "oled_fb.h"
+
+#define SSD1306_I2C_PORT        (0)
+#define SSD1306_I2C_SDA         (8)         // same pins and clock as the LVGL driver configuration
+#define SSD1306_I2C_SCL         (9)
+#define SSD1306_I2C_HZ          (400000)
+#define SSD1306_I2C_ADDR        (0x3c)
+#define SSD1306_TIMEOUT_MS      (20)
+
+/**
+ * Install the I2C driver and switch the display on with a blank screen.
+ */
+esp_err_t ssd1306_init(void);
+
+/**
+ * Send the dirty page windows of fb. *bytes receives the number of pixel bytes sent, returns the number of pages sent or -1.
+ */
+int ssd1306_flush(oled_fb_t *fb, uint32_t *bytes);
@@ -0,0 +1,269 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_task_wdt.h"
+#include "esp_timer.h"
+#include "pwm_out.h"
+#include "supervisor.h"
+
+/**********************
+ *  TYPES
+ **********************/
+typedef struct {
+    int64_t period_us;
+    int64_t deadline_us;
+    int64_t last_beat;          // us on the esp_timer clock: start of the last run, or when the current period started
+    int64_t run_start;          // valid while running
+    bool running;
+    bool flagged;               // the check already counted the current miss
+    sup_watch_stats_t stats;
+} sup_entry_t;
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const char *TAG = "Supervisor: ";
+
+static TaskHandle_t xSup;
+static portMUX_TYPE sup_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static sup_entry_t watches[SUP_WATCHES_MAX];   // protected by sup_lock
+static int n_watches;
+static sup_stats_t stats = { .cause = -1 };
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static sup_state_t sup_state(const sup_entry_t *w, int64_t now)    // sup_lock held
+{
+    if (w->running) {
+        return now - w->run_start > w->deadline_us ? SUP_STALLED : SUP_OK;
+    }
+    if (w->period_us > 0 && now - w->last_beat > w->period_us + w->deadline_us) {
+        return SUP_LATE;
+    }
+    return SUP_OK;
+}
+
+static sup_watch_t sup_check(int64_t now, uint32_t *newly)    // update every watch, returns a critical watch late long enough to force the heaters off
+{
+    sup_watch_t cause = -1;
+
+    *newly = 0;
+    portENTER_CRITICAL(&sup_lock);
+    stats.checks++;
+    for (int i = 0; i < n_watches; i++) {
+        sup_entry_t *w = &watches[i];
+
+        w->stats.state = sup_state(w, now);
+        if (w->stats.state == SUP_OK) {
+            w->stats.late_checks = 0;
+            continue;
+        }
+        if (!w->flagged) {          // counted once, the heartbeat or run end that finally comes does not count it again
+            w->flagged = true;
+            w->stats.missed++;
+            *newly |= 1u << i;
+        }
+        w->stats.late_checks++;
+        if (w->stats.critical && w->stats.late_checks >= SUP_MISSES_SAFE && cause < 0) {
+            cause = i;
+        }
+    }
+    portEXIT_CRITICAL(&sup_lock);
+    return cause;
+}
+
+/**********************
+ *  TASKS
+ **********************/
+static void sup_task(void *pvParameters)   // check the watches, force the heaters off on a sustained miss, feed the task watchdog
+{
+    bool subscribed = false;
+    bool reset_logged = false;
+    int64_t stall_since = 0;    // a critical watch is late for SUP_MISSES_SAFE checks or more since then, 0 = none
+
+    while (1) {
+        bool active = stats.active;
+
+        if (active != subscribed) {
+            esp_err_t err = active ? esp_task_wdt_add(NULL) : esp_task_wdt_delete(NULL);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Error (%s) changing the task watchdog subscription", esp_err_to_name(err));
+            }
+            subscribed = active;
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(active ? SUP_PERIOD_MS : SUP_PERIOD_OFF_MS));
+
+        int64_t now = esp_timer_get_time();
+        uint32_t newly;
+        sup_watch_t cause = sup_check(now, &newly);
+
+        for (int i = 0; newly != 0; i++, newly >>= 1) {
+            if (newly & 1) {
+                ESP_LOGW(TAG, "%s %s", watches[i].stats.name, watches[i].stats.state == SUP_STALLED ? "stalled in a run" : "missed its heartbeat");
+            }
+        }
+        if (cause < 0) {
+            stall_since = 0;
+        }
+        else if (stall_since == 0) {
+            stall_since = now;
+        }
+        if (cause >= 0 && !stats.safe) {
+            pwm_out_safe();
+            portENTER_CRITICAL(&sup_lock);
+            stats.safe = true;
+            stats.cause = cause;
+            portEXIT_CRITICAL(&sup_lock);
+            ESP_LOGE(TAG, "%s late for %d checks, heaters forced off until restart", watches[cause].stats.name, SUP_MISSES_SAFE);
+        }
+
+        if (!subscribed) {
+            continue;
+        }
+        if (cause < 0 || now - stall_since < (int64_t)SUP_RESET_MS * 1000) {
+            esp_task_wdt_reset();
+        }
+        else if (!reset_logged) {      // the watchdog resets the chip within its timeout
+            ESP_LOGE(TAG, "%s stalled for %d s with the heaters off, no more watchdog feed", watches[cause].stats.name, SUP_RESET_MS / 1000);
+            reset_logged = true;
+        }
+    }
+}
+
+/**********************
+ *  API
+ **********************/
+esp_err_t sup_init(void)
+{
+    if (xTaskCreate(sup_task, "sup", SUP_STACK_SIZE, NULL, SUP_PRIORITY, &xSup) != pdPASS) {
+        ESP_LOGE(TAG, "task creation failed");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+sup_watch_t sup_watch(const char *name, uint32_t period_ms, uint32_t deadline_ms, bool critical)
+{
+    sup_watch_t handle = -1;
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&sup_lock);
+    if (n_watches < SUP_WATCHES_MAX) {
+        sup_entry_t *w = &watches[n_watches];
+        w->period_us = (int64_t)period_ms * 1000;
+        w->deadline_us = (int64_t)deadline_ms * 1000;
+        w->last_beat = now;
+        w->stats.name = name;
+        w->stats.critical = critical;
+        handle = n_watches++;
+        stats.watches = n_watches;
+    }
+    portEXIT_CRITICAL(&sup_lock);
+
+    if (handle < 0) {
+        ESP_LOGE(TAG, "no room for watch %s, raise SUP_WATCHES_MAX", name);
+    }
+    return handle;
+}
+
+void sup_set_period(sup_watch_t watch, uint32_t period_ms)
+{
+    if (watch < 0 || watch >= n_watches) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&sup_lock);
+    if (watches[watch].period_us != (int64_t)period_ms * 1000) {
+        watches[watch].period_us = (int64_t)period_ms * 1000;
+        watches[watch].last_beat = now;
+    }
+    portEXIT_CRITICAL(&sup_lock);
+}
+
+void sup_begin(sup_watch_t watch)
+{
+    if (watch < 0 || watch >= n_watches) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    sup_entry_t *w = &watches[watch];
+
+    portENTER_CRITICAL(&sup_lock);
+    if (w->period_us > 0) {
+        int64_t late = now - w->last_beat - w->period_us;
+        if (late > w->deadline_us && !w->flagged) {
+            w->stats.missed++;
+        }
+        if (late > (int64_t)w->stats.max_jitter_us) {
+            w->stats.max_jitter_us = (uint32_t)late;
+        }
+    }
+    w->last_beat = now;
+    w->run_start = now;
+    w->running = true;
+    w->flagged = false;
+    w->stats.beats++;
+    portEXIT_CRITICAL(&sup_lock);
+}
+
+void sup_end(sup_watch_t watch)
+{
+    if (watch < 0 || watch >= n_watches) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    sup_entry_t *w = &watches[watch];
+
+    portENTER_CRITICAL(&sup_lock);
+    if (w->running) {
+        int64_t run = now - w->run_start;
+        if (run > w->deadline_us && !w->flagged) {
+            w->stats.missed++;
+        }
+        if (run > (int64_t)w->stats.wcet_us) {
+            w->stats.wcet_us = (uint32_t)run;
+        }
+        w->running = false;
+        w->flagged = false;
+    }
+    portEXIT_CRITICAL(&sup_lock);
+}
+
+void sup_set_active(bool active)
+{
+    portENTER_CRITICAL(&sup_lock);
+    bool changed = stats.active != active;
+    stats.active = active;
+    portEXIT_CRITICAL(&sup_lock);
+
+    if (changed && xSup != NULL) {
+        xTaskNotifyGive(xSup);      // new check period and watchdog subscription
+    }
+}
+
+bool sup_get_watch_stats(sup_watch_t watch, sup_watch_stats_t *out)
+{
+    if (watch < 0 || watch >= n_watches) {
+        return false;
+    }
+    portENTER_CRITICAL(&sup_lock);
+    *out = watches[watch].stats;
+    out->period_ms = (uint32_t)(watches[watch].period_us / 1000);
+    out->deadline_ms = (uint32_t)(watches[watch].deadline_us / 1000);
+    portEXIT_CRITICAL(&sup_lock);
+    return true;
+}
+
+void sup_get_stats(sup_stats_t *out)
+{
+    portENTER_CRITICAL(&sup_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&sup_lock);
+    out->stack_free = xSup != NULL ? uxTaskGetStackHighWaterMark(xSup) : 0;
+}
@@ -0,0 +1,92 @@
+/*
+Supervisor:
+-Deadline and heartbeat monitor of the periodic work. Every watched job or task declares the longest time between its heartbeats
+ (period) and the longest run (deadline), and brackets each run with sup_begin() and sup_end(). The executive does this for all
+ its jobs, the control task for every event it handles.
+-Per watch: heartbeats, misses, the worst heartbeat later than its period (jitter) and the worst run time (WCET).
+-A high priority task checks all watches every SUP_PERIOD_MS. A watch is late when no heartbeat came within period plus deadline,
+ or its current run is beyond its deadline (stalled). Late for SUP_MISSES_SAFE checks in a row on a critical watch: every heater
+ output is forced to 0 (pwm_out_safe()), latched until restart.
+-While the system is on the task is subscribed to the task watchdog. A stall that lasts SUP_RESET_MS after the heaters were
+ forced off stops the feed, the watchdog then resets the chip. While off, the heaters are at 0 anyway: the task checks once a
+ minute and stays off the watchdog, light sleep is not interrupted every second.
+*/
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define SUP_WATCHES_MAX         (12)
+#define SUP_PERIOD_MS           (1000)      // check period while the system is on
+#define SUP_PERIOD_OFF_MS       (60000)     // check period while off
+#define SUP_MISSES_SAFE         (3)         // late checks in a row of a critical watch before the heaters are forced off
+#define SUP_RESET_MS            (30000)     // stall after the heaters were forced off before the watchdog resets the chip
+#define SUP_STACK_SIZE          (3 * 1024)
+#define SUP_PRIORITY            (6)         // above control, buttons and PWM: a busy loop there must not hide from the check
+
+typedef int sup_watch_t;                    // watch handle, -1 = none, ignored by every call
+
+typedef enum {
+    SUP_OK,
+    SUP_LATE,                   // no heartbeat within period plus deadline
+    SUP_STALLED                 // the current run is beyond its deadline
+} sup_state_t;
+
+typedef struct {
+    const char *name;
+    uint32_t period_ms;         // longest time between heartbeats, 0 = runs on demand, only stalls are detected
+    uint32_t deadline_ms;       // longest run, also the grace on the period
+    bool critical;              // sustained misses force the heaters off
+    sup_state_t state;          // at the last check
+    uint32_t beats;
+    uint32_t missed;            // late heartbeats, overlong runs and stalls
+    uint32_t late_checks;       // checks in a row that found the watch late or stalled
+    uint32_t max_jitter_us;     // worst heartbeat after its period, earlier (triggered) runs are no jitter
+    uint32_t wcet_us;           // worst run from sup_begin() to sup_end()
+} sup_watch_stats_t;
+
+typedef struct {
+    uint32_t watches;
+    uint32_t checks;
+    bool active;                // system on: one second checks, subscribed to the task watchdog
+    bool safe;                  // heaters forced off, latched until restart
+    sup_watch_t cause;          // watch that forced them off, -1 = none
+    uint32_t stack_free;        // bytes, high-water mark of the task stack
+} sup_stats_t;
+
+/**
+ * Start the supervisor task. Watches can be added before.
+ */
+esp_err_t sup_init(void);
+
+/**
+ * Add a watch, its first heartbeat is due one period from now. Returns the handle or -1 when the table is full.
+ */
+sup_watch_t sup_watch(const char *name, uint32_t period_ms, uint32_t deadline_ms, bool critical);
+
+/**
+ * Change the period, the next heartbeat is due one new period from now.
+ */
+void sup_set_period(sup_watch_t watch, uint32_t period_ms);
+
+/**
+ * Heartbeat: a run starts, and the run ended. Cheap, from any task.
+ */
+void sup_begin(sup_watch_t watch);
+void sup_end(sup_watch_t watch);
+
+/**
+ * System on or off: check period and task watchdog subscription, see above.
+ */
+void sup_set_active(bool active);
+
+/**
+ * Copy the counters of one watch, false if the handle is not valid.
+ */
+bool sup_get_watch_stats(sup_watch_t watch, sup_watch_stats_t *stats);
+
+/**
+ * Copy the supervisor counters.
+ */
+void sup_get_stats(sup_stats_t *stats);
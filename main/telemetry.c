@@ -0,0 +1,262 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "executive.h"
+#include "telemetry.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define SECTOR_SIZE             (4096)      // flash erase unit
+#define PAGES_PER_SECTOR        (SECTOR_SIZE / TELEMETRY_PAGE_SIZE)
+#define US_PER_MINUTE           (60 * 1000000LL)
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const char *TAG = "Telemetry: ";
+
+static const esp_partition_t *part;
+static uint32_t n_pages;
+static QueueHandle_t xTelemetry_queue;
+static exec_job_t telemetry_job = -1;
+static SemaphoreHandle_t flash_lock;        // partition access, head and the RAM page
+static SemaphoreHandle_t read_lock;         // one telemetry_read() at a time, it uses static buffers
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t head;                       // next page to program, protected by flash_lock
+static uint32_t next_seq;                   // sequence number of the RAM page, protected by flash_lock
+static telemetry_page_t page;               // samples not yet programmed, protected by flash_lock
+static uint32_t minute_base;                // log clock at boot: one minute after the newest stored sample
+static telemetry_stats_t stats;
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static uint32_t log_minute(void)
+{
+    return minute_base + (uint32_t)(esp_timer_get_time() / US_PER_MINUTE);
+}
+
+static void count(uint32_t *counter)
+{
+    portENTER_CRITICAL(&stats_lock);
+    (*counter)++;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+static telemetry_page_status_t read_header(uint32_t index, uint32_t *seq)
+{
+    uint8_t hdr[TELEMETRY_HEADER_SIZE];     // peek only looks at the header
+
+    if (esp_partition_read(part, index * TELEMETRY_PAGE_SIZE, hdr, TELEMETRY_HEADER_SIZE) != ESP_OK) {
+        return TELEMETRY_PAGE_CORRUPT;
+    }
+    return telemetry_page_peek(hdr, seq);
+}
+
+static void telemetry_scan(void)   // find the newest page: newest sector by its first page, then the last valid page in it
+{
+    uint32_t seq, best_seq = 0;
+    int64_t newest = -1;
+
+    for (uint32_t p = 0; p < n_pages; p += PAGES_PER_SECTOR) {
+        if (read_header(p, &seq) == TELEMETRY_PAGE_OK && (newest < 0 || seq > best_seq)) {
+            newest = p;
+            best_seq = seq;
+        }
+    }
+    if (newest < 0) {
+        head = 0;
+        next_seq = 0;
+        minute_base = 0;
+        ESP_LOGI(TAG, "empty log");
+        return;
+    }
+    for (uint32_t p = newest + 1; p < newest + PAGES_PER_SECTOR && p < n_pages; p++) {
+        if (read_header(p, &seq) == TELEMETRY_PAGE_OK && seq > best_seq) {
+            newest = p;
+            best_seq = seq;
+        }
+    }
+
+    static uint8_t buf[TELEMETRY_PAGE_SIZE];
+    static telemetry_sample_t samples[TELEMETRY_PAGE_SAMPLES];
+    int n = 0;
+    esp_partition_read(part, newest * TELEMETRY_PAGE_SIZE, buf, sizeof(buf));
+    if (telemetry_page_decode(buf, &seq, samples, TELEMETRY_PAGE_SAMPLES, &n) == TELEMETRY_PAGE_OK && n > 0) {
+        minute_base = samples[n - 1].minute + 1;
+    }
+    head = (newest + 1) % n_pages;
+    next_seq = best_seq + 1;
+    ESP_LOGI(TAG, "newest page %u seq %u, log clock at minute %u", (uint32_t)newest, best_seq, minute_base);
+}
+
+static void telemetry_write_page(void)     // program the RAM page and start the next one, flash_lock held
+{
+    uint32_t seq;
+
+    if (page.count == 0) {
+        return;
+    }
+    telemetry_page_finish(&page);
+
+    for (uint32_t tries = 0; tries < n_pages; tries++) {
+        uint32_t addr = head * TELEMETRY_PAGE_SIZE;
+        if (head % PAGES_PER_SECTOR == 0) {
+            if (esp_partition_erase_range(part, addr, SECTOR_SIZE) != ESP_OK) {    // drops the oldest 16 pages
+                count(&stats.errors);
+                break;
+            }
+            count(&stats.erases);
+        }
+        else if (read_header(head, &seq) != TELEMETRY_PAGE_ERASED) {
+            count(&stats.skipped);     // left over from an interrupted write, never program over it
+            head = (head + 1) % n_pages;
+            continue;
+        }
+        if (esp_partition_write(part, addr, page.buf, TELEMETRY_PAGE_SIZE) == ESP_OK) {
+            count(&stats.pages);
+        }
+        else {
+            count(&stats.errors);
+        }
+        head = (head + 1) % n_pages;
+        break;
+    }
+    telemetry_page_begin(&page, ++next_seq);
+}
+
+static void telemetry_flush(void *ctx)     // executive job: encode queued samples, program a page when it is full or the system goes off
+{
+    static bool boot = true;
+    static bool was_on = false;
+    telemetry_sample_t sample;
+
+    while (xQueueReceive(xTelemetry_queue, &sample, 0) == pdTRUE) {
+        sample.boot = boot;
+        boot = false;
+
+        xSemaphoreTake(flash_lock, portMAX_DELAY);
+        if (!telemetry_page_add(&page, &sample)) {
+            telemetry_write_page();
+            telemetry_page_add(&page, &sample);
+        }
+        if (was_on && !sample.on) {
+            telemetry_write_page();     // switched off: the vehicle is likely parked and may lose power next
+        }
+        xSemaphoreGive(flash_lock);
+
+        was_on = sample.on;
+        count(&stats.samples);
+    }
+}
+
+/**********************
+ *  API
+ **********************/
+esp_err_t telemetry_init(void)
+{
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, TELEMETRY_PARTITION);
+    if (part == NULL) {
+        ESP_LOGE(TAG, "partition '%s' not found, check the partition table", TELEMETRY_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    n_pages = part->size / SECTOR_SIZE * PAGES_PER_SECTOR;
+
+    telemetry_scan();
+    telemetry_page_begin(&page, next_seq);
+
+    flash_lock = xSemaphoreCreateMutex();
+    read_lock = xSemaphoreCreateMutex();
+    if (flash_lock == NULL || read_lock == NULL) {
+        ESP_LOGE(TAG, "lock creation failed");
+        part = NULL;                            // telemetry_read() reports the log as missing
+        return ESP_ERR_NO_MEM;
+    }
+    xTelemetry_queue = xQueueCreate(TELEMETRY_QUEUE_LEN, sizeof(telemetry_sample_t));
+    if (xTelemetry_queue == NULL) {
+        ESP_LOGE(TAG, "queue creation failed");
+        part = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    telemetry_job = exec_add("telemetry", telemetry_flush, NULL, 0, TELEMETRY_DEADLINE_MS, false);
+    return ESP_OK;
+}
+
+void telemetry_log(const telemetry_sample_t *sample)
+{
+    telemetry_sample_t s = *sample;
+
+    if (xTelemetry_queue == NULL) {
+        return;
+    }
+    s.minute = log_minute();
+    if (xQueueSend(xTelemetry_queue, &s, 0) != pdTRUE) {
+        count(&stats.dropped);
+    }
+    exec_trigger(telemetry_job, 0);
+}
+
+esp_err_t telemetry_read(uint32_t minutes, telemetry_read_fn_t fn, void *ctx)
+{
+    static uint8_t buf[TELEMETRY_PAGE_SIZE];
+    static telemetry_page_t ram;
+    static telemetry_sample_t samples[TELEMETRY_PAGE_SAMPLES];
+    uint32_t now = log_minute();
+    uint32_t from = minutes != 0 && now > minutes ? now - minutes : 0;
+    uint32_t start, seq;
+    int n;
+
+    if (part == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    xSemaphoreTake(read_lock, portMAX_DELAY);
+
+    xSemaphoreTake(flash_lock, portMAX_DELAY);
+    start = head;
+    ram = page;
+    xSemaphoreGive(flash_lock);
+
+    // the page at start is the next one to be written, everything behind it wraps around oldest first
+    for (uint32_t i = 1; i < n_pages; i++) {
+        uint32_t index = (start + i) % n_pages;
+        xSemaphoreTake(flash_lock, portMAX_DELAY);     // a flash read must not meet the writer's erase
+        esp_err_t err = esp_partition_read(part, index * TELEMETRY_PAGE_SIZE, buf, sizeof(buf));
+        xSemaphoreGive(flash_lock);
+        if (err != ESP_OK || telemetry_page_decode(buf, &seq, samples, TELEMETRY_PAGE_SAMPLES, &n) != TELEMETRY_PAGE_OK) {
+            continue;
+        }
+        for (int k = 0; k < n; k++) {
+            if (samples[k].minute >= from) {
+                fn(&samples[k], ctx);
+            }
+        }
+    }
+
+    telemetry_page_finish(&ram);
+    if (telemetry_page_decode(ram.buf, &seq, samples, TELEMETRY_PAGE_SAMPLES, &n) == TELEMETRY_PAGE_OK) {
+        for (int k = 0; k < n; k++) {
+            if (samples[k].minute >= from) {
+                fn(&samples[k], ctx);
+            }
+        }
+    }
+
+    xSemaphoreGive(read_lock);
+    return ESP_OK;
+}
+
+void telemetry_get_stats(telemetry_stats_t *out)
+{
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
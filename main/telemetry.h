@@ -0,0 +1,49 @@
+/*
+Telemetry log:
+-Append-only time series of temperature, humidity, on/off, mode and the five power levels in the "littlefs" data partition.
+-Samples are encoded into 256 byte pages by telemetry_codec in RAM, a page is programmed once when full (about 80 minutes)
+ or when the system is switched off. A power loss loses the unwritten page.
+-Circular retention: entering a 4 KB sector erases it, so the oldest 16 pages go. The partition holds about 200 days of 1 minute samples.
+-The log clock continues from the newest stored sample at boot, samples after a power up carry the boot flag.
+-Flash work runs as an executive job, producers only queue the sample.
+*/
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "telemetry_codec.h"
+
+#define TELEMETRY_PARTITION     "littlefs"
+#define TELEMETRY_QUEUE_LEN     (4)
+#define TELEMETRY_DEADLINE_MS   (1000)      // executive deadline, a sector erase takes up to a few hundred ms
+
+typedef struct {
+    uint32_t samples;           // samples logged
+    uint32_t dropped;           // samples lost to a full queue
+    uint32_t pages;             // pages programmed
+    uint32_t erases;            // sectors erased
+    uint32_t errors;            // failed flash operations
+    uint32_t skipped;           // pages found not erased before programming, e.g. after an interrupted write
+} telemetry_stats_t;
+
+typedef void (*telemetry_read_fn_t)(const telemetry_sample_t *sample, void *ctx);
+
+/**
+ * Find the partition, locate the newest page and add the writer job. Call after exec_init().
+ */
+esp_err_t telemetry_init(void);
+
+/**
+ * Queue a sample, never blocks. minute and boot are filled in from the log clock.
+ */
+void telemetry_log(const telemetry_sample_t *sample);
+
+/**
+ * Call fn for every stored sample of the last minutes (0 = all), oldest first, including the page not yet written.
+ */
+esp_err_t telemetry_read(uint32_t minutes, telemetry_read_fn_t fn, void *ctx);
+
+/**
+ * Copy the counters.
+ */
+void telemetry_get_stats(telemetry_stats_t *stats);
@@ -0,0 +1,199 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <string.h>
+#include "telemetry_codec.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define TELEMETRY_MAGIC         (0x4C54)    // "TL"
+#define FLAG_CHANGED            (1u << 0)   // on/off, mode or a power level differ from the previous sample
+#define FLAG_BOOT               (1u << 1)
+#define FLAG_BITS               (2)
+#define PL_BITS                 (3)
+
+// header layout, little endian
+#define HDR_MAGIC               (0)
+#define HDR_SEQ                 (2)
+#define HDR_COUNT               (6)
+#define HDR_LEN                 (7)         // payload bytes after the header
+#define HDR_CRC                 (8)
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static uint16_t crc16(const uint8_t *data, size_t len)     // CRC-16/CCITT-FALSE
+{
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static size_t put_varint(uint8_t *p, uint32_t v)
+{
+    size_t n = 0;
+
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static bool get_varint(const uint8_t **p, const uint8_t *end, uint32_t *v)
+{
+    uint32_t result = 0;
+
+    for (int shift = 0; shift < 35 && *p < end; shift += 7) {
+        uint8_t b = *(*p)++;
+        result |= (uint32_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            *v = result;
+            return true;
+        }
+    }
+    return false;       // truncated or longer than 5 bytes
+}
+
+static bool state_changed(const telemetry_sample_t *a, const telemetry_sample_t *b)
+{
+    return a->on != b->on || a->mode != b->mode || memcmp(a->pl, b->pl, sizeof(a->pl)) != 0;
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+void telemetry_page_begin(telemetry_page_t *page, uint32_t seq)
+{
+    memset(page, 0, sizeof(*page));
+    put_u16(&page->buf[HDR_MAGIC], TELEMETRY_MAGIC);
+    put_u16(&page->buf[HDR_SEQ], (uint16_t)seq);
+    put_u16(&page->buf[HDR_SEQ + 2], (uint16_t)(seq >> 16));
+    page->len = TELEMETRY_HEADER_SIZE;
+}
+
+bool telemetry_page_add(telemetry_page_t *page, const telemetry_sample_t *s)
+{
+    uint8_t rec[TELEMETRY_RECORD_MAX];
+    size_t n = 0;
+    bool changed = state_changed(s, &page->last);
+    uint32_t base = page->last.minute;
+    uint32_t dt = s->minute >= base ? s->minute - base : 0;     // time never runs backwards in a page
+
+    n += put_varint(&rec[n], dt << FLAG_BITS | (s->boot ? FLAG_BOOT : 0) | (changed ? FLAG_CHANGED : 0));
+    n += put_varint(&rec[n], zigzag(s->temperature - page->last.temperature));
+    n += put_varint(&rec[n], zigzag(s->humidity - page->last.humidity));
+    if (changed) {
+        uint16_t pl = 0;
+        for (int z = 0; z < TELEMETRY_ZONES; z++) {
+            pl |= (uint16_t)(s->pl[z] & 0x7) << (z * PL_BITS);
+        }
+        rec[n++] = (uint8_t)((s->on ? 0x80 : 0) | (s->mode & 0x7F));
+        put_u16(&rec[n], pl);
+        n += 2;
+    }
+
+    if (page->len + n > TELEMETRY_PAGE_SIZE) {
+        return false;
+    }
+    memcpy(&page->buf[page->len], rec, n);
+    page->len += n;
+    page->count++;
+    page->last = *s;
+    page->last.minute = base + dt;          // equal to s->minute unless the clock stepped back, then the decoder's view
+    return true;
+}
+
+void telemetry_page_finish(telemetry_page_t *page)
+{
+    size_t payload = page->len - TELEMETRY_HEADER_SIZE;
+
+    memset(&page->buf[page->len], 0xFF, TELEMETRY_PAGE_SIZE - page->len);
+    page->buf[HDR_COUNT] = page->count;
+    page->buf[HDR_LEN] = (uint8_t)payload;
+    put_u16(&page->buf[HDR_CRC], crc16(&page->buf[TELEMETRY_HEADER_SIZE], payload));
+}
+
+telemetry_page_status_t telemetry_page_peek(const uint8_t *buf, uint32_t *seq)
+{
+    uint16_t magic = get_u16(&buf[HDR_MAGIC]);
+
+    if (magic == 0xFFFF && buf[HDR_LEN] == 0xFF) {
+        return TELEMETRY_PAGE_ERASED;
+    }
+    if (magic != TELEMETRY_MAGIC || buf[HDR_LEN] > TELEMETRY_PAGE_SIZE - TELEMETRY_HEADER_SIZE) {
+        return TELEMETRY_PAGE_CORRUPT;
+    }
+    *seq = get_u16(&buf[HDR_SEQ]) | (uint32_t)get_u16(&buf[HDR_SEQ + 2]) << 16;
+    return TELEMETRY_PAGE_OK;
+}
+
+telemetry_page_status_t telemetry_page_decode(const uint8_t *buf, uint32_t *seq, telemetry_sample_t *samples, int max, int *count)
+{
+    telemetry_page_status_t status = telemetry_page_peek(buf, seq);
+    telemetry_sample_t last;
+
+    *count = 0;
+    if (status != TELEMETRY_PAGE_OK) {
+        return status;
+    }
+    const uint8_t *p = &buf[TELEMETRY_HEADER_SIZE];
+    const uint8_t *end = p + buf[HDR_LEN];
+    if (get_u16(&buf[HDR_CRC]) != crc16(p, buf[HDR_LEN])) {
+        return TELEMETRY_PAGE_CORRUPT;
+    }
+
+    memset(&last, 0, sizeof(last));
+    for (int i = 0; i < buf[HDR_COUNT]; i++) {
+        uint32_t head, dtemp, dhum;
+        if (!get_varint(&p, end, &head) || !get_varint(&p, end, &dtemp) || !get_varint(&p, end, &dhum)) {
+            return TELEMETRY_PAGE_CORRUPT;
+        }
+        last.minute += head >> FLAG_BITS;
+        last.boot = (head & FLAG_BOOT) != 0;
+        last.temperature = (int16_t)(last.temperature + unzigzag(dtemp));
+        last.humidity = (int16_t)(last.humidity + unzigzag(dhum));
+        if (head & FLAG_CHANGED) {
+            if (end - p < 3) {
+                return TELEMETRY_PAGE_CORRUPT;
+            }
+            last.on = p[0] >> 7;
+            last.mode = p[0] & 0x7F;
+            uint16_t pl = get_u16(&p[1]);
+            for (int z = 0; z < TELEMETRY_ZONES; z++) {
+                last.pl[z] = (pl >> (z * PL_BITS)) & 0x7;
+            }
+            p += 3;
+        }
+        if (*count < max) {
+            samples[(*count)++] = last;
+        }
+    }
+    return p == end ? TELEMETRY_PAGE_OK : TELEMETRY_PAGE_CORRUPT;
+}
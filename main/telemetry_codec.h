@@ -0,0 +1,69 @@
+/*
+Telemetry page codec:
+-Samples are packed into self-contained 256 byte pages, one flash program unit. Any page decodes without its neighbours.
+-A page starts with a 10 byte header: magic, page sequence number, sample count, payload length and a CRC-16 of the payload.
+-Every record is a delta to the previous sample of the page (the first one to an all-zero sample), as LEB128 varints:
+ (minutes since the previous sample << 2 | boot << 1 | state changed), zigzag temperature delta, zigzag humidity delta,
+ then, only if the state changed, on/off and mode in one byte and the five power levels packed 3 bits each in two bytes.
+-A steady sample takes 3 bytes, a page holds about 80 minutes.
+-Plain C without ESP-IDF dependencies, also built natively, see host/CMakeLists.txt.
+*/
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TELEMETRY_PAGE_SIZE     (256)
+#define TELEMETRY_HEADER_SIZE   (10)
+#define TELEMETRY_RECORD_MAX    (5 + 3 + 3 + 3)     // varint sizes of a worst case record plus the state bytes
+#define TELEMETRY_PAGE_SAMPLES  ((TELEMETRY_PAGE_SIZE - TELEMETRY_HEADER_SIZE) / 3)    // upper bound of samples per page, 3 bytes per record at least
+#define TELEMETRY_ZONES         (5)
+
+typedef struct {
+    uint32_t minute;                    // minutes on the log clock, continues across reboots, below 2^30
+    int16_t temperature;                // 0.1 C
+    int16_t humidity;                   // 0.1 %
+    uint8_t on;                         // on_off_b_state
+    uint8_t mode;                       // heater_mode_t
+    uint8_t pl[TELEMETRY_ZONES];        // power levels 0-5
+    bool boot;                          // first sample after a power up, the gap to the previous one is unknown
+} telemetry_sample_t;
+
+typedef struct {
+    uint8_t buf[TELEMETRY_PAGE_SIZE];
+    size_t len;                         // bytes used including the header
+    uint8_t count;                      // samples in the page
+    telemetry_sample_t last;            // delta base for the next record
+} telemetry_page_t;
+
+typedef enum {
+    TELEMETRY_PAGE_OK,
+    TELEMETRY_PAGE_ERASED,              // all 0xFF, never written since the last erase
+    TELEMETRY_PAGE_CORRUPT              // bad magic, length or CRC, e.g. an interrupted write
+} telemetry_page_status_t;
+
+/**
+ * Start an empty page with the given sequence number.
+ */
+void telemetry_page_begin(telemetry_page_t *page, uint32_t seq);
+
+/**
+ * Append a sample. Returns false and leaves the page untouched if the record does not fit.
+ */
+bool telemetry_page_add(telemetry_page_t *page, const telemetry_sample_t *sample);
+
+/**
+ * Fill in the header and pad the unused tail with 0xFF (erased flash), the buffer is then ready to be programmed.
+ */
+void telemetry_page_finish(telemetry_page_t *page);
+
+/**
+ * Check a page header and read its sequence number, without decoding the samples.
+ */
+telemetry_page_status_t telemetry_page_peek(const uint8_t *buf, uint32_t *seq);
+
+/**
+ * Decode up to max samples of a finished page. Returns the page status, count receives the number of decoded samples.
+ */
+telemetry_page_status_t telemetry_page_decode(const uint8_t *buf, uint32_t *seq, telemetry_sample_t *samples, int max, int *count);
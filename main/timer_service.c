@@ -0,0 +1,124 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "timer_service.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define TMR_TICK_US             ((int64_t)TMR_TICK_MS * 1000)
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const char *TAG = "Timers: ";
+
+static esp_timer_handle_t alarm;
+static SemaphoreHandle_t tmr_lock;         // recursive, callbacks run with it held and may start timers
+static tw_t wheel;                         // protected by tmr_lock
+static bool armed;                         // alarm runs, protected by tmr_lock
+static uint32_t armed_tick;                // tick the alarm is set for, valid while armed
+static uint32_t wakeups;
+static uint32_t arms;
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static uint32_t tmr_now(void)      // current tick on the esp_timer clock
+{
+    return (uint32_t)(esp_timer_get_time() / TMR_TICK_US);
+}
+
+static void tmr_arm(uint32_t tick)     // alarm at the start of tick, tmr_lock held
+{
+    int64_t delay = (int64_t)tick * TMR_TICK_US - esp_timer_get_time();
+
+    if (armed) {
+        esp_timer_stop(alarm);
+    }
+    esp_err_t err = esp_timer_start_once(alarm, delay > 0 ? delay : 0);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%s) arming the alarm", esp_err_to_name(err));
+        return;
+    }
+    armed = true;
+    armed_tick = tick;
+    arms++;
+}
+
+static void tmr_expired(void *arg)     // esp_timer task: run the expired timers, arm for the next one
+{
+    uint32_t ticks;
+
+    xSemaphoreTakeRecursive(tmr_lock, portMAX_DELAY);
+    armed = false;
+    wakeups++;
+    tw_advance(&wheel, tmr_now());
+    if (tw_next(&wheel, &ticks)) {
+        tmr_arm(wheel.now + ticks);
+    }
+    xSemaphoreGiveRecursive(tmr_lock);
+}
+
+/**********************
+ *  API
+ **********************/
+esp_err_t tmr_init(void)
+{
+    const esp_timer_create_args_t args = {
+        .callback = tmr_expired,
+        .name = "tmr"
+    };
+
+    tmr_lock = xSemaphoreCreateRecursiveMutex();
+    if (tmr_lock == NULL) {
+        ESP_LOGE(TAG, "lock creation failed");
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = esp_timer_create(&args, &alarm);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%s) creating the alarm", esp_err_to_name(err));
+        return err;
+    }
+    tw_init(&wheel, tmr_now());
+    return ESP_OK;
+}
+
+void tmr_start(tw_timer_t *timer, uint32_t ms)
+{
+    xSemaphoreTakeRecursive(tmr_lock, portMAX_DELAY);
+    tw_advance(&wheel, tmr_now());     // count from the current tick, timers due by now run first
+    tw_add(&wheel, timer, (ms + TMR_TICK_MS - 1) / TMR_TICK_MS);
+    if (!armed || (int32_t)(timer->expiry - armed_tick) < 0) {
+        tmr_arm(timer->expiry);
+    }
+    xSemaphoreGiveRecursive(tmr_lock);
+}
+
+void tmr_cancel(tw_timer_t *timer)
+{
+    xSemaphoreTakeRecursive(tmr_lock, portMAX_DELAY);
+    tw_cancel(&wheel, timer);
+    xSemaphoreGiveRecursive(tmr_lock);
+}
+
+bool tmr_pending(const tw_timer_t *timer)
+{
+    xSemaphoreTakeRecursive(tmr_lock, portMAX_DELAY);
+    bool pending = tw_pending(timer);
+    xSemaphoreGiveRecursive(tmr_lock);
+    return pending;
+}
+
+void tmr_get_stats(tmr_stats_t *out)
+{
+    xSemaphoreTakeRecursive(tmr_lock, portMAX_DELAY);
+    out->wheel = wheel.stats;
+    out->wakeups = wakeups;
+    out->armed = arms;
+    xSemaphoreGiveRecursive(tmr_lock);
+}
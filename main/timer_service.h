@@ -0,0 +1,51 @@
+/*
+Timer service:
+-One timer wheel (timer_wheel.h) on the esp_timer clock with TMR_TICK_MS resolution, for windows of seconds to hours: the boost
+ windows of the zones, the long press override and the auto-off timeout of the control logic.
+-A single one-shot esp_timer is armed at the earliest expiry only. No periodic tick: with nothing due the chip stays in light
+ sleep, and dozens of pending timers cost nothing until one expires.
+-Start and cancel are O(1) plus the catch-up of the wheel to the current tick. A start earlier than the armed expiry re-arms the
+ esp_timer, a cancel leaves it armed and the wakeup finds nothing to do.
+-Callbacks run in the esp_timer task, or in the task starting a timer when the wheel catches up. Keep them short: post an event.
+ They may start and cancel timers.
+*/
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "timer_wheel.h"
+
+#define TMR_TICK_MS             (100)
+
+typedef struct {
+    tw_stats_t wheel;
+    uint32_t wakeups;           // esp_timer expiries
+    uint32_t armed;             // esp_timer starts
+} tmr_stats_t;
+
+/**
+ * Create the esp_timer and the wheel. Call before any module starts a timer.
+ */
+esp_err_t tmr_init(void);
+
+/**
+ * Start the timer to expire ms from now, to within one tick. A pending timer is restarted. The timer is set up with
+ * tw_timer_init() first. From any task.
+ */
+void tmr_start(tw_timer_t *timer, uint32_t ms);
+
+/**
+ * Stop the timer if it is pending.
+ */
+void tmr_cancel(tw_timer_t *timer);
+
+/**
+ * True from tmr_start() until the timer is cancelled or its callback starts.
+ */
+bool tmr_pending(const tw_timer_t *timer);
+
+/**
+ * Copy the counters.
+ */
+void tmr_get_stats(tmr_stats_t *stats);
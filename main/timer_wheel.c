@@ -0,0 +1,120 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <string.h>
+#include "timer_wheel.h"
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static void tw_link(tw_timer_t **link, tw_timer_t *timer)    // insert before *link
+{
+    timer->next = *link;
+    if (timer->next != NULL) {
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = link;
+    *link = timer;
+}
+
+static void tw_unlink(tw_timer_t *timer)
+{
+    *timer->pprev = timer->next;
+    if (timer->next != NULL) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+void tw_init(tw_t *wheel, uint32_t now)
+{
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now = now;
+}
+
+void tw_timer_init(tw_timer_t *timer, tw_fn_t fn, void *ctx)
+{
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expiry = 0;
+    timer->fn = fn;
+    timer->ctx = ctx;
+}
+
+void tw_add(tw_t *wheel, tw_timer_t *timer, uint32_t ticks)
+{
+    tw_cancel(wheel, timer);
+    timer->expiry = wheel->now + (ticks > 0 ? ticks : 1);
+    tw_link(&wheel->slot[timer->expiry & (TW_SLOTS - 1)], timer);
+    wheel->stats.added++;
+    if (++wheel->stats.pending > wheel->stats.max_pending) {
+        wheel->stats.max_pending = wheel->stats.pending;
+    }
+}
+
+void tw_cancel(tw_t *wheel, tw_timer_t *timer)
+{
+    if (!tw_pending(timer)) {
+        return;
+    }
+    tw_unlink(timer);
+    wheel->stats.cancelled++;
+    wheel->stats.pending--;
+}
+
+int tw_advance(tw_t *wheel, uint32_t now)
+{
+    uint32_t from = wheel->now;
+    uint32_t elapsed = now - from;
+    tw_timer_t *due = NULL;     // expired timers in expiry order, still pending: a callback can cancel the ones after it
+    int fired = 0;
+
+    if ((int32_t)elapsed <= 0) {
+        return 0;
+    }
+    uint32_t steps = elapsed < TW_SLOTS ? elapsed : TW_SLOTS;
+    for (uint32_t i = 1; i <= steps; i++) {
+        tw_timer_t **link = &wheel->slot[(from + i) & (TW_SLOTS - 1)];
+        while (*link != NULL) {
+            tw_timer_t *timer = *link;
+            if ((int32_t)(timer->expiry - now) > 0) {
+                link = &timer->next;    // a later turn
+                continue;
+            }
+            tw_unlink(timer);
+            tw_timer_t **at = &due;
+            while (*at != NULL && (*at)->expiry - from <= timer->expiry - from) {
+                at = &(*at)->next;
+            }
+            tw_link(at, timer);
+        }
+    }
+    wheel->now = now;
+
+    while (due != NULL) {
+        tw_timer_t *timer = due;
+        tw_unlink(timer);
+        wheel->stats.pending--;
+        wheel->stats.fired++;
+        fired++;
+        timer->fn(timer->ctx);
+    }
+    return fired;
+}
+
+bool tw_next(const tw_t *wheel, uint32_t *ticks)
+{
+    bool found = false;
+
+    for (int s = 0; s < TW_SLOTS; s++) {
+        for (const tw_timer_t *timer = wheel->slot[s]; timer != NULL; timer = timer->next) {
+            uint32_t left = timer->expiry - wheel->now;
+            if (!found || left < *ticks) {
+                *ticks = left;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
@@ -0,0 +1,81 @@
+/*
+Timer wheel:
+-Hashed timing wheel of TW_SLOTS slots, one tick per slot. A timer sits in the slot of its expiry tick modulo TW_SLOTS with its
+ absolute expiry, so timers longer than one turn need no round counter and stay put until their turn comes.
+-Timers are intrusive, the owner embeds a tw_timer_t. Add and cancel unlink and link one list node: O(1) whatever the number of
+ pending timers, no allocation.
+-The caller owns time: tw_advance() moves the wheel to a tick and runs the expired callbacks in expiry order. A jump of more than
+ one turn visits every slot once. Nothing runs between advances, an idle wheel costs nothing.
+-Callbacks may add and cancel timers, also the ones expiring in the same advance.
+-Not thread safe, see timer_service.h for the locked service on the esp_timer clock.
+-Plain C without ESP-IDF dependencies, also built natively for host/bench_timer_wheel.c and host/sim_heater.c.
+*/
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TW_SLOTS                (64)        // power of 2
+
+typedef void (*tw_fn_t)(void *ctx);
+
+typedef struct tw_timer {
+    struct tw_timer *next;
+    struct tw_timer **pprev;    // link pointing to this timer, NULL when not pending
+    uint32_t expiry;            // tick
+    tw_fn_t fn;
+    void *ctx;
+} tw_timer_t;
+
+typedef struct {
+    uint32_t pending;
+    uint32_t max_pending;
+    uint32_t added;             // tw_add() calls, restarts included
+    uint32_t cancelled;         // pending timers cancelled, restarts included
+    uint32_t fired;
+} tw_stats_t;
+
+typedef struct {
+    tw_timer_t *slot[TW_SLOTS];
+    uint32_t now;               // tick the wheel has advanced to
+    tw_stats_t stats;
+} tw_t;
+
+/**
+ * Empty wheel at tick now.
+ */
+void tw_init(tw_t *wheel, uint32_t now);
+
+/**
+ * Set up a timer that is not pending, fn(ctx) runs on expiry.
+ */
+void tw_timer_init(tw_timer_t *timer, tw_fn_t fn, void *ctx);
+
+/**
+ * Start the timer to expire ticks after the wheel's current tick, at least one. A pending timer is restarted.
+ */
+void tw_add(tw_t *wheel, tw_timer_t *timer, uint32_t ticks);
+
+/**
+ * Stop a pending timer, nothing happens if it is not.
+ */
+void tw_cancel(tw_t *wheel, tw_timer_t *timer);
+
+/**
+ * True from tw_add() until the timer is cancelled or its callback starts.
+ */
+static inline bool tw_pending(const tw_timer_t *timer)
+{
+    return timer->pprev != NULL;
+}
+
+/**
+ * Advance the wheel to tick now and run the callbacks of every timer expired by then. Returns the number run.
+ */
+int tw_advance(tw_t *wheel, uint32_t now);
+
+/**
+ * Ticks from the wheel's current tick to the earliest expiry, false when no timer is pending. Scans every slot, call it
+ * after an advance rather than per timer.
+ */
+bool tw_next(const tw_t *wheel, uint32_t *ticks);
@@ -0,0 +1,112 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <string.h>
+#include "touch_adapt.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define Q                       (4)         // fraction bits of baseline and noise
+#define NOISE_SHIFT             (4)         // noise filter: 1/16 of the difference per sample
+#define FALL_SHIFT_LESS         (3)         // the baseline falls 8 times faster than it rises
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static uint32_t touch_threshold(const touch_adapt_t *t, const touch_adapt_channel_t *c)   // touch delta in reading counts
+{
+    const touch_adapt_config_t *cfg = &t->config;
+    uint32_t sens = t->wet && cfg->wet_permille > cfg->sens_permille ? cfg->wet_permille : cfg->sens_permille;
+    uint32_t by_sens = (uint32_t)((uint64_t)(c->baseline >> Q) * sens / 1000);
+    uint32_t by_noise = (c->noise * cfg->noise_factor) >> Q;
+    uint32_t thr = by_sens > by_noise ? by_sens : by_noise;
+
+    return thr > 0 ? thr : 1;
+}
+
+static void track_baseline(const touch_adapt_config_t *cfg, touch_adapt_channel_t *c, uint32_t raw)   // idle pad only
+{
+    int32_t d = (int32_t)(raw << Q) - (int32_t)c->baseline;
+    int shift = d < 0 ? (cfg->baseline_shift > FALL_SHIFT_LESS ? cfg->baseline_shift - FALL_SHIFT_LESS : 0) : cfg->baseline_shift;
+    uint32_t dev = d < 0 ? (uint32_t)-d : (uint32_t)d;
+
+    c->baseline = (uint32_t)((int32_t)c->baseline + d / (1 << shift));
+    c->noise = (uint32_t)((int32_t)c->noise + ((int32_t)dev - (int32_t)c->noise) / (1 << NOISE_SHIFT));
+}
+
+void touch_adapt_init(touch_adapt_t *t, const touch_adapt_config_t *config, int n, const uint32_t *raw)
+{
+    memset(t, 0, sizeof(*t));
+    t->config = *config;
+    t->n = n < TOUCH_ADAPT_CH_MAX ? n : TOUCH_ADAPT_CH_MAX;
+    for (int i = 0; i < t->n; i++) {
+        t->ch[i].baseline = raw[i] << Q;
+        t->ch[i].threshold = touch_threshold(t, &t->ch[i]);
+    }
+}
+
+int touch_adapt_step(touch_adapt_t *t, const uint32_t *raw, uint32_t now_ms, touch_adapt_event_t *events)
+{
+    const touch_adapt_config_t *cfg = &t->config;
+    int32_t delta[TOUCH_ADAPT_CH_MAX];
+    int crossing = 0, n_events = 0;
+
+    // pass 1: thresholds and the pads that newly cross them
+    t->wet = t->wet && (int32_t)(now_ms - t->wet_until_ms) < 0;
+    for (int i = 0; i < t->n; i++) {
+        touch_adapt_channel_t *c = &t->ch[i];
+        delta[i] = (int32_t)raw[i] - (int32_t)(c->baseline >> Q);
+        c->threshold = touch_threshold(t, c);
+        if (!c->pressed && delta[i] >= (int32_t)c->threshold) {
+            crossing++;
+        }
+    }
+    bool water = cfg->water_pads > 0 && crossing >= cfg->water_pads;
+    if (water) {
+        t->water++;
+        t->wet = true;
+        t->wet_until_ms = now_ms + cfg->wet_hold_ms;
+    }
+
+    // pass 2: per pad state machine
+    for (int i = 0; i < t->n; i++) {
+        touch_adapt_channel_t *c = &t->ch[i];
+        bool over = delta[i] >= (int32_t)c->threshold;
+        events[i] = TOUCH_ADAPT_NONE;
+
+        if (!c->pressed) {
+            if (over && !water) {
+                if (++c->above >= cfg->debounce) {
+                    c->pressed = true;
+                    c->long_sent = false;
+                    c->since_ms = now_ms;
+                    c->above = 0;
+                    events[i] = TOUCH_ADAPT_PRESS;
+                }
+            }
+            else {
+                c->above = 0;
+                if (!over) {
+                    track_baseline(cfg, c, raw[i]);
+                }
+            }
+        }
+        else if (delta[i] < (int32_t)(c->threshold * cfg->release_pct / 100)) {
+            c->pressed = false;
+            events[i] = TOUCH_ADAPT_RELEASE;
+        }
+        else if (cfg->stuck_ms && now_ms - c->since_ms >= cfg->stuck_ms) {
+            c->baseline = raw[i] << Q;          // a puddle, not a finger: take it as the new idle level
+            c->pressed = false;
+            t->relearned++;
+            events[i] = TOUCH_ADAPT_RELEASE;
+        }
+        else if (!c->long_sent && now_ms - c->since_ms >= cfg->longpress_ms) {
+            c->long_sent = true;
+            events[i] = TOUCH_ADAPT_LONGPRESS;
+        }
+        n_events += events[i] != TOUCH_ADAPT_NONE;
+    }
+    return n_events;
+}
@@ -0,0 +1,82 @@
+/*
+Adaptive touch detection:
+-Per channel baseline and noise tracking on the smoothed touch readings (they rise when a pad is touched), instead of one fixed
+ sensitivity for every pad.
+-The baseline follows slow drift (temperature, a water film building up) while the pad is idle, falls back quickly to lower
+ readings and is re-learned when a pad stays active for longer than stuck_ms (a puddle, not a finger).
+-The touch threshold is the larger of sens_permille of the baseline and noise_factor times the mean deviation from the baseline:
+ a quiet pad can use a low sensitivity that catches gloved fingers, rain noise raises the threshold automatically.
+-A press needs debounce samples in a row above the threshold, the release comes below release_pct of it (hysteresis).
+-Water rejection: when water_pads or more pads cross their threshold in the same sample, none of them is pressed. Water also
+ starts a wet phase of wet_hold_ms in which the sensitivity is at least wet_permille: rain drops on single pads stay below it.
+-Integer only, plain C without ESP-IDF dependencies, also built natively for host/replay_touch.c.
+*/
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TOUCH_ADAPT_CH_MAX      (8)
+
+typedef enum {
+    TOUCH_ADAPT_NONE,
+    TOUCH_ADAPT_PRESS,
+    TOUCH_ADAPT_LONGPRESS,      // once per press, after longpress_ms
+    TOUCH_ADAPT_RELEASE
+} touch_adapt_event_t;
+
+typedef struct {
+    uint16_t sens_permille;     // minimum touch delta, relative to the baseline
+    uint16_t noise_factor;      // minimum touch delta in mean deviations, 0 = fixed sensitivity only
+    uint8_t debounce;           // samples above the threshold for a press
+    uint8_t release_pct;        // release below this share of the threshold
+    uint8_t baseline_shift;     // idle baseline filter: 1/2^shift of the difference per sample
+    uint8_t water_pads;         // pads crossing at once that count as water, 0 = off
+    uint16_t wet_permille;      // minimum touch delta during the wet phase
+    uint32_t wet_hold_ms;       // wet phase after the last water sample
+    uint32_t longpress_ms;
+    uint32_t stuck_ms;          // active longer than this re-learns the baseline, 0 = never
+} touch_adapt_config_t;
+
+typedef struct {
+    uint32_t baseline;          // Q4
+    uint32_t noise;             // Q4, mean absolute deviation while idle
+    uint32_t threshold;         // touch threshold of the last sample, reading counts above the baseline
+    uint32_t since_ms;          // press time while pressed
+    uint8_t above;              // consecutive samples above the threshold
+    bool pressed;
+    bool long_sent;
+} touch_adapt_channel_t;
+
+typedef struct {
+    touch_adapt_config_t config;
+    touch_adapt_channel_t ch[TOUCH_ADAPT_CH_MAX];
+    int n;
+    uint32_t water;             // samples rejected as water
+    uint32_t wet_until_ms;      // end of the wet phase
+    bool wet;
+    uint32_t relearned;         // baselines re-learned after stuck_ms
+} touch_adapt_t;
+
+#define TOUCH_ADAPT_DEFAULT_CONFIG() {  \
+    .sens_permille = 30,                \
+    .noise_factor = 8,                  \
+    .debounce = 2,                      \
+    .release_pct = 60,                  \
+    .baseline_shift = 7,                \
+    .water_pads = 2,                    \
+    .wet_permille = 120,                \
+    .wet_hold_ms = 30000,               \
+    .longpress_ms = 1000,               \
+    .stuck_ms = 20000,                  \
+}
+
+/**
+ * Start tracking n channels (at most TOUCH_ADAPT_CH_MAX) from untouched readings.
+ */
+void touch_adapt_init(touch_adapt_t *t, const touch_adapt_config_t *config, int n, const uint32_t *raw);
+
+/**
+ * Feed one smoothed reading per channel. events receives one event per channel, returns the number that are not NONE.
+ */
+int touch_adapt_step(touch_adapt_t *t, const uint32_t *raw, uint32_t now_ms, touch_adapt_event_t *events);
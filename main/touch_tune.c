@@ -0,0 +1,170 @@
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "executive.h"
+#include "touch_tune.h"
+
+/**********************
+ *  VARIABLES
+ **********************/
+static const char *TAG = "Touch tune: ";
+
+#if CONFIG_TOUCH_ADAPTIVE
+static const bool adaptive = true;
+#else
+static const bool adaptive = false;
+#endif
+
+static portMUX_TYPE tune_lock = portMUX_INITIALIZER_UNLOCKED;
+static const touch_pad_t *pads;
+static int n_pads;
+static touch_tune_event_fn_t event_cb;
+static exec_job_t touch_job = -1;
+static bool recording;                      // protected by tune_lock
+static bool active;                         // system on, protected by tune_lock
+
+static touch_adapt_t tracker;               // protected by tune_lock, stepped by the touch job
+static uint32_t raw[TOUCH_ADAPT_CH_MAX];    // last sample, protected by tune_lock
+static uint32_t benchmark[TOUCH_ADAPT_CH_MAX];
+static touch_tune_stats_t stats;
+
+/**********************
+ *  FUNCTIONS
+ **********************/
+static uint32_t touch_period(void)     // job period for the current recorder and system state, tune_lock held
+{
+    if (recording || (adaptive && active)) {
+        return TOUCH_TUNE_PERIOD_MS;
+    }
+    return adaptive ? TOUCH_TUNE_PERIOD_OFF_MS : 0;
+}
+
+static void touch_read(uint32_t *r, uint32_t *b)
+{
+    for (int i = 0; i < n_pads; i++) {
+        touch_pad_filter_read_smooth(pads[i], &r[i]);
+        touch_pad_read_benchmark(pads[i], &b[i]);
+    }
+}
+
+static void touch_sample(void *ctx)     // executive job: read the pads, track them, report events and print the recorder line
+{
+    uint32_t r[TOUCH_ADAPT_CH_MAX], b[TOUCH_ADAPT_CH_MAX];
+    touch_adapt_event_t events[TOUCH_ADAPT_CH_MAX];
+    uint32_t now = esp_log_timestamp();
+    int n_events;
+
+    touch_read(r, b);
+
+    portENTER_CRITICAL(&tune_lock);
+    n_events = touch_adapt_step(&tracker, r, now, events);
+    for (int i = 0; i < n_pads; i++) {
+        raw[i] = r[i];
+        benchmark[i] = b[i];
+    }
+    bool rec = recording;
+    stats.samples++;
+    stats.water = tracker.water;
+    stats.relearned = tracker.relearned;
+    stats.wet = tracker.wet;
+    portEXIT_CRITICAL(&tune_lock);
+
+    if (adaptive && n_events) {
+        for (int i = 0; i < n_pads; i++) {
+            if (events[i] != TOUCH_ADAPT_NONE) {
+                event_cb(i, events[i]);
+                stats.events++;
+            }
+        }
+    }
+    if (rec) {
+        printf("#T %u", now);
+        for (int i = 0; i < n_pads; i++) {
+            printf(",%u", r[i]);
+        }
+        for (int i = 0; i < n_pads; i++) {
+            printf(",%u", b[i]);
+        }
+        printf("\n");
+        stats.recorded++;
+    }
+}
+
+/**********************
+ *  API
+ **********************/
+esp_err_t touch_tune_init(const touch_pad_t *channels, int n, touch_tune_event_fn_t event_fn)
+{
+    static const touch_adapt_config_t config = TOUCH_ADAPT_DEFAULT_CONFIG();
+    uint32_t r[TOUCH_ADAPT_CH_MAX];
+
+    if (n > TOUCH_ADAPT_CH_MAX) {
+        ESP_LOGE(TAG, "%d pads, at most %d", n, TOUCH_ADAPT_CH_MAX);
+        return ESP_ERR_INVALID_ARG;
+    }
+    pads = channels;
+    n_pads = n;
+    event_cb = event_fn;
+    touch_read(r, benchmark);
+    touch_adapt_init(&tracker, &config, n, r);
+    stats.adaptive = adaptive;
+
+    portENTER_CRITICAL(&tune_lock);
+    uint32_t period = touch_period();
+    portEXIT_CRITICAL(&tune_lock);
+
+    touch_job = exec_add("touch", touch_sample, NULL, period, TOUCH_TUNE_DEADLINE_MS, false);
+    return touch_job < 0 ? ESP_ERR_NO_MEM : ESP_OK;
+}
+
+void touch_tune_record(bool on)
+{
+    portENTER_CRITICAL(&tune_lock);
+    recording = on;
+    stats.recording = on;
+    uint32_t period = touch_period();
+    portEXIT_CRITICAL(&tune_lock);
+
+    exec_set_period(touch_job, period);     // 0: the job stops after its next run
+    if (on && !adaptive) {
+        exec_trigger(touch_job, 0);         // adaptive detection samples anyway
+    }
+}
+
+void touch_tune_set_active(bool on)
+{
+    portENTER_CRITICAL(&tune_lock);
+    active = on;
+    uint32_t period = touch_period();
+    portEXIT_CRITICAL(&tune_lock);
+
+    exec_set_period(touch_job, period);
+}
+
+bool touch_tune_get_channel(int index, touch_tune_channel_t *out)
+{
+    if (index < 0 || index >= n_pads) {
+        return false;
+    }
+    portENTER_CRITICAL(&tune_lock);
+    const touch_adapt_channel_t *c = &tracker.ch[index];
+    out->raw = raw[index];
+    out->benchmark = benchmark[index];
+    out->baseline = c->baseline >> 4;
+    out->noise = c->noise >> 4;
+    out->threshold = c->threshold;
+    out->pressed = c->pressed;
+    portEXIT_CRITICAL(&tune_lock);
+    return true;
+}
+
+void touch_tune_get_stats(touch_tune_stats_t *out)
+{
+    portENTER_CRITICAL(&tune_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&tune_lock);
+}
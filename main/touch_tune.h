@@ -0,0 +1,68 @@
+/*
+Touch tuning:
+-Recorder: 'touch rec on' prints the filtered reading and the hardware benchmark of every pad each TOUCH_TUNE_PERIOD_MS as
+ "#T t_ms,raw0..raw5,base0..base5" lines. A console capture replays on the host with host/replay_touch.
+-Adaptive detection (CONFIG_TOUCH_ADAPTIVE): the same job feeds the readings to touch_adapt and reports presses, long presses
+ and releases through a callback, in place of the touch element library's fixed sensitivity button events.
+-Runs as the "touch" executive job, only while recording or with adaptive detection enabled. While the system is off adaptive
+ detection samples every TOUCH_TUNE_PERIOD_OFF_MS: it only has to catch the on/off button, and light sleep lasts longer.
+*/
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/touch_pad.h"
+#include "touch_adapt.h"
+
+#define TOUCH_TUNE_PERIOD_MS    (20)        // sample period of the recorder and the adaptive detection
+#define TOUCH_TUNE_PERIOD_OFF_MS (100)      // adaptive detection while the system is off, a press is still debounce periods long
+#define TOUCH_TUNE_DEADLINE_MS  (20)        // executive deadline, the next sample is due
+
+typedef void (*touch_tune_event_fn_t)(int index, touch_adapt_event_t event);    // index into the channel array
+
+typedef struct {
+    uint32_t raw;               // filtered reading
+    uint32_t benchmark;         // hardware benchmark of the touch element library
+    uint32_t baseline;          // adaptive baseline, reading counts
+    uint32_t noise;             // adaptive mean deviation, reading counts
+    uint32_t threshold;         // adaptive touch delta
+    bool pressed;
+} touch_tune_channel_t;
+
+typedef struct {
+    uint32_t samples;           // detection or recorder samples
+    uint32_t recorded;          // lines printed by the recorder
+    uint32_t events;            // adaptive events reported
+    uint32_t water;             // samples rejected as water
+    uint32_t relearned;         // baselines re-learned after a stuck pad
+    bool wet;                   // in the wet phase
+    bool adaptive;
+    bool recording;
+} touch_tune_stats_t;
+
+/**
+ * Add the touch job for n pads (at most TOUCH_ADAPT_CH_MAX). Call after touch_element_start(), the pads must be measuring.
+ * event_fn receives the adaptive events, it is not called without CONFIG_TOUCH_ADAPTIVE.
+ */
+esp_err_t touch_tune_init(const touch_pad_t *channels, int n, touch_tune_event_fn_t event_fn);
+
+/**
+ * Start or stop the recorder.
+ */
+void touch_tune_record(bool on);
+
+/**
+ * System on or off: sample period of the adaptive detection, see above. Can be called before touch_tune_init().
+ */
+void touch_tune_set_active(bool on);
+
+/**
+ * Copy the last sample of one pad, false if index is out of range.
+ */
+bool touch_tune_get_channel(int index, touch_tune_channel_t *channel);
+
+/**
+ * Copy the counters.
+ */
+void touch_tune_get_stats(touch_tune_stats_t *stats);